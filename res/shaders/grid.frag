@@ -0,0 +1,101 @@
+#version 330 core
+
+out vec4 o_Color;
+
+// One texel per cell: glyph index, fg color, bg color, flags
+uniform usampler2D u_Cells;
+// One texel per palette entry
+uniform sampler2D u_Palette;
+// Three texels per glyph: atlas rect (left, top, right, bottom), quad relative to pen (left, top, right, bottom),
+// atlas page in x
+uniform sampler2D u_Glyphs;
+uniform sampler2DArray u_Tex;
+#ifdef SDF
+// Distance field value -> screen pixels
+uniform float u_SdfScale;
+#endif
+
+// Screen space -> text space (inverse of the MVP used by the mesh renderer)
+uniform mat4 u_InvMVP;
+uniform vec2 u_ScreenSize;
+// Cell advance, row height, descender
+uniform vec3 u_CellMetrics;
+uniform int u_FirstRow;
+uniform int u_RowCount;
+
+const uint NO_GLYPH = 0xffffffffu;
+const uint TRUECOLOR = 0x1000000u;
+const uint DEFAULT_BG = 257u;
+// Second half of a wide character
+const uint CONTINUATION = 1u;
+
+vec4 resolveColor(uint color) {
+    if ((color & TRUECOLOR) != 0u) {
+        return vec4(color & 0xffu, (color >> 8) & 0xffu, (color >> 16) & 0xffu,
+                    255u) / 255.0;
+    }
+    return texelFetch(u_Palette, ivec2(int(color), 0), 0);
+}
+
+float glyphCoverage(vec3 uv) {
+    // Explicit LOD, implicit derivatives are undefined inside non-uniform control flow
+    float value = textureLod(u_Tex, uv, 0.0).r;
+#ifdef SDF
+    // 0.5 is the outline, antialiased over one screen pixel
+    return clamp((value - 0.5) * u_SdfScale + 0.5, 0.0, 1.0);
+#else
+    return value;
+#endif
+}
+
+void main() {
+    vec2 ndc = gl_FragCoord.xy / u_ScreenSize * 2.0 - 1.0;
+    vec2 pos = (u_InvMVP * vec4(ndc, 0.0, 1.0)).xy;
+
+    float advance = u_CellMetrics.x;
+    float height = u_CellMetrics.y;
+    float descender = u_CellMetrics.z;
+
+    // Mirrors the mesh layout: row y spans [-y * height + descender, -y * height + descender + height],
+    // and the pen is advanced before a cell is drawn, so cell x starts at (x + 1) * advance
+    int row = int(floor((descender + height - pos.y) / height));
+    int col = int(floor(pos.x / advance)) - 1;
+    ivec2 gridSize = textureSize(u_Cells, 0);
+    if (row < u_FirstRow || row >= u_FirstRow + u_RowCount || col < 0 ||
+        col >= gridSize.x) {
+        discard;
+    }
+
+    uvec4 cell = texelFetch(u_Cells, ivec2(col, row % gridSize.y), 0);
+    vec4 fg = resolveColor(cell.g);
+    // The default background is left to the clear color
+    vec4 bg = cell.b == DEFAULT_BG ? vec4(0.0) : resolveColor(cell.b);
+
+    float coverage = 0.0;
+    if (cell.r != NO_GLYPH) {
+        vec4 uv = texelFetch(u_Glyphs, ivec2(0, int(cell.r)), 0);
+        vec4 quad = texelFetch(u_Glyphs, ivec2(1, int(cell.r)), 0);
+        float page = texelFetch(u_Glyphs, ivec2(2, int(cell.r)), 0).x;
+        // Both halves of a wide character draw the same glyph from the pen of the first one
+        int penCol = (cell.a & CONTINUATION) != 0u ? col - 1 : col;
+        vec2 pen = vec2((penCol + 1) * advance, -row * height);
+        vec2 rel = pos - pen;
+        // quad.y is the bottom edge in text space (y goes up), quad.w the top edge
+        if (rel.x >= quad.x && rel.x < quad.z && rel.y >= quad.y &&
+            rel.y < quad.w) {
+            vec2 t = vec2((rel.x - quad.x) / (quad.z - quad.x),
+                          (rel.y - quad.y) / (quad.w - quad.y));
+            coverage = glyphCoverage(vec3(mix(uv.x, uv.z, t.x),
+                                          mix(uv.y, uv.w, t.y), page)) *
+                       fg.a;
+        }
+    }
+
+    // Glyph over background
+    float alpha = coverage + bg.a * (1.0 - coverage);
+    if (alpha == 0.0) {
+        discard;
+    }
+    vec3 color = (fg.rgb * coverage + bg.rgb * bg.a * (1.0 - coverage)) / alpha;
+    o_Color = vec4(color, alpha);
+}
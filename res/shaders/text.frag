@@ -1,17 +1,30 @@
 #version 330 core
 
 in vec4 v_Color;
-in vec2 v_UV;
+in vec3 v_UV;
 flat in int v_Bg; // bool
 
 out vec4 o_Color;
 
-uniform sampler2D u_Tex;
+uniform sampler2DArray u_Tex;
+#ifdef SDF
+// Distance field value -> screen pixels, changes with the scale instead of rasterizing again
+uniform float u_SdfScale;
+#endif
+
+float glyphCoverage(vec3 uv) {
+#ifdef SDF
+    // 0.5 is the outline, antialiased over one screen pixel
+    return clamp((texture(u_Tex, uv).r - 0.5) * u_SdfScale + 0.5, 0.0, 1.0);
+#else
+    return texture(u_Tex, uv).r;
+#endif
+}
 
 void main() {
     if (v_Bg == 1) {
         o_Color = v_Color;
     } else {
-        o_Color = vec4(v_Color.rgb, texture(u_Tex, v_UV).r * v_Color.a);
+        o_Color = vec4(v_Color.rgb, glyphCoverage(v_UV) * v_Color.a);
     }
 }
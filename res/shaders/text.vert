@@ -1,19 +1,31 @@
 #version 330 core
 
 layout(location = 0) in vec3 i_Pos;
-layout(location = 1) in vec4 i_Color;
-layout(location = 2) in vec2 i_UV;
+layout(location = 1) in uint i_Color;
+layout(location = 2) in vec3 i_UV; // atlas page in z
 layout(location = 3) in int i_Bg; // bool
 
 out vec4 v_Color;
-out vec2 v_UV;
+out vec3 v_UV;
 flat out int v_Bg; // bool
 
 uniform mat4 u_MVP;
+// One texel per palette entry
+uniform sampler2D u_Palette;
+
+const uint TRUECOLOR = 0x1000000u;
+
+vec4 resolveColor(uint color) {
+    if ((color & TRUECOLOR) != 0u) {
+        return vec4(color & 0xffu, (color >> 8) & 0xffu, (color >> 16) & 0xffu,
+                    255u) / 255.0;
+    }
+    return texelFetch(u_Palette, ivec2(int(color), 0), 0);
+}
 
 void main() {
     gl_Position = u_MVP * vec4(i_Pos, 1.0);
-    v_Color = i_Color;
+    v_Color = resolveColor(i_Color);
     v_UV = i_UV;
     v_Bg = i_Bg;
 }
@@ -0,0 +1,161 @@
+# Generates src/terminal/unicode_tables.hpp from the UCD files in res/ucd.
+# Run from the repository root: python scripts/gen_unicode_tables/main.py [--fetch]
+# --fetch replaces res/ucd with the latest files from unicode.org first.
+
+import re
+import sys
+import urllib.request
+from pathlib import Path
+
+UCD_DIR = Path("res/ucd")
+OUTPUT = Path("src/terminal/unicode_tables.hpp")
+FILES = {
+    "EastAsianWidth.txt": "https://www.unicode.org/Public/UCD/latest/ucd/EastAsianWidth.txt",
+    "GraphemeBreakProperty.txt": "https://www.unicode.org/Public/UCD/latest/ucd/auxiliary/GraphemeBreakProperty.txt",
+    "emoji-data.txt": "https://www.unicode.org/Public/UCD/latest/ucd/emoji/emoji-data.txt",
+}
+
+CODEPOINTS = 0x110000
+# Codepoints in a stage 2 block, stage 1 is indexed with c >> BLOCK_SHIFT
+BLOCK_SHIFT = 8
+BLOCK_SIZE = 1 << BLOCK_SHIFT
+
+# Same order as unicode::GraphemeBreak
+GRAPHEME_BREAKS = [
+    "Other",
+    "CR",
+    "LF",
+    "Control",
+    "Extend",
+    "ZWJ",
+    "Regional_Indicator",
+    "Prepend",
+    "SpacingMark",
+    "L",
+    "V",
+    "T",
+    "LV",
+    "LVT",
+]
+PICTOGRAPHIC_BIT = 1 << 4
+WIDTH_SHIFT = 5
+
+line_re = re.compile(r"^([0-9A-F]+)(?:\.\.([0-9A-F]+))?\s*;\s*(\w+)")
+
+
+def fetch():
+    UCD_DIR.mkdir(parents=True, exist_ok=True)
+    for name, url in FILES.items():
+        print(f"Fetching {url}")
+        with urllib.request.urlopen(url) as response:
+            (UCD_DIR / name).write_bytes(response.read())
+
+
+def parse(name: str) -> list[tuple[int, int, str]]:
+    ranges = []
+    for line in (UCD_DIR / name).read_text().splitlines():
+        match = line_re.match(line)
+        if match is None:
+            continue
+        first = int(match[1], 16)
+        last = int(match[2], 16) if match[2] else first
+        ranges.append((first, last, match[3]))
+    return ranges
+
+
+def make_properties() -> list[int]:
+    grapheme_breaks = [0] * CODEPOINTS
+    for first, last, value in parse("GraphemeBreakProperty.txt"):
+        for c in range(first, last + 1):
+            grapheme_breaks[c] = GRAPHEME_BREAKS.index(value)
+
+    pictographic = [False] * CODEPOINTS
+    for first, last, value in parse("emoji-data.txt"):
+        if value == "Extended_Pictographic":
+            for c in range(first, last + 1):
+                pictographic[c] = True
+
+    # Wide and fullwidth characters take two cells, like wcwidth
+    widths = [1] * CODEPOINTS
+    for first, last, value in parse("EastAsianWidth.txt"):
+        if value in ("W", "F"):
+            for c in range(first, last + 1):
+                widths[c] = 2
+
+    zero_width = {"CR", "LF", "Control", "Extend", "ZWJ", "V", "T"}
+    properties = []
+    for c in range(CODEPOINTS):
+        grapheme_break = GRAPHEME_BREAKS[grapheme_breaks[c]]
+        # Soft hyphen is a format character, but terminals draw it
+        width = 0 if grapheme_break in zero_width and c != 0xAD else widths[c]
+        properties.append(
+            grapheme_breaks[c]
+            | (PICTOGRAPHIC_BIT if pictographic[c] else 0)
+            | (width << WIDTH_SHIFT)
+        )
+    return properties
+
+
+def make_stages(properties: list[int]) -> tuple[list[int], list[list[int]]]:
+    stage1 = []
+    stage2 = []
+    block_indices = {}
+    for start in range(0, CODEPOINTS, BLOCK_SIZE):
+        block = tuple(properties[start : start + BLOCK_SIZE])
+        if block not in block_indices:
+            block_indices[block] = len(stage2)
+            stage2.append(list(block))
+        stage1.append(block_indices[block])
+    return stage1, stage2
+
+
+def format_array(values: list[int], per_line: int, width: int) -> str:
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append(
+            "    " + ", ".join(f"{v:#0{width}x}" for v in values[i : i + per_line]) + ","
+        )
+    return "\n".join(lines)
+
+
+def main():
+    if "--fetch" in sys.argv:
+        fetch()
+
+    stage1, stage2 = make_stages(make_properties())
+    stage1_type = "uint8_t" if len(stage2) <= 0x100 else "uint16_t"
+    size = len(stage1) * (1 if stage1_type == "uint8_t" else 2) + len(stage2) * BLOCK_SIZE
+
+    out = f"""#pragma once
+
+// Generated with scripts/gen_unicode_tables/main.py from res/ucd, don't edit by hand.
+// {len(stage1)} stage 1 entries, {len(stage2)} stage 2 blocks, {size} bytes.
+
+#include <array>
+#include <cstdint>
+
+namespace unicode::tables {{
+/// Properties of a codepoint c are stage2[stage1[c >> BLOCK_SHIFT]][c & BLOCK_MASK].
+/// Bits 0-3: grapheme cluster break, bit 4: Extended_Pictographic, bits 5-6: width in cells.
+constexpr uint32_t BLOCK_SHIFT = {BLOCK_SHIFT};
+constexpr uint32_t BLOCK_MASK = {BLOCK_SIZE - 1:#x};
+constexpr uint8_t GRAPHEME_BREAK_MASK = 0xf;
+constexpr uint8_t PICTOGRAPHIC_BIT = {PICTOGRAPHIC_BIT:#x};
+constexpr uint8_t WIDTH_SHIFT = {WIDTH_SHIFT};
+
+constexpr std::array<{stage1_type}, {len(stage1)}> STAGE1 = {{
+{format_array(stage1, 16, 4 if stage1_type == "uint8_t" else 6)}
+}};
+
+constexpr std::array<std::array<uint8_t, {BLOCK_SIZE}>, {len(stage2)}> STAGE2 = {{{{
+"""
+    for block in stage2:
+        out += "    {{\n" + format_array(block, 16, 4).replace("    ", "        ") + "\n    }},\n"
+    out += "}};\n} // namespace unicode::tables\n"
+
+    OUTPUT.write_text(out)
+    print(f"Wrote {OUTPUT}: {len(stage2)} blocks, {size} bytes")
+
+
+if __name__ == "__main__":
+    main()
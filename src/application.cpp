@@ -1,28 +1,57 @@
 #include "application.hpp"
 #include "debug_ui.hpp"
 #include "rendering/font.hpp"
+#include "rendering/font_set.hpp"
 #include "rendering/program.hpp"
 #include "rendering/renderer.hpp"
 #include "shaders/text.frag.hpp"
 #include "shaders/text.vert.hpp"
+#include "startup_timer.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 #include "terminal/event_handler.hpp"
 #include "terminal/parser.hpp"
 #include "terminal/parser_setup.hpp"
 #include "terminal/terminal.hpp"
 #include "terminal/thread_safe_queue.hpp"
 #include "utils.hpp"
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <future>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/vector_float3.hpp>
 #include <memory>
+#include <optional>
 #include <spdlog/cfg/env.h>
 #include <spdlog/spdlog.h>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 void Application::start() {
+    StartupTimer startup;
     spdlog::cfg::load_env_levels();
+    Trace::init();
+    Trace::setThreadName("render");
+
+    // The shell initializes while the window and fonts are created, it's forked before any other thread exists
+    if (m_ReplayPath.has_value()) {
+        m_Terminal.openReplay(m_ReplayPath.value(), m_ReplayRealTime,
+                              m_ReplaySeek);
+    } else {
+        m_Terminal.open(Application::WIDTH, Application::HEIGHT);
+        if (const char* recordEnv = std::getenv("YATE_RECORD");
+            recordEnv != nullptr && recordEnv[0] != '\0') {
+            m_Terminal.record(recordEnv);
+        }
+    }
+    startup.mark("shell");
 
     SDL_version sdlVersion;
     SDL_GetVersion(&sdlVersion);
@@ -40,6 +69,7 @@ void Application::start() {
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
                         SDL_GL_CONTEXT_PROFILE_CORE);
+    startup.mark("sdl");
 
     m_Window = SDL_CreateWindow("yate", SDL_WINDOWPOS_UNDEFINED,
                                 SDL_WINDOWPOS_UNDEFINED, Application::WIDTH,
@@ -51,23 +81,100 @@ void Application::start() {
     int realWidth;
     SDL_GL_GetDrawableSize(m_Window, &realWidth, nullptr);
     float contentScale = (float)realWidth / Application::WIDTH;
+    startup.mark("window");
+
+    size_t atlasBudget = Atlas::DEFAULT_BUDGET;
+    const char* atlasBudgetEnv = std::getenv("YATE_ATLAS_BUDGET_MB");
+    if (atlasBudgetEnv != nullptr) {
+        atlasBudget = std::strtoull(atlasBudgetEnv, nullptr, 10) * 1024 * 1024;
+    }
+    GlyphFormat glyphFormat = GlyphFormat::Coverage;
+    const char* glyphFormatEnv = std::getenv("YATE_GLYPH_FORMAT");
+    if (glyphFormatEnv != nullptr && std::strcmp(glyphFormatEnv, "sdf") == 0) {
+        glyphFormat = GlyphFormat::Sdf;
+    }
+    bool shaping = true;
+    const char* ligaturesEnv = std::getenv("YATE_LIGATURES");
+    if (ligaturesEnv != nullptr && std::strcmp(ligaturesEnv, "0") == 0) {
+        shaping = false;
+    }
+
+    // Fonts don't use GL until their first atlas update, so they're loaded while the GL context is created.
+    // The size depends on the content scale, so they can't start before the window exists.
+    const StartupTimer::clock::time_point fontsStart =
+        StartupTimer::clock::now();
+    StartupTimer::clock::time_point fontsEnd;
+    std::future<std::unique_ptr<FontSet>> fontsLoading = std::async(
+        std::launch::async,
+        [contentScale, atlasBudget, glyphFormat, shaping, &fontsEnd]() {
+            auto fonts = std::make_unique<FontSet>(
+                Application::FONT_PATH, 16 * contentScale, atlasBudget,
+                glyphFormat, shaping);
+            fontsEnd = StartupTimer::clock::now();
+            return fonts;
+        });
 
     Renderer renderer(m_Window, contentScale);
-    renderer.setBgColor(glm::vec3(0.10f, 0.11f, 0.15f));
-    Program program(textVertexShader, textFragmentShader);
-    Font font("/usr/share/fonts/TTF/JetBrainsMonoNerdFont-Regular.ttf",
-              16 * contentScale);
+    const char* renderModeEnv = std::getenv("YATE_RENDERER");
+    if (renderModeEnv != nullptr && std::strcmp(renderModeEnv, "grid") == 0) {
+        renderer.setRenderMode(RenderMode::Grid);
+    }
+    FramePacing framePacing = FramePacing::VSync;
+    const char* framePacingEnv = std::getenv("YATE_FRAME_PACING");
+    if (framePacingEnv != nullptr &&
+        std::strcmp(framePacingEnv, "low-latency") == 0) {
+        framePacing = FramePacing::LowLatency;
+    }
+    float frameDeadlineMs =
+        std::chrono::duration<float, std::milli>(FramePacer::DEFAULT_DEADLINE)
+            .count();
+    const char* frameDeadlineEnv = std::getenv("YATE_FRAME_DEADLINE_MS");
+    if (frameDeadlineEnv != nullptr) {
+        frameDeadlineMs =
+            std::max(0.0f, std::strtof(frameDeadlineEnv, nullptr));
+    }
+    startup.mark("renderer");
+
+    Program program(textVertexShader, textFragmentShader,
+                    glyphFormat == GlyphFormat::Sdf
+                        ? std::vector<std::string>{"SDF"}
+                        : std::vector<std::string>{});
+    startup.mark("shaders");
     DebugUI debugUI(m_Window, renderer.getContext());
     EventHandler eventHandler(m_Window);
+    startup.mark("debug ui");
+
+    const std::unique_ptr<FontSet> fontSet = fontsLoading.get();
+    FontSet& fonts = *fontSet;
+    startup.addParallel("fonts", fontsStart, fontsEnd);
+    startup.mark("waiting for fonts");
 
     ThreadSafeQueue<codepoint_t> atlasQueue;
 
-    m_Terminal.open(Application::WIDTH, Application::HEIGHT);
     m_TerminalThread = std::make_unique<std::thread>([this, &atlasQueue]() {
-        Parser parser = parser_setup(m_Window);
+        Trace::setThreadName("terminal");
+        Parser parser = parser_setup(m_Window, m_Terminal);
+        if (const std::optional<ParserState> state =
+                m_Terminal.getRestoredParserState()) {
+            parser.setState(state.value());
+            // The restored cells were never parsed, so their glyphs aren't queued yet
+            std::unordered_set<codepoint_t> codepoints;
+            m_Terminal.getBuf([&codepoints](const TerminalBuf& termBuf) {
+                for (const std::vector<Cell>& row : termBuf.getRows()) {
+                    for (const Cell& cell : row) {
+                        codepoints.insert(cell.character);
+                    }
+                }
+            });
+            for (const codepoint_t c : codepoints) {
+                atlasQueue.push(c);
+            }
+        }
         while (!m_Terminal.shouldClose()) {
             try {
                 std::vector<uint8_t> rawCodes = m_Terminal.read();
+                Stats::add(Counter::BytesRead, rawCodes.size());
+                Trace::counter("bytes read", rawCodes.size());
                 SPDLOG_DEBUG("Read from terminal:");
                 HEXDUMP(rawCodes.data(), rawCodes.size());
 
@@ -84,9 +191,11 @@ void Application::start() {
                                       &parser](TerminalBuf& termBuf) {
                     m_Terminal.getCursorMut([&codepoints, &parser, &rawCodes,
                                              &termBuf](cursor_t& cursor) {
+                        Stats::Timer timer(Counter::ParseNs);
                         codepoints = parser.parse(rawCodes, termBuf, cursor);
                     });
                 });
+                m_Terminal.recordKeyframe(parser.getState());
                 if (codepoints.empty()) {
                     continue;
                 }
@@ -105,25 +214,59 @@ void Application::start() {
     });
 
     // Render loop variables
-    glm::vec3 charsPos(glm::round(-font.getMetricsInPx().max_advance +
-                                  font.getMetricsInPx().max_advance * 0.25),
-                       -font.getMetricsInPx().ascender, 0);
+    const auto getInitialCharsPos = [&fonts]() {
+        const FT_Size_Metrics metrics = fonts.get().getMetricsInPx();
+        const float scale = fonts.getScale();
+        return glm::vec3(glm::round((-metrics.max_advance +
+                                     metrics.max_advance * 0.25) *
+                                    scale),
+                         -metrics.ascender * scale, 0);
+    };
+    glm::vec3 charsPos = getInitialCharsPos();
     float charsScale = 1.0f;
     glm::vec3 cameraPos(0);
     bool wireframe = false;
-    uint64_t prevTime = SDL_GetTicks();
+    RenderMode renderMode = renderer.getRenderMode();
+    CursorStyle cursorStyle = CursorStyle::Block;
+    auto prevTime = std::chrono::steady_clock::now();
     auto debugData = DebugUI::DebugData{.frameTimeMs = 0,
                                         .charsPos = charsPos,
                                         .charsScale = charsScale,
                                         .cameraPos = cameraPos,
-                                        .wireframe = wireframe};
+                                        .wireframe = wireframe,
+                                        .renderMode = renderMode,
+                                        .cursorStyle = cursorStyle,
+                                        .framePacing = framePacing,
+                                        .frameDeadlineMs = frameDeadlineMs};
     std::unordered_set<codepoint_t> codepoints;
     size_t prevRows = 0;
+    Viewport prevViewport = {.firstRow = 0, .rowCount = 0};
+    bool firstFrame = true;
     bool quit = false;
 
     SPDLOG_INFO("Application started");
     while (!quit) {
-        eventHandler.handleEvents(quit, m_Terminal, debugUI);
+        renderer.setFramePacing(
+            framePacing,
+            std::chrono::microseconds((int64_t)(frameDeadlineMs * 1000)));
+        renderer.waitForFrameStart();
+
+        FontZoom zoom = FontZoom::None;
+        eventHandler.handleEvents(quit, zoom, m_Terminal, debugUI);
+        bool zoomed = fonts.zoom(zoom);
+        // New sizes are loaded in the background, the previous size is drawn until then
+        zoomed = fonts.update() || zoomed;
+        if (zoomed) {
+            // The scroll position is recalculated below with the new row height
+            charsPos = getInitialCharsPos();
+            prevRows = 0;
+            // Distance field glyphs are only scaled, so the meshes stay valid
+            if (glyphFormat != GlyphFormat::Sdf) {
+                renderer.invalidateTextMesh();
+            }
+        }
+        Font& font = fonts.get();
+        const float fontScale = fonts.getScale();
         renderer.clear();
         renderer.setWireframe(debugData.wireframe);
 
@@ -135,40 +278,83 @@ void Application::start() {
             }
 
             auto metrics = font.getMetricsInPx();
+            const float height = metrics.height * fontScale;
+            const float ascender = metrics.ascender * fontScale;
             // Also subtract initial charsPos.y
             // Scroll down
-            while (rows * metrics.height - metrics.ascender >
+            while (rows * height - ascender >
                    Application::HEIGHT * contentScale + charsPos.y) {
-                charsPos.y += metrics.height;
+                charsPos.y += height;
             }
 
             // Scroll up
-            while (rows * metrics.height < charsPos.y + metrics.height) {
-                charsPos.y -= metrics.height;
+            while (rows * height < charsPos.y + height) {
+                charsPos.y -= height;
             }
             prevRows = rows;
         });
 
         glm::mat4 transform = glm::scale(
-            glm::translate(glm::mat4(1.0f), charsPos), glm::vec3(charsScale));
+            glm::translate(glm::mat4(1.0f), charsPos),
+            glm::vec3(charsScale * fontScale));
         renderer.setViewMat(glm::translate(glm::mat4(1.0f), cameraPos));
 
+        // Only rows between the top and bottom of the window get a mesh (with one row of margin on each side)
+        const float rowHeight =
+            std::max(1.0f, (float)font.getMetricsInPx().height * charsScale *
+                               fontScale);
+        const float screenHeight = Application::HEIGHT * contentScale;
+        const Viewport viewport = {
+            .firstRow = (size_t)std::max(
+                0.0f, std::floor(charsPos.y / rowHeight) - 1),
+            .rowCount = (size_t)std::ceil(screenHeight / rowHeight) + 3,
+        };
+
         // When new terminal data appears, update font atlas with new glyphs
+        const size_t queueDepth = atlasQueue.size();
+        Stats::add(Counter::QueueDepth, queueDepth);
+        Trace::counter("queue depth", queueDepth);
         codepoint_t c;
         while (atlasQueue.pop(c)) {
             codepoints.insert(c);
         }
-        if (!codepoints.empty()) {
-            font.updateAtlas(codepoints);
-            m_Terminal.getBuf(
-                [&font, &renderer, this](const TerminalBuf& termBuf) {
-                    // TODO: Don't recalculate all
-                    cursor_t cursor = m_Terminal.getCursor();
-                    renderer.makeTextMesh(termBuf.getRows(), cursor, font);
-                });
+        const bool renderModeChanged = renderMode != renderer.getRenderMode();
+        renderer.setRenderMode(renderMode);
+
+        font.nextFrame();
+        renderer.touchPages(font);
+        if (!codepoints.empty() || font.needsAtlasUpdate() ||
+            viewport != prevViewport || renderModeChanged || zoomed) {
+            switch (font.updateAtlas(codepoints)) {
+            case AtlasUpdate::None:
+                break;
+            case AtlasUpdate::Added:
+            case AtlasUpdate::Evicted:
+                // Pages of rows in view were touched above and are never evicted, so only rows drawn with
+                // fallback glyphs (and the glyph table of the cell grid, whose slots were reused) are outdated
+                renderer.invalidateMissingGlyphs();
+                break;
+            }
+            m_Terminal.getBuf([&font, &renderer,
+                               &viewport](const TerminalBuf& termBuf) {
+                Stats::Timer timer(Counter::MeshNs);
+                renderer.makeTextMesh(termBuf, viewport, font);
+            });
             codepoints.clear();
+            prevViewport = viewport;
         }
 
+        m_Terminal.getPalette([&renderer](const Palette& palette) {
+            renderer.updatePalette(palette);
+        });
+
+        // The cursor is polled every frame, it can move without any new glyphs being printed
+        m_Terminal.getBuf([&](const TerminalBuf& termBuf) {
+            Overlay& overlay = renderer.getOverlay();
+            overlay.setCursor(m_Terminal.getCursor(), cursorStyle);
+            overlay.update(termBuf, font);
+        });
+
         // Debug TerminalBuf
         // Terminal::getBuf([&](const TerminalBuf& termBuf) {
         //     const auto& rows = termBuf.getRows();
@@ -189,13 +375,21 @@ void Application::start() {
         //     }
         // });
 
-        renderer.drawText(transform, program);
+        renderer.drawText(transform, program, font);
 
-        debugData.frameTimeMs = SDL_GetTicks() - prevTime;
-        prevTime = SDL_GetTicks();
+        const auto now = std::chrono::steady_clock::now();
+        debugData.frameTimeMs =
+            std::chrono::duration<float, std::milli>(now - prevTime).count();
+        Stats::addSince(Counter::FrameNs, prevTime);
+        prevTime = now;
         debugUI.draw(debugData);
 
-        SDL_GL_SwapWindow(m_Window);
+        renderer.swap();
+        if (firstFrame) {
+            startup.mark("first frame");
+            startup.log();
+            firstFrame = false;
+        }
     }
 }
 
@@ -206,8 +400,16 @@ Application::~Application() {
     assert(m_TerminalThread->joinable());
     m_TerminalThread->join();
     SDL_Quit();
+    Trace::finish();
 }
 
 SDL_Window* Application::getWindow() const {
     return m_Window;
 }
+
+void Application::setReplay(const std::filesystem::path& path,
+                            bool realTime, std::chrono::nanoseconds seek) {
+    m_ReplayPath = path;
+    m_ReplayRealTime = realTime;
+    m_ReplaySeek = seek;
+}
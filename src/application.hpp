@@ -2,7 +2,10 @@
 
 #include "terminal/terminal.hpp"
 #include <SDL.h>
+#include <chrono>
+#include <filesystem>
 #include <memory>
+#include <optional>
 #include <thread>
 
 class Application {
@@ -10,12 +13,20 @@ public:
     void start();
     ~Application();
     SDL_Window* getWindow() const;
+    /// Replays a recording instead of opening a shell, has to be called before start
+    void setReplay(const std::filesystem::path& path, bool realTime,
+                   std::chrono::nanoseconds seek = {});
 
     constexpr static int WIDTH = 1200;
     constexpr static int HEIGHT = 840;
+    constexpr static const char* FONT_PATH =
+        "/usr/share/fonts/TTF/JetBrainsMonoNerdFont-Regular.ttf";
 
 private:
     SDL_Window* m_Window;
     Terminal m_Terminal;
+    std::optional<std::filesystem::path> m_ReplayPath = std::nullopt;
+    bool m_ReplayRealTime = true;
+    std::chrono::nanoseconds m_ReplaySeek = {};
     std::unique_ptr<std::thread> m_TerminalThread;
 };
@@ -1,5 +1,7 @@
 #include "debug_ui.hpp"
 #include "application.hpp"
+#include <algorithm>
+#include <cfloat>
 #include <cstdio>
 #include <cstdlib>
 #include <glm/ext/vector_float3.hpp>
@@ -8,6 +10,64 @@
 #include <imgui_impl_sdl2.h>
 #include <spdlog/spdlog.h>
 
+const std::array<DebugUI::Metric, (size_t)Counter::Count> DebugUI::METRICS = {{
+    {.name = "read",
+     .counter = Counter::BytesRead,
+     .scale = 1.0f / 1024,
+     .unit = "KiB/s",
+     .perSecond = true},
+    {.name = "parse",
+     .counter = Counter::ParseNs,
+     .scale = 1e-6f,
+     .unit = "ms",
+     .perSecond = false},
+    {.name = "cells written",
+     .counter = Counter::CellsWritten,
+     .scale = 1,
+     .unit = "",
+     .perSecond = false},
+    {.name = "mesh",
+     .counter = Counter::MeshNs,
+     .scale = 1e-6f,
+     .unit = "ms",
+     .perSecond = false},
+    {.name = "upload",
+     .counter = Counter::UploadBytes,
+     .scale = 1.0f / 1024,
+     .unit = "KiB",
+     .perSecond = false},
+    {.name = "draw (GPU)",
+     .counter = Counter::DrawGpuNs,
+     .scale = 1e-6f,
+     .unit = "ms",
+     .perSecond = false},
+    {.name = "atlas updates",
+     .counter = Counter::AtlasUpdates,
+     .scale = 1,
+     .unit = "",
+     .perSecond = false},
+    {.name = "glyphs rasterized",
+     .counter = Counter::GlyphsRasterized,
+     .scale = 1,
+     .unit = "",
+     .perSecond = false},
+    {.name = "lock wait",
+     .counter = Counter::LockWaitNs,
+     .scale = 1e-3f,
+     .unit = "us",
+     .perSecond = false},
+    {.name = "queue depth",
+     .counter = Counter::QueueDepth,
+     .scale = 1,
+     .unit = "",
+     .perSecond = false},
+    {.name = "frame",
+     .counter = Counter::FrameNs,
+     .scale = 1e-6f,
+     .unit = "ms",
+     .perSecond = false},
+}};
+
 DebugUI::DebugUI(SDL_Window* window, SDL_GLContext glContext)
     : m_Window(window) {
     IMGUI_CHECKVERSION();
@@ -30,6 +90,7 @@ DebugUI::~DebugUI() {
 }
 
 void DebugUI::draw(DebugUI::DebugData& data) {
+    sample(data.frameTimeMs);
     if (!m_Show) {
         return;
     }
@@ -40,7 +101,7 @@ void DebugUI::draw(DebugUI::DebugData& data) {
 
     {
         char title[64];
-        snprintf(title, 64, "Debug (%f FPS, %lu ms)###DebugWindow",
+        snprintf(title, 64, "Debug (%.0f FPS, %.2f ms)###DebugWindow",
                  1000.0 / data.frameTimeMs, data.frameTimeMs);
 
         ImGui::Begin(title);
@@ -57,6 +118,35 @@ void DebugUI::draw(DebugUI::DebugData& data) {
         ImGui::Separator();
         ImGui::Checkbox("wireframe", &data.wireframe);
 
+        ImGui::SeparatorText("Renderer");
+        int renderMode = (int)data.renderMode;
+        ImGui::RadioButton("mesh", &renderMode, (int)RenderMode::Mesh);
+        ImGui::SameLine();
+        ImGui::RadioButton("grid", &renderMode, (int)RenderMode::Grid);
+        data.renderMode = (RenderMode)renderMode;
+
+        ImGui::SeparatorText("Cursor");
+        int cursorStyle = (int)data.cursorStyle;
+        ImGui::RadioButton("block", &cursorStyle, (int)CursorStyle::Block);
+        ImGui::SameLine();
+        ImGui::RadioButton("bar", &cursorStyle, (int)CursorStyle::Bar);
+        ImGui::SameLine();
+        ImGui::RadioButton("underline", &cursorStyle,
+                           (int)CursorStyle::Underline);
+        data.cursorStyle = (CursorStyle)cursorStyle;
+
+        ImGui::SeparatorText("Frame pacing");
+        int framePacing = (int)data.framePacing;
+        ImGui::RadioButton("vsync", &framePacing, (int)FramePacing::VSync);
+        ImGui::SameLine();
+        ImGui::RadioButton("low latency", &framePacing,
+                           (int)FramePacing::LowLatency);
+        data.framePacing = (FramePacing)framePacing;
+        ImGui::SliderFloat("deadline (ms)###frameDeadline",
+                           &data.frameDeadlineMs, 0.0f, 16.0f);
+
+        drawPerformance();
+
         ImGui::End();
     }
 
@@ -71,3 +161,57 @@ void DebugUI::handleEvent(SDL_Event& event) {
 void DebugUI::toggle() {
     m_Show = !m_Show;
 }
+
+// PRIVATE
+void DebugUI::sample(float frameTimeMs) {
+    const float frameSeconds = frameTimeMs / 1000;
+    for (size_t i = 0; i < METRICS.size(); i++) {
+        const Metric& metric = METRICS[i];
+        float value = Stats::take(metric.counter) * metric.scale;
+        if (metric.perSecond) {
+            value = frameSeconds > 0 ? value / frameSeconds : 0;
+        }
+        m_History[i][m_HistoryPos] = value;
+    }
+    m_HistoryPos = (m_HistoryPos + 1) % HISTORY;
+    m_Samples = std::min(m_Samples + 1, HISTORY);
+}
+
+void DebugUI::drawPerformance() {
+    if (!ImGui::CollapsingHeader("Performance",
+                                 ImGuiTreeNodeFlags_DefaultOpen)) {
+        return;
+    }
+
+    std::vector<float> values;
+    for (size_t i = 0; i < METRICS.size(); i++) {
+        const Metric& metric = METRICS[i];
+        const std::array<float, HISTORY>& history = m_History[i];
+        // Samples which weren't taken yet are zero, they're left out of the percentiles
+        if (m_Samples == HISTORY) {
+            values.assign(history.begin(), history.end());
+        } else {
+            values.assign(history.begin(), history.begin() + m_HistoryPos);
+        }
+        const float p50 = getPercentile(values, 0.5f);
+        const float p99 = getPercentile(values, 0.99f);
+
+        char overlay[64];
+        snprintf(overlay, 64, "p50 %.2f, p99 %.2f %s", p50, p99, metric.unit);
+        char label[64];
+        snprintf(label, 64, "%s###perf%zu", metric.name, i);
+        ImGui::PlotHistogram(label, history.data(), HISTORY, m_HistoryPos,
+                             overlay, 0, FLT_MAX, ImVec2(0, 40));
+    }
+}
+
+// STATIC
+float DebugUI::getPercentile(std::vector<float>& values, float percentile) {
+    if (values.empty()) {
+        return 0;
+    }
+    const size_t n = std::min(values.size() - 1,
+                              (size_t)(percentile * values.size()));
+    std::nth_element(values.begin(), values.begin() + n, values.end());
+    return values[n];
+}
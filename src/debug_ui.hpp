@@ -1,19 +1,28 @@
 #pragma once
 
+#include "rendering/renderer.hpp"
+#include "stats.hpp"
 #include <SDL.h>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <glm/ext/vector_float3.hpp>
 #include <imgui.h>
 #include <imgui_impl_sdl2.h>
+#include <vector>
 
 class DebugUI {
 public:
     struct DebugData {
-        uint64_t frameTimeMs;
+        float frameTimeMs;
         glm::vec3& charsPos;
         float& charsScale;
         glm::vec3& cameraPos;
         bool& wireframe;
+        RenderMode& renderMode;
+        CursorStyle& cursorStyle;
+        FramePacing& framePacing;
+        float& frameDeadlineMs;
     };
 
     DebugUI(SDL_Window* window, SDL_GLContext glContext);
@@ -23,7 +32,34 @@ public:
     void handleEvent(SDL_Event& event);
     void toggle();
 
+    /// Frames kept in the performance histograms
+    constexpr static size_t HISTORY = 240;
+
 private:
+    struct Metric {
+        const char* name;
+        Counter counter;
+        /// Multiplier from the counter's unit to the displayed one
+        float scale;
+        const char* unit;
+        /// Divided by the frame time, instead of shown per frame
+        bool perSecond;
+    };
+
+    /// Takes the counters accumulated during the last frame, also when the UI is hidden
+    void sample(float frameTimeMs);
+    void drawPerformance();
+    /// Reorders values
+    static float getPercentile(std::vector<float>& values, float percentile);
+
+    static const std::array<Metric, (size_t)Counter::Count> METRICS;
+
     bool m_Show;
     SDL_Window* m_Window;
+    /// Ring buffer of samples per metric
+    std::array<std::array<float, HISTORY>, (size_t)Counter::Count> m_History =
+        {};
+    /// Index of the oldest sample, the next one is written there
+    size_t m_HistoryPos = 0;
+    size_t m_Samples = 0;
 };
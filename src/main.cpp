@@ -1,8 +1,35 @@
 #include "application.hpp"
+#include "rendering/glyph_benchmark.hpp"
+#include "rendering/shaping_benchmark.hpp"
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-glyphs") == 0) {
+        return GlyphBenchmark::run(argc >= 3 ? argv[2]
+                                             : Application::FONT_PATH);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-shaping") == 0) {
+        return ShapingBenchmark::run(argc >= 3 ? argv[2]
+                                               : Application::FONT_PATH);
+    }
 
-int main() {
     Application app;
+    if (argc >= 3 && std::strcmp(argv[1], "--replay") == 0) {
+        bool fast = false;
+        double seekSeconds = 0;
+        for (int i = 3; i < argc; i++) {
+            if (std::strcmp(argv[i], "--fast") == 0) {
+                fast = true;
+            } else if (std::strcmp(argv[i], "--seek") == 0 && i + 1 < argc) {
+                seekSeconds = std::atof(argv[++i]);
+            }
+        }
+        app.setReplay(argv[2], !fast,
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::duration<double>(seekSeconds)));
+    }
     app.start();
     return EXIT_SUCCESS;
 }
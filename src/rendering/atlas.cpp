@@ -1,32 +1,186 @@
 #include "atlas.hpp"
+#include "../stats.hpp"
+#include <algorithm>
+#include <spdlog/spdlog.h>
 
 Atlas::~Atlas() {
-    glCall(glDeleteTextures(1, &m_TexId));
+    if (m_TexId != 0) {
+        glCall(glDeleteTextures(1, &m_TexId));
+    }
 }
 
-bool Atlas::initialized() const {
-    return m_TexId != 0;
+void Atlas::setBudget(size_t bytes) {
+    m_MaxPages = std::max<size_t>(bytes / (PAGE_SIZE * PAGE_SIZE), 1);
+    if (m_MaxLayers != 0) {
+        m_MaxPages = std::min(m_MaxPages, m_MaxLayers);
+    }
+    SPDLOG_DEBUG("Atlas budget: {} pages of {}x{}", m_MaxPages, PAGE_SIZE,
+                 PAGE_SIZE);
 }
 
-void Atlas::newTarget(size_t width, size_t height, size_t capacity) {
-    assert(capacity <= CAPACITY);
+void Atlas::pack(std::vector<stbrp_rect>& rects,
+                 std::vector<uint32_t>& pages) {
+    pages.assign(rects.size(), 0);
+    for (stbrp_rect& rect : rects) {
+        rect.was_packed = 0;
+    }
 
-    if (initialized()) {
-        glCall(glDeleteTextures(1, &m_TexId));
+    std::vector<size_t> pending(rects.size());
+    for (size_t i = 0; i < rects.size(); i++) {
+        pending[i] = i;
+    }
+
+    std::vector<stbrp_rect> batch;
+    for (size_t page = 0; !pending.empty(); page++) {
+        const bool newPage = page == m_Pages.size();
+        if (newPage) {
+            if (m_Pages.size() >= m_MaxPages) {
+                break;
+            }
+            addPage();
+        }
+
+        batch.clear();
+        for (const size_t i : pending) {
+            batch.push_back(rects[i]);
+        }
+        stbrp_pack_rects(&m_Pages[page]->context, batch.data(), batch.size());
+
+        std::vector<size_t> remaining;
+        for (size_t j = 0; j < batch.size(); j++) {
+            if (batch[j].was_packed) {
+                rects[pending[j]] = batch[j];
+                pages[pending[j]] = page;
+            } else {
+                remaining.push_back(pending[j]);
+            }
+        }
+
+        // Rects which don't fit into an empty page would never fit
+        if (newPage && remaining.size() == pending.size()) {
+            SPDLOG_ERROR("{} glyphs are larger than an atlas page",
+                         remaining.size());
+            break;
+        }
+        pending = std::move(remaining);
     }
+}
 
-    stbrp_init_target(&m_Context, width, height, m_Nodes, capacity);
-    glCall(glGenTextures(1, &m_TexId));
-    glCall(glBindTexture(GL_TEXTURE_2D, m_TexId));
-    glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-    glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    glCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED,
-                        GL_UNSIGNED_BYTE, nullptr));
+void Atlas::upload(uint32_t page, const stbrp_rect& rect,
+                   const uint8_t* bitmap) {
+    if (page >= m_Layers) {
+        // Doubling keeps the number of copies low, while memory still grows with the number of glyphs
+        size_t layers = std::max<size_t>(m_Layers * 2, 1);
+        while (layers < m_Pages.size()) {
+            layers *= 2;
+        }
+        grow(std::min(layers, std::max(m_MaxPages, m_Pages.size())));
+    }
+    bind();
+    glCall(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, rect.x, rect.y, page,
+                           rect.w, rect.h, 1, GL_RED, GL_UNSIGNED_BYTE,
+                           bitmap));
+    Stats::add(Counter::UploadBytes, (size_t)rect.w * rect.h);
 }
 
-bool Atlas::pack(stbrp_rect rects[], size_t numRects) {
-    const int success = stbrp_pack_rects(&m_Context, rects, numRects);
-    return success == 1;
+void Atlas::touch(uint32_t page, uint64_t frame) {
+    if (page >= m_Pages.size()) {
+        return;
+    }
+    m_Pages[page]->lastUsed = std::max(m_Pages[page]->lastUsed, frame);
+}
+
+std::optional<uint32_t> Atlas::evict(uint64_t frame) {
+    std::optional<uint32_t> lru = std::nullopt;
+    for (uint32_t page = 1; page < m_Pages.size(); page++) {
+        if (m_Pages[page]->lastUsed >= frame) {
+            continue;
+        }
+        if (!lru.has_value() ||
+            m_Pages[page]->lastUsed < m_Pages[lru.value()]->lastUsed) {
+            lru = page;
+        }
+    }
+    if (!lru.has_value()) {
+        return std::nullopt;
+    }
+
+    Page& page = *m_Pages[lru.value()];
+    stbrp_init_target(&page.context, PAGE_SIZE, PAGE_SIZE, page.nodes,
+                      PAGE_SIZE);
+    page.lastUsed = 0;
+    SPDLOG_DEBUG("Evicted atlas page {}", lru.value());
+    return lru;
+}
+
+void Atlas::trim() {
+    m_Pages.resize(std::min<size_t>(m_Pages.size(), 1));
+    if (m_Layers > 1) {
+        grow(1);
+    }
+}
+
+size_t Atlas::getPageCount() const {
+    return m_Pages.size();
+}
+
+void Atlas::bind() const {
+    glCall(glBindTexture(GL_TEXTURE_2D_ARRAY, m_TexId));
+}
+
+// PRIVATE
+void Atlas::addPage() {
+    auto page = std::make_unique<Page>();
+    stbrp_init_target(&page->context, PAGE_SIZE, PAGE_SIZE, page->nodes,
+                      PAGE_SIZE);
+    m_Pages.push_back(std::move(page));
+    SPDLOG_DEBUG("Added atlas page {}", m_Pages.size() - 1);
+}
+
+void Atlas::grow(size_t layers) {
+    if (m_MaxLayers == 0) {
+        // Fonts are created on another thread without a context, so the limit is only queried here
+        GLint maxLayers = 0;
+        glCall(glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers));
+        m_MaxLayers = std::max(maxLayers, 1);
+        m_MaxPages = std::min(m_MaxPages, m_MaxLayers);
+        layers = std::min(layers, m_MaxLayers);
+    }
+
+    GLuint texId = 0;
+    glCall(glGenTextures(1, &texId));
+    glCall(glBindTexture(GL_TEXTURE_2D_ARRAY, texId));
+    glCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                           GL_LINEAR));
+    glCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+                           GL_LINEAR));
+    glCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S,
+                           GL_CLAMP_TO_EDGE));
+    glCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T,
+                           GL_CLAMP_TO_EDGE));
+    glCall(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, PAGE_SIZE, PAGE_SIZE,
+                        layers, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr));
+
+    if (m_TexId != 0) {
+        // Copied on the GPU through a framebuffer, the bitmaps aren't kept on the CPU
+        GLint prevReadFbo = 0;
+        glCall(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prevReadFbo));
+        GLuint fbo = 0;
+        glCall(glGenFramebuffers(1, &fbo));
+        glCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo));
+        for (size_t layer = 0; layer < m_Pages.size(); layer++) {
+            glCall(glFramebufferTextureLayer(GL_READ_FRAMEBUFFER,
+                                             GL_COLOR_ATTACHMENT0, m_TexId, 0,
+                                             layer));
+            glCall(glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0,
+                                       0, PAGE_SIZE, PAGE_SIZE));
+        }
+        glCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, prevReadFbo));
+        glCall(glDeleteFramebuffers(1, &fbo));
+        glCall(glDeleteTextures(1, &m_TexId));
+    }
+
+    m_TexId = texId;
+    m_Layers = layers;
+    SPDLOG_DEBUG("Resized atlas texture to {} layers", layers);
 }
@@ -2,21 +2,56 @@
 
 #include "opengl.hpp"
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <stb_rect_pack.h>
+#include <vector>
 
+/// Glyph bitmaps packed into pages, which are layers of a GL_TEXTURE_2D_ARRAY. Pages are added on demand until
+/// the memory budget is reached, after that the least recently used page has to be evicted to make space.
+/// Only uploading uses GL, the texture grows to fit the pages when a glyph is uploaded to a new one.
 class Atlas {
 public:
     ~Atlas();
 
-    bool initialized() const;
-    void newTarget(size_t width, size_t height, size_t numRects);
-    bool pack(stbrp_rect rects[], size_t numRects);
+    /// Only limits adding new pages, existing pages are kept
+    void setBudget(size_t bytes);
+    /// Packs the rects into pages with free space, adding new pages while the budget allows.
+    /// Packing is incremental, rects are added to the ones already in a page. The page of each rect is written to pages,
+    /// rects which didn't fit have was_packed set to 0.
+    void pack(std::vector<stbrp_rect>& rects, std::vector<uint32_t>& pages);
+    void upload(uint32_t page, const stbrp_rect& rect, const uint8_t* bitmap);
+    /// Marks the page as used in the given frame, pages which don't exist (e.g. of another font's atlas) are ignored
+    void touch(uint32_t page, uint64_t frame);
+    /// Empties the least recently used page which wasn't used in the given frame, so that it can be packed again.
+    /// The first page is never evicted. Returns the evicted page, or nothing if all pages are in use.
+    std::optional<uint32_t> evict(uint64_t frame);
+    /// Drops all pages but the first and shrinks the texture to it, for atlases of fonts which aren't drawn
+    void trim();
+    size_t getPageCount() const;
+    void bind() const;
 
-    static constexpr size_t CAPACITY = 16384;
+    constexpr static size_t PAGE_SIZE = 1024;
+    constexpr static size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
 
 private:
+    struct Page {
+        stbrp_context context;
+        // stb keeps raw pointers to the nodes and to the context itself, so pages are never moved
+        stbrp_node nodes[PAGE_SIZE];
+        uint64_t lastUsed = 0;
+    };
+
+    void addPage();
+    /// Copies the existing pages into a new texture with the given number of layers.
+    /// The first call limits the budget to the layers the GL implementation supports.
+    void grow(size_t layers);
+
     GLuint m_TexId = 0;
-    stbrp_context m_Context;
-    // Can't do it with a vector because stb keeps raw pointers to memory and when resizing a vector they become invalid
-    stbrp_node m_Nodes[CAPACITY];
+    size_t m_Layers = 0;
+    size_t m_MaxPages = DEFAULT_BUDGET / (PAGE_SIZE * PAGE_SIZE);
+    /// GL_MAX_ARRAY_TEXTURE_LAYERS, 0 until the texture is created on the render thread
+    size_t m_MaxLayers = 0;
+    std::vector<std::unique_ptr<Page>> m_Pages;
 };
@@ -0,0 +1,595 @@
+#include "box_drawing.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Indexed by codepoint - 0x2500. Arcs, diagonals and undefined entries have no arms.
+constexpr std::array<BoxDrawing::Lines, 0x80> BoxDrawing::LINES = {{
+    {NONE, LIGHT, NONE, LIGHT, 0}, // ─
+    {NONE, HEAVY, NONE, HEAVY, 0}, // ━
+    {LIGHT, NONE, LIGHT, NONE, 0}, // │
+    {HEAVY, NONE, HEAVY, NONE, 0}, // ┃
+    {NONE, LIGHT, NONE, LIGHT, 3}, // ┄
+    {NONE, HEAVY, NONE, HEAVY, 3}, // ┅
+    {LIGHT, NONE, LIGHT, NONE, 3}, // ┆
+    {HEAVY, NONE, HEAVY, NONE, 3}, // ┇
+    {NONE, LIGHT, NONE, LIGHT, 4}, // ┈
+    {NONE, HEAVY, NONE, HEAVY, 4}, // ┉
+    {LIGHT, NONE, LIGHT, NONE, 4}, // ┊
+    {HEAVY, NONE, HEAVY, NONE, 4}, // ┋
+    {NONE, LIGHT, LIGHT, NONE, 0}, // ┌
+    {NONE, HEAVY, LIGHT, NONE, 0}, // ┍
+    {NONE, LIGHT, HEAVY, NONE, 0}, // ┎
+    {NONE, HEAVY, HEAVY, NONE, 0}, // ┏
+    {NONE, NONE, LIGHT, LIGHT, 0}, // ┐
+    {NONE, NONE, LIGHT, HEAVY, 0}, // ┑
+    {NONE, NONE, HEAVY, LIGHT, 0}, // ┒
+    {NONE, NONE, HEAVY, HEAVY, 0}, // ┓
+    {LIGHT, LIGHT, NONE, NONE, 0}, // └
+    {LIGHT, HEAVY, NONE, NONE, 0}, // ┕
+    {HEAVY, LIGHT, NONE, NONE, 0}, // ┖
+    {HEAVY, HEAVY, NONE, NONE, 0}, // ┗
+    {LIGHT, NONE, NONE, LIGHT, 0}, // ┘
+    {LIGHT, NONE, NONE, HEAVY, 0}, // ┙
+    {HEAVY, NONE, NONE, LIGHT, 0}, // ┚
+    {HEAVY, NONE, NONE, HEAVY, 0}, // ┛
+    {LIGHT, LIGHT, LIGHT, NONE, 0}, // ├
+    {LIGHT, HEAVY, LIGHT, NONE, 0}, // ┝
+    {HEAVY, LIGHT, LIGHT, NONE, 0}, // ┞
+    {LIGHT, LIGHT, HEAVY, NONE, 0}, // ┟
+    {HEAVY, LIGHT, HEAVY, NONE, 0}, // ┠
+    {HEAVY, HEAVY, LIGHT, NONE, 0}, // ┡
+    {LIGHT, HEAVY, HEAVY, NONE, 0}, // ┢
+    {HEAVY, HEAVY, HEAVY, NONE, 0}, // ┣
+    {LIGHT, NONE, LIGHT, LIGHT, 0}, // ┤
+    {LIGHT, NONE, LIGHT, HEAVY, 0}, // ┥
+    {HEAVY, NONE, LIGHT, LIGHT, 0}, // ┦
+    {LIGHT, NONE, HEAVY, LIGHT, 0}, // ┧
+    {HEAVY, NONE, HEAVY, LIGHT, 0}, // ┨
+    {HEAVY, NONE, LIGHT, HEAVY, 0}, // ┩
+    {LIGHT, NONE, HEAVY, HEAVY, 0}, // ┪
+    {HEAVY, NONE, HEAVY, HEAVY, 0}, // ┫
+    {NONE, LIGHT, LIGHT, LIGHT, 0}, // ┬
+    {NONE, LIGHT, LIGHT, HEAVY, 0}, // ┭
+    {NONE, HEAVY, LIGHT, LIGHT, 0}, // ┮
+    {NONE, HEAVY, LIGHT, HEAVY, 0}, // ┯
+    {NONE, LIGHT, HEAVY, LIGHT, 0}, // ┰
+    {NONE, LIGHT, HEAVY, HEAVY, 0}, // ┱
+    {NONE, HEAVY, HEAVY, LIGHT, 0}, // ┲
+    {NONE, HEAVY, HEAVY, HEAVY, 0}, // ┳
+    {LIGHT, LIGHT, NONE, LIGHT, 0}, // ┴
+    {LIGHT, LIGHT, NONE, HEAVY, 0}, // ┵
+    {LIGHT, HEAVY, NONE, LIGHT, 0}, // ┶
+    {LIGHT, HEAVY, NONE, HEAVY, 0}, // ┷
+    {HEAVY, LIGHT, NONE, LIGHT, 0}, // ┸
+    {HEAVY, LIGHT, NONE, HEAVY, 0}, // ┹
+    {HEAVY, HEAVY, NONE, LIGHT, 0}, // ┺
+    {HEAVY, HEAVY, NONE, HEAVY, 0}, // ┻
+    {LIGHT, LIGHT, LIGHT, LIGHT, 0}, // ┼
+    {LIGHT, LIGHT, LIGHT, HEAVY, 0}, // ┽
+    {LIGHT, HEAVY, LIGHT, LIGHT, 0}, // ┾
+    {LIGHT, HEAVY, LIGHT, HEAVY, 0}, // ┿
+    {HEAVY, LIGHT, LIGHT, LIGHT, 0}, // ╀
+    {LIGHT, LIGHT, HEAVY, LIGHT, 0}, // ╁
+    {HEAVY, LIGHT, HEAVY, LIGHT, 0}, // ╂
+    {HEAVY, LIGHT, LIGHT, HEAVY, 0}, // ╃
+    {HEAVY, HEAVY, LIGHT, LIGHT, 0}, // ╄
+    {LIGHT, LIGHT, HEAVY, HEAVY, 0}, // ╅
+    {LIGHT, HEAVY, HEAVY, LIGHT, 0}, // ╆
+    {HEAVY, HEAVY, LIGHT, HEAVY, 0}, // ╇
+    {LIGHT, HEAVY, HEAVY, HEAVY, 0}, // ╈
+    {HEAVY, LIGHT, HEAVY, HEAVY, 0}, // ╉
+    {HEAVY, HEAVY, HEAVY, LIGHT, 0}, // ╊
+    {HEAVY, HEAVY, HEAVY, HEAVY, 0}, // ╋
+    {NONE, LIGHT, NONE, LIGHT, 2}, // ╌
+    {NONE, HEAVY, NONE, HEAVY, 2}, // ╍
+    {LIGHT, NONE, LIGHT, NONE, 2}, // ╎
+    {HEAVY, NONE, HEAVY, NONE, 2}, // ╏
+    {NONE, DOUBLE, NONE, DOUBLE, 0}, // ═
+    {DOUBLE, NONE, DOUBLE, NONE, 0}, // ║
+    {NONE, DOUBLE, LIGHT, NONE, 0}, // ╒
+    {NONE, LIGHT, DOUBLE, NONE, 0}, // ╓
+    {NONE, DOUBLE, DOUBLE, NONE, 0}, // ╔
+    {NONE, NONE, LIGHT, DOUBLE, 0}, // ╕
+    {NONE, NONE, DOUBLE, LIGHT, 0}, // ╖
+    {NONE, NONE, DOUBLE, DOUBLE, 0}, // ╗
+    {LIGHT, DOUBLE, NONE, NONE, 0}, // ╘
+    {DOUBLE, LIGHT, NONE, NONE, 0}, // ╙
+    {DOUBLE, DOUBLE, NONE, NONE, 0}, // ╚
+    {LIGHT, NONE, NONE, DOUBLE, 0}, // ╛
+    {DOUBLE, NONE, NONE, LIGHT, 0}, // ╜
+    {DOUBLE, NONE, NONE, DOUBLE, 0}, // ╝
+    {LIGHT, DOUBLE, LIGHT, NONE, 0}, // ╞
+    {DOUBLE, LIGHT, DOUBLE, NONE, 0}, // ╟
+    {DOUBLE, DOUBLE, DOUBLE, NONE, 0}, // ╠
+    {LIGHT, NONE, LIGHT, DOUBLE, 0}, // ╡
+    {DOUBLE, NONE, DOUBLE, LIGHT, 0}, // ╢
+    {DOUBLE, NONE, DOUBLE, DOUBLE, 0}, // ╣
+    {NONE, DOUBLE, LIGHT, DOUBLE, 0}, // ╤
+    {NONE, LIGHT, DOUBLE, LIGHT, 0}, // ╥
+    {NONE, DOUBLE, DOUBLE, DOUBLE, 0}, // ╦
+    {LIGHT, DOUBLE, NONE, DOUBLE, 0}, // ╧
+    {DOUBLE, LIGHT, NONE, LIGHT, 0}, // ╨
+    {DOUBLE, DOUBLE, NONE, DOUBLE, 0}, // ╩
+    {LIGHT, DOUBLE, LIGHT, DOUBLE, 0}, // ╪
+    {DOUBLE, LIGHT, DOUBLE, LIGHT, 0}, // ╫
+    {DOUBLE, DOUBLE, DOUBLE, DOUBLE, 0}, // ╬
+    {NONE, NONE, NONE, NONE, 0}, // ╭
+    {NONE, NONE, NONE, NONE, 0}, // ╮
+    {NONE, NONE, NONE, NONE, 0}, // ╯
+    {NONE, NONE, NONE, NONE, 0}, // ╰
+    {NONE, NONE, NONE, NONE, 0}, // ╱
+    {NONE, NONE, NONE, NONE, 0}, // ╲
+    {NONE, NONE, NONE, NONE, 0}, // ╳
+    {NONE, NONE, NONE, LIGHT, 0}, // ╴
+    {LIGHT, NONE, NONE, NONE, 0}, // ╵
+    {NONE, LIGHT, NONE, NONE, 0}, // ╶
+    {NONE, NONE, LIGHT, NONE, 0}, // ╷
+    {NONE, NONE, NONE, HEAVY, 0}, // ╸
+    {HEAVY, NONE, NONE, NONE, 0}, // ╹
+    {NONE, HEAVY, NONE, NONE, 0}, // ╺
+    {NONE, NONE, HEAVY, NONE, 0}, // ╻
+    {NONE, HEAVY, NONE, LIGHT, 0}, // ╼
+    {LIGHT, NONE, HEAVY, NONE, 0}, // ╽
+    {NONE, LIGHT, NONE, HEAVY, 0}, // ╾
+    {HEAVY, NONE, LIGHT, NONE, 0}, // ╿
+}};
+
+bool BoxDrawing::isProcedural(codepoint_t codepoint) {
+    return (codepoint >= 0x2500 && codepoint <= 0x259f) ||
+           (codepoint >= 0xe0b0 && codepoint <= 0xe0b7);
+}
+
+std::optional<RasterizedGlyph> BoxDrawing::render(codepoint_t codepoint,
+                                                  uint32_t width,
+                                                  uint32_t height,
+                                                  int32_t descender) {
+    if (!isProcedural(codepoint) || width == 0 || height == 0) {
+        return std::nullopt;
+    }
+
+    Canvas canvas(width, height);
+    if (codepoint >= 0xe0b0) {
+        drawPowerline(canvas, codepoint);
+    } else if (codepoint >= 0x2580) {
+        drawBlock(canvas, codepoint);
+    } else if (codepoint >= 0x256d && codepoint <= 0x2570) {
+        drawArc(canvas, codepoint);
+    } else if (codepoint >= 0x2571 && codepoint <= 0x2573) {
+        drawDiagonal(canvas, codepoint);
+    } else if (const Lines& lines = LINES[codepoint - 0x2500];
+               lines.dashes > 0) {
+        drawDashes(canvas, lines);
+    } else {
+        drawLines(canvas, lines);
+    }
+
+    // The quad covers the whole row, from the descender to the top of the line
+    FT_Glyph_Metrics metrics = {};
+    metrics.width = width * 64;
+    metrics.height = height * 64;
+    metrics.horiBearingX = 0;
+    metrics.horiBearingY = ((int32_t)height + descender) * 64;
+    metrics.horiAdvance = width * 64;
+    return RasterizedGlyph{
+        .codepoint = codepoint,
+        .metrics = metrics,
+        .width = width,
+        .height = height,
+        .bitmap = std::move(canvas.pixels),
+    };
+}
+
+// PRIVATE
+BoxDrawing::Canvas::Canvas(uint32_t cellWidth, uint32_t cellHeight)
+    : width(cellWidth), height(cellHeight),
+      pixels((size_t)cellWidth * cellHeight, 0) {}
+
+void BoxDrawing::Canvas::fill(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                              uint8_t value) {
+    x0 = std::clamp<int32_t>(x0, 0, width);
+    x1 = std::clamp<int32_t>(x1, 0, width);
+    y0 = std::clamp<int32_t>(y0, 0, height);
+    y1 = std::clamp<int32_t>(y1, 0, height);
+    for (int32_t y = y0; y < y1; y++) {
+        std::fill(pixels.begin() + y * width + x0,
+                  pixels.begin() + y * width + x1, value);
+    }
+}
+
+void BoxDrawing::Canvas::line(float x0, float y0, float x1, float y1,
+                              float thickness) {
+    const float dx = x1 - x0;
+    const float dy = y1 - y0;
+    const float lengthSq = dx * dx + dy * dy;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const float px = x + 0.5f;
+            const float py = y + 0.5f;
+            const float t = std::clamp(
+                ((px - x0) * dx + (py - y0) * dy) / lengthSq, 0.0f, 1.0f);
+            const float distance =
+                std::hypot(px - (x0 + t * dx), py - (y0 + t * dy));
+            blend(x, y, thickness / 2 + 0.5f - distance);
+        }
+    }
+}
+
+void BoxDrawing::Canvas::arc(float cx, float cy, float radius, float dx,
+                             float dy, float thickness) {
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const float vx = x + 0.5f - cx;
+            const float vy = y + 0.5f - cy;
+            if (vx * dx < 0 || vy * dy < 0) {
+                continue;
+            }
+            const float distance = std::abs(std::hypot(vx, vy) - radius);
+            blend(x, y, thickness / 2 + 0.5f - distance);
+        }
+    }
+}
+
+template <typename F> void BoxDrawing::Canvas::fillShape(F inside) {
+    constexpr int SAMPLES = 4;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            int covered = 0;
+            for (int sy = 0; sy < SAMPLES; sy++) {
+                for (int sx = 0; sx < SAMPLES; sx++) {
+                    covered += inside(x + (sx + 0.5f) / SAMPLES,
+                                      y + (sy + 0.5f) / SAMPLES)
+                                   ? 1
+                                   : 0;
+                }
+            }
+            blend(x, y, (float)covered / (SAMPLES * SAMPLES));
+        }
+    }
+}
+
+void BoxDrawing::Canvas::blend(int32_t x, int32_t y, float coverage) {
+    uint8_t& pixel = pixels[y * width + x];
+    const uint8_t value =
+        (uint8_t)std::lround(std::clamp(coverage, 0.0f, 1.0f) * 255);
+    pixel = std::max(pixel, value);
+}
+
+void BoxDrawing::drawLines(Canvas& canvas, const Lines& lines) {
+    const int32_t w = canvas.width;
+    const int32_t h = canvas.height;
+    const int32_t t = getThickness(canvas, LIGHT);
+    // Double lines are two light lines with a light line wide gap, a and b are their left and top edges
+    const int32_t a = (w - 3 * t) / 2;
+    const int32_t b = (h - 3 * t) / 2;
+
+    const bool upDouble = lines.up == DOUBLE;
+    const bool downDouble = lines.down == DOUBLE;
+    const bool leftDouble = lines.left == DOUBLE;
+    const bool rightDouble = lines.right == DOUBLE;
+    const bool vertical = lines.up != NONE || lines.down != NONE;
+    const bool horizontal = lines.left != NONE || lines.right != NONE;
+
+    // Extent of the widest single line crossing the center, which arms of the other axis have to reach
+    const int32_t vThickness = std::max(getThickness(canvas, lines.up),
+                                        getThickness(canvas, lines.down));
+    const int32_t hThickness = std::max(getThickness(canvas, lines.left),
+                                        getThickness(canvas, lines.right));
+    const int32_t vLo = (w - vThickness) / 2;
+    const int32_t vHi = vLo + vThickness;
+    const int32_t hLo = (h - hThickness) / 2;
+    const int32_t hHi = hLo + hThickness;
+
+    // Horizontal arms
+    for (const bool left : {true, false}) {
+        const Weight weight = left ? lines.left : lines.right;
+        if (weight == NONE) {
+            continue;
+        }
+        const auto span = [&](int32_t end, int32_t start) {
+            return left ? std::pair(0, end) : std::pair(start, w);
+        };
+
+        if (weight == DOUBLE) {
+            // Each of the two lines either turns into the near vertical line, reaches around to the far one,
+            // or meets a single vertical line
+            const auto lineSpan = [&](bool nearDouble, bool farDouble) {
+                if (nearDouble) {
+                    return span(a + t, a + 2 * t);
+                } else if (farDouble) {
+                    return span(a + 3 * t, a);
+                } else if (vertical) {
+                    return span(vHi, vLo);
+                }
+                return span(w / 2, w / 2);
+            };
+            const auto [x0, x1] = lineSpan(upDouble, downDouble);
+            canvas.fill(x0, b, x1, b + t);
+            const auto [x2, x3] = lineSpan(downDouble, upDouble);
+            canvas.fill(x2, b + 2 * t, x3, b + 3 * t);
+            continue;
+        }
+
+        const int32_t th = getThickness(canvas, weight);
+        const int32_t y0 = (h - th) / 2;
+        std::pair<int32_t, int32_t> x;
+        if (upDouble || downDouble) {
+            // Goes through the gap when the line continues or the double line ends here
+            const bool through = upDouble != downDouble ||
+                                 (left ? lines.right : lines.left) != NONE;
+            x = through ? span(a + 3 * t, a) : span(a + t, a + 2 * t);
+        } else if (vertical) {
+            x = span(vHi, vLo);
+        } else {
+            x = span((w - th) / 2 + th, (w - th) / 2);
+        }
+        canvas.fill(x.first, y0, x.second, y0 + th);
+    }
+
+    // Vertical arms
+    for (const bool up : {true, false}) {
+        const Weight weight = up ? lines.up : lines.down;
+        if (weight == NONE) {
+            continue;
+        }
+        const auto span = [&](int32_t end, int32_t start) {
+            return up ? std::pair(0, end) : std::pair(start, h);
+        };
+
+        if (weight == DOUBLE) {
+            const auto lineSpan = [&](bool nearDouble, bool farDouble) {
+                if (nearDouble) {
+                    return span(b + t, b + 2 * t);
+                } else if (farDouble) {
+                    return span(b + 3 * t, b);
+                } else if (horizontal) {
+                    return span(hHi, hLo);
+                }
+                return span(h / 2, h / 2);
+            };
+            const auto [y0, y1] = lineSpan(leftDouble, rightDouble);
+            canvas.fill(a, y0, a + t, y1);
+            const auto [y2, y3] = lineSpan(rightDouble, leftDouble);
+            canvas.fill(a + 2 * t, y2, a + 3 * t, y3);
+            continue;
+        }
+
+        const int32_t th = getThickness(canvas, weight);
+        const int32_t x0 = (w - th) / 2;
+        std::pair<int32_t, int32_t> y;
+        if (leftDouble || rightDouble) {
+            const bool through = leftDouble != rightDouble ||
+                                 (up ? lines.down : lines.up) != NONE;
+            y = through ? span(b + 3 * t, b) : span(b + t, b + 2 * t);
+        } else if (horizontal) {
+            y = span(hHi, hLo);
+        } else {
+            y = span((h - th) / 2 + th, (h - th) / 2);
+        }
+        canvas.fill(x0, y.first, x0 + th, y.second);
+    }
+}
+
+void BoxDrawing::drawDashes(Canvas& canvas, const Lines& lines) {
+    const bool horizontal = lines.left != NONE;
+    const int32_t th =
+        getThickness(canvas, horizontal ? lines.left : lines.up);
+    const int32_t length = horizontal ? canvas.width : canvas.height;
+    const float segment = (float)length / lines.dashes;
+    const int32_t gap = std::max<int32_t>(1, std::lround(segment / 4));
+
+    for (uint8_t i = 0; i < lines.dashes; i++) {
+        // Gaps are split between both ends, so dashes of neighbouring cells are evenly spaced
+        const int32_t start = std::lround(i * segment) + gap / 2;
+        const int32_t end = std::lround((i + 1) * segment) - (gap - gap / 2);
+        if (horizontal) {
+            const int32_t y0 = (canvas.height - th) / 2;
+            canvas.fill(start, y0, end, y0 + th);
+        } else {
+            const int32_t x0 = (canvas.width - th) / 2;
+            canvas.fill(x0, start, x0 + th, end);
+        }
+    }
+}
+
+void BoxDrawing::drawArc(Canvas& canvas, codepoint_t codepoint) {
+    // Direction of the arms: ╭ down and right, ╮ down and left, ╯ up and left, ╰ up and right
+    const int32_t sx = codepoint == 0x256d || codepoint == 0x2570 ? 1 : -1;
+    const int32_t sy = codepoint == 0x256d || codepoint == 0x256e ? 1 : -1;
+
+    const int32_t t = getThickness(canvas, LIGHT);
+    const int32_t x0 = ((int32_t)canvas.width - t) / 2;
+    const int32_t y0 = ((int32_t)canvas.height - t) / 2;
+    const float lineX = x0 + t / 2.0f;
+    const float lineY = y0 + t / 2.0f;
+    const float radius = std::min(sx > 0 ? canvas.width - lineX : lineX,
+                                  sy > 0 ? canvas.height - lineY : lineY);
+    const float cx = lineX + sx * radius;
+    const float cy = lineY + sy * radius;
+    canvas.arc(cx, cy, radius, -sx, -sy, t);
+
+    // Straight parts between the arc and the edges of the cell
+    const int32_t arcX = std::lround(cx);
+    const int32_t arcY = std::lround(cy);
+    if (sx > 0) {
+        canvas.fill(arcX, y0, canvas.width, y0 + t);
+    } else {
+        canvas.fill(0, y0, arcX, y0 + t);
+    }
+    if (sy > 0) {
+        canvas.fill(x0, arcY, x0 + t, canvas.height);
+    } else {
+        canvas.fill(x0, 0, x0 + t, arcY);
+    }
+}
+
+void BoxDrawing::drawDiagonal(Canvas& canvas, codepoint_t codepoint) {
+    const float w = canvas.width;
+    const float h = canvas.height;
+    const float t = getThickness(canvas, LIGHT);
+    if (codepoint == 0x2571 || codepoint == 0x2573) {
+        canvas.line(w, 0, 0, h, t);
+    }
+    if (codepoint == 0x2572 || codepoint == 0x2573) {
+        canvas.line(0, 0, w, h, t);
+    }
+}
+
+void BoxDrawing::drawBlock(Canvas& canvas, codepoint_t codepoint) {
+    const int32_t w = canvas.width;
+    const int32_t h = canvas.height;
+    // Halves and quadrants split the cell at the same point, so that they tile
+    const int32_t mx = w / 2;
+    const int32_t my = h / 2;
+    const auto lower = [&](int eighths) {
+        canvas.fill(0, h - std::lround(h * eighths / 8.0), w, h);
+    };
+    const auto left = [&](int eighths) {
+        canvas.fill(0, 0, std::lround(w * eighths / 8.0), h);
+    };
+    enum Quadrant : uint8_t { UL = 1, UR = 2, LL = 4, LR = 8 };
+    const auto quadrants = [&](uint8_t mask) {
+        if (mask & UL) {
+            canvas.fill(0, 0, mx, my);
+        }
+        if (mask & UR) {
+            canvas.fill(mx, 0, w, my);
+        }
+        if (mask & LL) {
+            canvas.fill(0, my, mx, h);
+        }
+        if (mask & LR) {
+            canvas.fill(mx, my, w, h);
+        }
+    };
+
+    switch (codepoint) {
+    case 0x2580: // ▀
+        quadrants(UL | UR);
+        break;
+    case 0x2584: // ▄
+        quadrants(LL | LR);
+        break;
+    case 0x2588: // █
+        canvas.fill(0, 0, w, h);
+        break;
+    case 0x258c: // ▌
+        quadrants(UL | LL);
+        break;
+    case 0x2590: // ▐
+        quadrants(UR | LR);
+        break;
+    case 0x2591: // ░
+        canvas.fill(0, 0, w, h, 0x40);
+        break;
+    case 0x2592: // ▒
+        canvas.fill(0, 0, w, h, 0x80);
+        break;
+    case 0x2593: // ▓
+        canvas.fill(0, 0, w, h, 0xc0);
+        break;
+    case 0x2594: // ▔
+        canvas.fill(0, 0, w, std::lround(h / 8.0));
+        break;
+    case 0x2595: // ▕
+        canvas.fill(w - std::lround(w / 8.0), 0, w, h);
+        break;
+    case 0x2596: // ▖
+        quadrants(LL);
+        break;
+    case 0x2597: // ▗
+        quadrants(LR);
+        break;
+    case 0x2598: // ▘
+        quadrants(UL);
+        break;
+    case 0x2599: // ▙
+        quadrants(UL | LL | LR);
+        break;
+    case 0x259a: // ▚
+        quadrants(UL | LR);
+        break;
+    case 0x259b: // ▛
+        quadrants(UL | UR | LL);
+        break;
+    case 0x259c: // ▜
+        quadrants(UL | UR | LR);
+        break;
+    case 0x259d: // ▝
+        quadrants(UR);
+        break;
+    case 0x259e: // ▞
+        quadrants(UR | LL);
+        break;
+    case 0x259f: // ▟
+        quadrants(UR | LL | LR);
+        break;
+    default:
+        if (codepoint >= 0x2581 && codepoint <= 0x2587) {
+            // ▁ to ▇, lower eighths
+            lower(codepoint - 0x2580);
+        } else if (codepoint >= 0x2589 && codepoint <= 0x258f) {
+            // ▉ to ▏, left eighths
+            left(0x2590 - codepoint);
+        }
+        break;
+    }
+}
+
+void BoxDrawing::drawPowerline(Canvas& canvas, codepoint_t codepoint) {
+    const float w = canvas.width;
+    const float h = canvas.height;
+    const float t = getThickness(canvas, LIGHT);
+    // Right pointing symbols are mirrored to get the left pointing ones
+    const bool mirror = codepoint == 0xe0b2 || codepoint == 0xe0b3 ||
+                        codepoint == 0xe0b6 || codepoint == 0xe0b7;
+    const auto fromTip = [=](float x) { return mirror ? w - x : x; };
+    // Half ellipse with the flat side on the edge of the cell
+    const auto inEllipse = [=](float x, float y, float rx, float ry) {
+        const float nx = fromTip(x) / rx;
+        const float ny = (y - h / 2) / ry;
+        return nx * nx + ny * ny <= 1;
+    };
+
+    switch (codepoint) {
+    case 0xe0b0: //  
+    case 0xe0b2: //  
+        canvas.fillShape([=](float x, float y) {
+            return fromTip(x) <= w * (1 - std::abs(2 * y / h - 1));
+        });
+        break;
+    case 0xe0b1: //  
+    case 0xe0b3: //  
+        canvas.line(fromTip(0), 0, fromTip(w), h / 2, t);
+        canvas.line(fromTip(w), h / 2, fromTip(0), h, t);
+        break;
+    case 0xe0b4: //  
+    case 0xe0b6: //  
+        canvas.fillShape([=](float x, float y) {
+            return inEllipse(x, y, w, h / 2);
+        });
+        break;
+    case 0xe0b5: //  
+    case 0xe0b7: //  
+        canvas.fillShape([=](float x, float y) {
+            return inEllipse(x, y, w, h / 2) &&
+                   !inEllipse(x, y, w - t, h / 2 - t);
+        });
+        break;
+    }
+}
+
+uint32_t BoxDrawing::getThickness(const Canvas& canvas, Weight weight) {
+    // Scales with the font size, one pixel at regular sizes
+    const uint32_t light =
+        std::max<uint32_t>(1, std::lround(canvas.width / 10.0));
+    switch (weight) {
+    case NONE:
+        return 0;
+    case LIGHT:
+    case DOUBLE:
+        return light;
+    case HEAVY:
+        return light * 2;
+    }
+    return light;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "../terminal/unicode.hpp"
+#include "glyph_rasterizer.hpp"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/// Box drawing (U+2500-257F), block elements (U+2580-259F) and powerline symbols (U+E0B0-E0B7) drawn
+/// at the exact cell size instead of being rasterized from the font, so that they line up without seams between cells.
+/// Lines are described by a table of arm weights, everything else is drawn by hand.
+class BoxDrawing {
+public:
+    static bool isProcedural(codepoint_t codepoint);
+    /// Glyph covering the whole cell, the bottom of the bitmap is at the descender.
+    /// Returns nothing for codepoints which aren't drawn procedurally.
+    static std::optional<RasterizedGlyph>
+    render(codepoint_t codepoint, uint32_t width, uint32_t height,
+           int32_t descender);
+
+private:
+    /// Weight of a line going from the center of the cell to one of its edges
+    enum Weight : uint8_t {
+        NONE = 0,
+        LIGHT = 1,
+        HEAVY = 2,
+        DOUBLE = 3,
+    };
+    struct Lines {
+        Weight up, right, down, left;
+        /// Dashed lines have the same weight on two opposite arms
+        uint8_t dashes = 0;
+    };
+
+    class Canvas {
+    public:
+        Canvas(uint32_t cellWidth, uint32_t cellHeight);
+
+        /// Fills [x0, x1) x [y0, y1), clipped to the canvas
+        void fill(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                  uint8_t value = 0xff);
+        /// Antialiased stroke of a line segment
+        void line(float x0, float y0, float x1, float y1, float thickness);
+        /// Antialiased stroke of a quarter circle, dx and dy point from the center to the quadrant
+        void arc(float cx, float cy, float radius, float dx, float dy,
+                 float thickness);
+        /// Supersampled fill of the area where inside(x, y) is true
+        template <typename F> void fillShape(F inside);
+
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> pixels;
+
+    private:
+        void blend(int32_t x, int32_t y, float coverage);
+    };
+
+    static void drawLines(Canvas& canvas, const Lines& lines);
+    static void drawDashes(Canvas& canvas, const Lines& lines);
+    static void drawArc(Canvas& canvas, codepoint_t codepoint);
+    static void drawDiagonal(Canvas& canvas, codepoint_t codepoint);
+    static void drawBlock(Canvas& canvas, codepoint_t codepoint);
+    static void drawPowerline(Canvas& canvas, codepoint_t codepoint);
+    static uint32_t getThickness(const Canvas& canvas, Weight weight);
+
+    static const std::array<Lines, 0x80> LINES;
+};
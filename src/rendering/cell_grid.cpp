@@ -0,0 +1,260 @@
+#include "cell_grid.hpp"
+#include "../stats.hpp"
+#include "../terminal/codes.hpp"
+#include "opengl.hpp"
+#include "palette_texture.hpp"
+#include "shaders/grid.frag.hpp"
+#include "shaders/grid.vert.hpp"
+#include <algorithm>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/matrix.hpp>
+#include <spdlog/spdlog.h>
+
+CellGrid::CellGrid(GlyphFormat format)
+    : m_Program(gridVertexShader, gridFragmentShader,
+                format == GlyphFormat::Sdf ? std::vector<std::string>{"SDF"}
+                                           : std::vector<std::string>{}) {
+    // Units 1 and 2 are used, so that the atlas stays bound to unit 0 for the mesh renderer
+    GLuint* textures[] = {&m_CellsTexId, &m_GlyphsTexId};
+    for (GLuint unit = 1; GLuint* texId : textures) {
+        glCall(glGenTextures(1, texId));
+        glCall(glActiveTexture(GL_TEXTURE0 + unit));
+        glCall(glBindTexture(GL_TEXTURE_2D, *texId));
+        // Integer textures can't be filtered
+        glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                               GL_NEAREST));
+        glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+                               GL_NEAREST));
+        unit++;
+    }
+    glCall(glActiveTexture(GL_TEXTURE0));
+
+    SPDLOG_DEBUG("Created cell grid");
+}
+
+CellGrid::~CellGrid() {
+    glCall(glDeleteTextures(1, &m_CellsTexId));
+    glCall(glDeleteTextures(1, &m_GlyphsTexId));
+    SPDLOG_DEBUG("Deleted cell grid");
+}
+
+std::vector<size_t> CellGrid::update(const TerminalBuf& termBuf,
+                                     const Viewport& viewport,
+                                     Font& font) {
+    const auto& rows = termBuf.getRows();
+    const size_t firstRow = std::min(viewport.firstRow, rows.size());
+    const size_t endRow =
+        std::min(viewport.firstRow + viewport.rowCount, rows.size());
+
+    if (!m_GlyphTableValid) {
+        uploadGlyphTable(font);
+    }
+
+    const auto isStale = [&](size_t y) {
+        if (m_RowSlots.empty()) {
+            return true;
+        }
+        const RowSlot& slot = m_RowSlots[y % m_RowSlots.size()];
+        return !slot.valid || slot.row != y ||
+               slot.version != termBuf.getRowVersion(y);
+    };
+
+    std::vector<size_t> staleRows;
+    size_t requiredCols = 0;
+    for (size_t y = firstRow; y < endRow; y++) {
+        if (isStale(y)) {
+            staleRows.push_back(y);
+            requiredCols = std::max(requiredCols, countColumns(rows[y]));
+        }
+    }
+
+    if (viewport.rowCount > m_Rows || requiredCols > m_Cols) {
+        size_t cols = std::max<size_t>(m_Cols, 128);
+        for (size_t y = firstRow; y < endRow; y++) {
+            while (cols < countColumns(rows[y])) {
+                cols *= 2;
+            }
+        }
+        resize(cols, viewport.rowCount);
+
+        staleRows.clear();
+        for (size_t y = firstRow; y < endRow; y++) {
+            staleRows.push_back(y);
+        }
+    }
+
+    glCall(glActiveTexture(GL_TEXTURE1));
+    glCall(glBindTexture(GL_TEXTURE_2D, m_CellsTexId));
+    // Pages looked up outside of rows aren't kept
+    font.takeUsedPages();
+    for (const size_t y : staleRows) {
+        makeRow(rows[y], font);
+        m_RowPages.set(y % m_RowSlots.size(), font.takeUsedPages());
+
+        const size_t slot = y % m_RowSlots.size();
+        glCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, slot, m_Cols, 1,
+                               GL_RGBA_INTEGER, GL_UNSIGNED_INT,
+                               m_RowTexels.data()));
+        Stats::add(Counter::UploadBytes, m_Cols * sizeof(CellTexel));
+        m_RowSlots[slot] =
+            RowSlot{.row = y,
+                    .version = termBuf.getRowVersion(y),
+                    .valid = true,
+                    .missingGlyphs = !font.hasAllGlyphs(rows[y])};
+    }
+
+    [[maybe_unused]] const size_t uploadedRows = staleRows.size();
+
+    // Rows which went out of view or were deleted. Rows past the end of the buffer can still be in the viewport,
+    // so their texels have to be cleared, otherwise the shader would draw old content.
+    m_RowTexels.assign(m_Cols, CellTexel{});
+    for (size_t slot = 0; slot < m_RowSlots.size(); slot++) {
+        const RowSlot& rowSlot = m_RowSlots[slot];
+        if (rowSlot.valid &&
+            (rowSlot.row < firstRow || rowSlot.row >= endRow)) {
+            glCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, slot, m_Cols, 1,
+                                   GL_RGBA_INTEGER, GL_UNSIGNED_INT,
+                                   m_RowTexels.data()));
+            Stats::add(Counter::UploadBytes, m_Cols * sizeof(CellTexel));
+            m_RowSlots[slot].valid = false;
+            m_RowPages.clear(slot);
+            staleRows.push_back(rowSlot.row);
+        }
+    }
+    glCall(glActiveTexture(GL_TEXTURE0));
+
+    glm::vec2 pen(0);
+    font.getGlyphPos(Cell{.character = ' '}, pen);
+    m_CellMetrics = glm::vec3(pen.x, font.getMetricsInPx().height,
+                              font.getMetricsInPx().descender);
+    m_Viewport = viewport;
+    SPDLOG_TRACE("Uploaded {} of {} visible rows to cell grid",
+                 uploadedRows, endRow - firstRow);
+    return staleRows;
+}
+
+void CellGrid::invalidate() {
+    for (RowSlot& slot : m_RowSlots) {
+        slot.valid = false;
+    }
+    m_GlyphTableValid = false;
+}
+
+void CellGrid::invalidateMissingGlyphs() {
+    for (RowSlot& slot : m_RowSlots) {
+        if (slot.missingGlyphs) {
+            slot.valid = false;
+        }
+    }
+    m_GlyphTableValid = false;
+}
+
+void CellGrid::touchPages(Font& font) const {
+    font.touchPages(m_RowPages);
+}
+
+void CellGrid::draw(const glm::mat4& mvp, const glm::vec2& screenSize,
+                    const Font& font) {
+    if (m_RowSlots.empty()) {
+        return;
+    }
+
+    m_Program.setUniformMatrix4("u_InvMVP", glm::inverse(mvp));
+    m_Program.setUniformVec2("u_ScreenSize", screenSize);
+    m_Program.setUniformVec3("u_CellMetrics", m_CellMetrics);
+    m_Program.setUniformInt("u_FirstRow", m_Viewport.firstRow);
+    m_Program.setUniformInt("u_RowCount", m_Viewport.rowCount);
+    m_Program.setUniformInt("u_Tex", 0);
+    m_Program.setUniformInt("u_Cells", 1);
+    m_Program.setUniformInt("u_Glyphs", 2);
+    m_Program.setUniformInt("u_Palette", PaletteTexture::UNIT);
+    if (font.getFormat() == GlyphFormat::Sdf) {
+        m_Program.setUniformFloat("u_SdfScale",
+                                  Font::getSdfScale(mvp, screenSize.x));
+    }
+
+    glCall(glActiveTexture(GL_TEXTURE1));
+    glCall(glBindTexture(GL_TEXTURE_2D, m_CellsTexId));
+    glCall(glActiveTexture(GL_TEXTURE2));
+    glCall(glBindTexture(GL_TEXTURE_2D, m_GlyphsTexId));
+    glCall(glActiveTexture(GL_TEXTURE0));
+    font.bindAtlas();
+
+    m_Va.bind();
+    glCall(glDrawArrays(GL_TRIANGLES, 0, 3));
+}
+
+// PRIVATE
+void CellGrid::resize(size_t cols, size_t rows) {
+    m_Cols = cols;
+    m_Rows = rows;
+    m_RowSlots.assign(rows, RowSlot{});
+    m_RowPages.resize(rows);
+
+    const std::vector<CellTexel> empty(cols * rows);
+    glCall(glActiveTexture(GL_TEXTURE1));
+    glCall(glBindTexture(GL_TEXTURE_2D, m_CellsTexId));
+    glCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32UI, cols, rows, 0,
+                        GL_RGBA_INTEGER, GL_UNSIGNED_INT, empty.data()));
+    glCall(glActiveTexture(GL_TEXTURE0));
+
+    SPDLOG_DEBUG("Resized cell grid to {}x{}", cols, rows);
+}
+
+void CellGrid::uploadGlyphTable(Font& font) {
+    const std::vector<GlyphPos> glyphs = font.makeGlyphTable();
+
+    // Row per glyph: atlas rect in the first texel, quad in the second, page in the third
+    std::vector<glm::vec4> table;
+    table.reserve(glyphs.size() * 3);
+    for (const GlyphPos& g : glyphs) {
+        table.emplace_back(g.al, g.at, g.ar, g.ab);
+        table.emplace_back(g.pl, g.pt, g.pr, g.pb);
+        table.emplace_back(g.layer, 0, 0, 0);
+    }
+    glCall(glActiveTexture(GL_TEXTURE2));
+    glCall(glBindTexture(GL_TEXTURE_2D, m_GlyphsTexId));
+    glCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 3, glyphs.size(), 0,
+                        GL_RGBA, GL_FLOAT, table.data()));
+    glCall(glActiveTexture(GL_TEXTURE0));
+    Stats::add(Counter::UploadBytes, table.size() * sizeof(glm::vec4));
+
+    m_GlyphTableValid = true;
+}
+
+void CellGrid::makeRow(const std::vector<Cell>& row, Font& font) {
+    m_RowTexels.assign(m_Cols, CellTexel{});
+
+    // Same layout as the mesh renderer: a tab moves the pen to the next tab stop before it's drawn
+    size_t col = 0;
+    for (size_t x = 0; x < row.size() && col < m_Cols; x++) {
+        const Cell& cell = row[x];
+
+        if (cell.character == c0::HT) {
+            col += Font::TAB_WIDTH - (cell.offset % Font::TAB_WIDTH);
+            continue;
+        }
+
+        // The continuation cell draws the right half of the wide glyph, so it needs the glyph as well
+        m_RowTexels[col] = CellTexel{
+            .glyph = font.getGlyphIndex(cell),
+            .fgColor = cell.fgColor,
+            .bgColor = cell.bgColor,
+            .flags = cell.width == 0 ? CONTINUATION : 0u,
+        };
+        col++;
+    }
+}
+
+size_t CellGrid::countColumns(const std::vector<Cell>& row) {
+    size_t cols = 0;
+    for (const Cell& cell : row) {
+        if (cell.character == c0::HT) {
+            cols += Font::TAB_WIDTH - (cell.offset % Font::TAB_WIDTH);
+        } else {
+            cols++;
+        }
+    }
+    return cols;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../terminal/terminal_buffer.hpp"
+#include "../terminal/types.hpp"
+#include "font.hpp"
+#include "opengl.hpp"
+#include "program.hpp"
+#include "vertex_array.hpp"
+#include "viewport.hpp"
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <vector>
+
+/// Alternative to the mesh based text rendering. Visible rows are stored in a texture with one texel per cell,
+/// which is drawn with a single full-screen triangle. The fragment shader looks up the cell, its glyph and colors.
+/// Combining marks and ligatures aren't drawn, a cell only has room for the glyph of its own codepoint.
+class CellGrid {
+public:
+    /// The shader variant depends on the glyph format of the atlas
+    CellGrid(GlyphFormat format);
+    ~CellGrid();
+
+    /// Only visible rows which changed since the last call are uploaded.
+    /// Returns the uploaded and cleared rows.
+    std::vector<size_t> update(const TerminalBuf& termBuf,
+                               const Viewport& viewport, Font& font);
+    void invalidate();
+    /// Re-uploads the glyph table and rows drawn with fallback glyphs
+    void invalidateMissingGlyphs();
+    /// See Renderer::touchPages
+    void touchPages(Font& font) const;
+    void draw(const glm::mat4& mvp, const glm::vec2& screenSize,
+              const Font& font);
+
+    constexpr static GLuint NO_GLYPH = 0xffffffff;
+    /// Cell flag: second half of a wide character, drawn with the pen of the previous cell
+    constexpr static GLuint CONTINUATION = 1;
+
+private:
+    struct CellTexel {
+        GLuint glyph = NO_GLYPH;
+        color_t fgColor = colors::defaultFg;
+        color_t bgColor = colors::defaultBg;
+        GLuint flags = 0;
+    };
+    struct RowSlot {
+        size_t row;
+        uint64_t version;
+        bool valid = false;
+        /// Some cells were drawn with the fallback glyph
+        bool missingGlyphs = false;
+    };
+
+    void resize(size_t cols, size_t rows);
+    void uploadGlyphTable(Font& font);
+    void makeRow(const std::vector<Cell>& row, Font& font);
+    static size_t countColumns(const std::vector<Cell>& row);
+
+    Program m_Program;
+    VertexArray m_Va;
+    GLuint m_CellsTexId = 0;
+    GLuint m_GlyphsTexId = 0;
+    size_t m_Cols = 0;
+    size_t m_Rows = 0;
+    bool m_GlyphTableValid = false;
+
+    /// Texels of the row currently being generated
+    std::vector<CellTexel> m_RowTexels;
+    /// Row y is always stored in texture row y % m_Rows, like RowMesh slots
+    std::vector<RowSlot> m_RowSlots;
+    /// Atlas pages of the row in each texture row
+    RowPages m_RowPages;
+    Viewport m_Viewport = {.firstRow = 0, .rowCount = 0};
+    /// Cell advance, row height, descender
+    glm::vec3 m_CellMetrics = glm::vec3(0);
+};
@@ -1,12 +1,40 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <glm/ext/vector_float4.hpp>
 
 #define RGB(r, g, b) glm::vec4(r / 255.0, g / 255.0, b / 255.0, 1)
 
+/// Color stored in cells and vertices, resolved on the GPU.
+/// Either an index into the palette, or a 24-bit color tagged with colors::TRUECOLOR.
+using color_t = uint32_t;
+
 namespace colors {
-inline constexpr glm::vec4 defaultBg = glm::vec4(0); // Must be transparent
-inline constexpr glm::vec4 defaultFg = glm::vec4(1);
+/// Set on truecolor values, red is stored in the lowest byte
+inline constexpr color_t TRUECOLOR = 1 << 24;
+
+// Palette entries after the 256 indexed colors
+inline constexpr color_t defaultFg = 256;
+/// Backgrounds with this color aren't drawn, the clear color (which is also this color) shows through
+inline constexpr color_t defaultBg = 257;
+inline constexpr color_t cursor = 258;
+inline constexpr color_t selection = 259;
+inline constexpr color_t highlight = 260;
+inline constexpr size_t PALETTE_SIZE = 261;
+
+constexpr color_t truecolor(uint8_t r, uint8_t g, uint8_t b) {
+    return TRUECOLOR | r | g << 8 | b << 16;
+}
+
+// Theme colors of the palette entries after the 256 indexed colors
+inline constexpr glm::vec4 themeDefaultFg = glm::vec4(1);
+inline constexpr glm::vec4 themeDefaultBg = glm::vec4(0.10f, 0.11f, 0.15f, 1);
+inline constexpr glm::vec4 themeCursor = glm::vec4(1);
+inline constexpr glm::vec4 themeSelection =
+    glm::vec4(0.35f, 0.5f, 0.85f, 0.45f);
+inline constexpr glm::vec4 themeHighlight =
+    glm::vec4(0.95f, 0.75f, 0.2f, 0.35f);
 
 // Generated with scripts/fetch_colors/main.py
 inline constexpr glm::vec4 colors256[256] = {
@@ -1,7 +1,11 @@
 #include "font.hpp"
+#include "../stats.hpp"
+#include "../trace.hpp"
 #include "../terminal/codes.hpp"
 #include "../utils.hpp"
+#include "box_drawing.hpp"
 #include "opengl.hpp"
+#include <algorithm>
 #include <freetype/freetype.h>
 #include <freetype/ftmodapi.h>
 #include <glm/ext/vector_float2.hpp>
@@ -9,8 +13,12 @@
 #include <stb_rect_pack.h>
 #include <unordered_set>
 
-Font::Font(std::filesystem::path path, float size)
-    : m_Path(path), m_Size(size) {
+Font::Font(FontFamily& family, float size, size_t atlasBudget, bool shaping)
+    : m_Family(family), m_Size(size),
+      m_Cache(family.getPath(), size,
+              GlyphRasterizer::getFormatName(family.getFormat()),
+              family.getFallbackStamps()) {
+    const std::filesystem::path& path = family.getPath();
     FT_Error error = 0;
 
     error = FT_Init_FreeType(&m_Lib);
@@ -24,138 +32,231 @@ Font::Font(std::filesystem::path path, float size)
     }
 
     error = FT_Set_Char_Size(m_Font, 0, size * 64, 0, 0);
+    // Procedural glyphs are drawn at the size of a cell
+    if (FT_Load_Char(m_Font, ' ', FT_LOAD_DEFAULT) == 0) {
+        m_CellWidth = fracToPx(m_Font->glyph->advance.x);
+    }
 
+#ifdef YATE_HARFBUZZ
+    if (shaping) {
+        // Synthesized styles use the glyphs of the regular face
+        std::array<std::filesystem::path, cell_style::COUNT> paths;
+        for (uint8_t style = 0; style < cell_style::COUNT; style++) {
+            paths[style] = m_Family.getStyleFonts()[style].value_or(path);
+        }
+        m_Shaper = std::make_unique<Shaper>(paths, size);
+    }
+#else
+    if (shaping) {
+        SPDLOG_DEBUG("Built without HarfBuzz, text won't be shaped");
+    }
+#endif
+
+    m_AsciiSlots.fill(NO_SLOT);
+    m_Atlas.setBudget(atlasBudget);
     auto initial = std::unordered_set<codepoint_t>();
-    // Insert ASCII characters
+    // Insert ASCII characters, they end up in the first page, which is never evicted
     for (codepoint_t c = ' '; c <= '~'; c++) {
         initial.insert(c);
     }
     initial.insert(Font::REPLACEMENT_CHAR); // replacement character �
-    updateAtlas(initial);
+    // Glyphs used in most of the previous sessions are uploaded from the cache right away
+    for (codepoint_t c : m_Cache.getMostUsed(PRELOAD_GLYPHS)) {
+        initial.insert(c);
+    }
+    // Nothing touches GL or waits here, so that fonts can be loaded on another thread while the context is created,
+    // and new sizes while the previous one is drawn. The glyphs are uploaded by the next updateAtlas calls.
+    prepareGlyphs(initial, m_Pending);
 }
 
 Font::~Font() {
-    for (auto& g : m_CodepointToGeometry) {
-        std::free(g.second.bitmap);
-    }
+    m_Family.getRasterizer().cancel(m_Size);
+    m_Cache.save();
     FT_Done_Face(m_Font);
     FT_Done_Library(m_Lib);
-    SPDLOG_DEBUG("Destroyed font '{}'", m_Path.c_str());
+    SPDLOG_DEBUG("Destroyed font '{}' of size {}px",
+                 m_Family.getPath().c_str(), m_Size);
 }
 
-/// Returns: true if any codepoints were new, false if not
-bool Font::updateAtlas(std::unordered_set<codepoint_t>& codepoints) {
-    FT_Error error = 0;
+void Font::wait() {
+    if (!m_Rasterizing.empty()) {
+        m_Family.getRasterizer().wait();
+        prepareGlyphs({}, m_Pending);
+    }
+}
 
-    // Filter out already rendered glyphs
-    std::unordered_set<codepoint_t> newCodepoints;
-    for (codepoint_t c : codepoints) {
-        if (!m_CodepointToGeometry.contains(c)) {
-            newCodepoints.insert(c);
+bool Font::isLoaded() const {
+    for (codepoint_t c = ' '; c <= '~'; c++) {
+        if (m_AsciiSlots[c] == NO_SLOT) {
+            return false;
         }
     }
-    if (newCodepoints.empty()) {
-        return false;
-    }
-
-    size_t numGlyphs = m_CodepointToGeometry.size() + newCodepoints.size();
-    size_t rectIndex = 0;
-    // We have to pass an array of rects to stbrp_pack_rects later, so we can't just make a Codepoint->stbrp_rect map
-    stbrp_rect rects[Atlas::CAPACITY];
-    std::unordered_map<codepoint_t, size_t> codepointToRectIndex;
-    std::unordered_map<codepoint_t, GlyphGeometry> codepointToGeometry;
+    return hasGlyph(REPLACEMENT_CHAR);
+}
 
-    // Unfortunately we have to pack all glyphs every time, otherwise the packing is increasingly worse every time we add a glyph
-    std::unordered_set<codepoint_t> codepointsToPack(numGlyphs);
-    for (const auto& [codepoint, _] : m_CodepointToGeometry) {
-        codepointsToPack.insert(codepoint);
-    }
-    for (const auto& codepoint : newCodepoints) {
-        codepointsToPack.insert(codepoint);
+AtlasUpdate Font::updateAtlas(std::unordered_set<codepoint_t>& codepoints) {
+    Trace::Span span("Font::updateAtlas");
+    // Glyphs prepared when the font was loaded go first, so that they aren't requested again
+    AtlasUpdate update = AtlasUpdate::None;
+    if (!m_Pending.empty()) {
+        update = addGlyphs(m_Pending);
+        m_Pending.clear();
     }
+    std::vector<RasterizedGlyph> glyphs;
+    prepareGlyphs(codepoints, glyphs);
+    return std::max(update, addGlyphs(glyphs));
+}
 
-    for (codepoint_t c : codepointsToPack) {
-        FT_UInt glyphIndex = FT_Get_Char_Index(m_Font, c);
+bool Font::needsAtlasUpdate() const {
+    return !m_MissingCodepoints.empty() || !m_Rasterizing.empty() ||
+           !m_Pending.empty();
+}
 
-        error = FT_Load_Glyph(m_Font, glyphIndex, FT_LOAD_DEFAULT);
-        if (error) {
-            FATAL("Failed to load glyph '{}'", c);
-        }
+void Font::nextFrame() {
+    m_Frame++;
+}
 
-        error = FT_Render_Glyph(m_Font->glyph, FT_RENDER_MODE_NORMAL);
+std::vector<uint32_t> Font::takeUsedPages() {
+    std::vector<uint32_t> pages = std::move(m_UsedPages);
+    m_UsedPages.clear();
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+    return pages;
+}
 
-        rects[rectIndex] = stbrp_rect{
-            .w = static_cast<stbrp_coord>(m_Font->glyph->bitmap.width),
-            .h = static_cast<stbrp_coord>(m_Font->glyph->bitmap.rows)};
-        codepointToRectIndex[c] = rectIndex;
-        rectIndex++;
+void Font::touchPages(const RowPages& pages) {
+    pages.touch(m_Atlas, m_Frame);
+}
 
-        size_t bitmapSize = sizeof(uint8_t) * m_Font->glyph->bitmap.rows *
-                            m_Font->glyph->bitmap.width;
-        GlyphGeometry glyph = {
-            .metrics = m_Font->glyph->metrics,
-            // Have to memcpy, because on the next iteration the bitmap buffer pointer is overwritten with the next glyph's bitmap
-            .bitmap = (uint8_t*)std::malloc(bitmapSize),
-        };
-        std::memcpy(glyph.bitmap, m_Font->glyph->bitmap.buffer, bitmapSize);
-        codepointToGeometry[c] = glyph;
+void Font::trimAtlas() {
+    for (uint32_t page = 1; page < m_Atlas.getPageCount(); page++) {
+        evictGlyphs(page);
     }
+    m_Atlas.trim();
+}
 
-    m_Atlas.newTarget(atlasSize, atlasSize, m_Font->num_glyphs);
-    if (!m_Atlas.pack(rects, numGlyphs)) {
-        SPDLOG_ERROR("Failed to calculate glyph packing");
+bool Font::hasGlyph(codepoint_t codepoint) const {
+    if (codepoint < m_AsciiSlots.size() && m_AsciiSlots[codepoint] != NO_SLOT) {
         return true;
     }
-    SPDLOG_DEBUG("Calculated glyph packing for {} glyphs",
-                 codepointsToPack.size());
+    return m_CodepointToSlot.contains(codepoint);
+}
 
-    for (auto& [codepoint, glyph] : codepointToGeometry) {
-        glyph.rect = rects[codepointToRectIndex[codepoint]];
-        if (!glyph.rect.was_packed) {
-            SPDLOG_ERROR("One or more glyphs weren't packed");
+bool Font::hasAllGlyphs(const std::vector<Cell>& row) const {
+    return std::all_of(row.begin(), row.end(), [this](const Cell& cell) {
+        return (cell.character == c0::HT ||
+                hasGlyph(GlyphRasterizer::makeKey(cell.character,
+                                                  cell.style))) &&
+               (cell.combining == 0 ||
+                hasGlyph(
+                    GlyphRasterizer::makeKey(cell.combining, cell.style)));
+    });
+}
+
+bool Font::hasAllGlyphs(const std::vector<Cell>& row,
+                        const std::vector<ShapedGlyph>& shaped) const {
+    // Shaped cells still advance the pen with their own glyph
+    if (!hasAllGlyphs(row)) {
+        return false;
+    }
+    for (size_t x = 0; x < shaped.size(); x++) {
+        const uint32_t glyph = shaped[x].glyph;
+        if (glyph != ShapedGlyph::NOMINAL && glyph != ShapedGlyph::NONE &&
+            !hasGlyph(GlyphRasterizer::makeKey(
+                glyph | GlyphRasterizer::GLYPH_INDEX_BIT, row[x].style))) {
+            return false;
         }
+    }
+    return true;
+}
 
-        glCall(glTexSubImage2D(GL_TEXTURE_2D, 0, glyph.rect.x, glyph.rect.y,
-                               glyph.rect.w, glyph.rect.h, GL_RED,
-                               GL_UNSIGNED_BYTE, glyph.bitmap));
+GlyphPos Font::getGlyphPos(const Cell& cell, glm::vec2& pen) {
+    const float spaceAdvance = m_Glyphs[m_AsciiSlots[' ']].advance;
+    if (cell.width == 0) {
+        pen.x += spaceAdvance;
+        return GlyphPos{};
+    }
 
-        m_CodepointToGeometry[codepoint] = glyph;
+    const GlyphRecord& glyph = m_Glyphs[useGlyph(cell)];
+    if (cell.character == c0::HT) {
+        // Align to next tab stop
+        pen.x += spaceAdvance * (TAB_WIDTH - (cell.offset % TAB_WIDTH));
+        return GlyphPos{};
     }
 
-    SPDLOG_DEBUG("Generated {}x{} font atlas", atlasSize, atlasSize);
-    return true;
+    // Every cell stays on the grid of the primary font. Glyphs of fallback fonts and bold glyphs
+    // (synthesized ones are always wider) can have another advance, so they're centered in the cell.
+    pen.x += spaceAdvance;
+    GlyphPos pos = glyph.pos;
+    const float offset = (spaceAdvance * cell.width - glyph.advance) / 2;
+    pos.pl += offset;
+    pos.pr += offset;
+    return pos;
 }
 
-GlyphPos Font::getGlyphPos(const Cell& cell, glm::vec2& pen) {
-    GlyphPos gp{};
-    GlyphGeometry& gg = m_CodepointToGeometry.contains(cell.character)
-                            ? m_CodepointToGeometry[cell.character]
-                            : m_CodepointToGeometry[REPLACEMENT_CHAR];
+GlyphPos Font::getGlyphPos(const Cell& cell, const ShapedGlyph& shaped,
+                           glm::vec2& pen) {
+    if (shaped.glyph == ShapedGlyph::NOMINAL) {
+        return getGlyphPos(cell, pen);
+    }
 
-    gp.al = gg.rect.x / (float)atlasSize;
-    gp.at = (gg.rect.y + gg.rect.h) / (float)atlasSize;
-    gp.ar = (gg.rect.x + gg.rect.w) / (float)atlasSize;
-    gp.ab = gg.rect.y / (float)atlasSize;
+    // Shaping never changes the advance, every cell keeps its column
+    getGlyphPos(cell, pen);
+    if (shaped.glyph == ShapedGlyph::NONE) {
+        return GlyphPos{};
+    }
 
-    gp.pl = fracToPx(gg.metrics.horiBearingX);
-    gp.pt = -fracToPx(gg.metrics.height - gg.metrics.horiBearingY),
-    gp.pr = gp.pl + fracToPx(gg.metrics.width);
-    gp.pb = gp.pt + fracToPx(gg.metrics.height);
+    const Cell glyphCell = {
+        .character = shaped.glyph | GlyphRasterizer::GLYPH_INDEX_BIT,
+        .style = cell.style};
+    GlyphPos pos = m_Glyphs[useGlyph(glyphCell)].pos;
+    pos.pl += shaped.offsetX;
+    pos.pr += shaped.offsetX;
+    pos.pt += shaped.offsetY;
+    pos.pb += shaped.offsetY;
+    return pos;
+}
 
-    glm::vec2 advance(fracToPx(gg.metrics.horiAdvance), 0);
-    if (cell.character == c0::HT) {
-        const GlyphGeometry& space = m_CodepointToGeometry[' '];
-        // Align to next tab stop
-        advance.x = fracToPx(space.metrics.horiAdvance) *
-                    (TAB_WIDTH - (cell.offset % TAB_WIDTH));
-        gp.pl = 0;
-        gp.pt = 0;
-        gp.pr = 0;
-        gp.pb = 0;
+void Font::shapeRow([[maybe_unused]] const std::vector<Cell>& row,
+                    std::vector<ShapedGlyph>& out) {
+#ifdef YATE_HARFBUZZ
+    if (m_Shaper != nullptr) {
+        m_Shaper->shapeRow(row, out);
+        return;
     }
-    pen += advance;
+#endif
+    out.clear();
+}
 
-    return gp;
+GlyphPos Font::getCombiningGlyphPos(const Cell& cell) {
+    const Cell markCell = {.character = cell.combining, .style = cell.style};
+    GlyphPos pos = m_Glyphs[useGlyph(markCell)].pos;
+
+    // Marks are drawn where the pen ends up after the base character, like in running text
+    const float offset = m_Glyphs[m_AsciiSlots[' ']].advance *
+                         std::max<uint8_t>(cell.width, 1);
+    pos.pl += offset;
+    pos.pr += offset;
+    return pos;
+}
+
+uint32_t Font::getGlyphIndex(const Cell& cell) {
+    return useGlyph(cell);
+}
+
+std::vector<GlyphPos> Font::makeGlyphTable() {
+    // Slots of evicted glyphs stay zeroed until they're reused
+    std::vector<GlyphPos> table(m_Glyphs.size());
+    for (size_t slot = 0; slot < m_Glyphs.size(); slot++) {
+        if (m_Glyphs[slot].valid) {
+            table[slot] = m_Glyphs[slot].pos;
+        }
+    }
+    return table;
+}
+
+void Font::bindAtlas() const {
+    m_Atlas.bind();
 }
 
 FT_Size_Metrics Font::getMetricsInPx() const {
@@ -172,6 +273,242 @@ float Font::getSize() const {
     return m_Size;
 }
 
+GlyphFormat Font::getFormat() const {
+    return m_Family.getFormat();
+}
+
 double Font::fracToPx(double value) {
     return value / 64.0;
 }
+
+float Font::getSdfScale(const glm::mat4& mvp, float screenWidth) {
+    // Field values map [-spread, spread] atlas pixels to [0, 1], the MVP maps atlas pixels to [-1, 1] of the screen
+    const float screenPxPerAtlasPx = mvp[0][0] * screenWidth / 2;
+    return 2 * GlyphRasterizer::SDF_SPREAD * screenPxPerAtlasPx;
+}
+
+// PRIVATE
+uint32_t Font::useGlyph(const Cell& cell) {
+    const codepoint_t c = GlyphRasterizer::makeKey(cell.character, cell.style);
+    uint32_t slot = NO_SLOT;
+    if (c < m_AsciiSlots.size() && m_AsciiSlots[c] != NO_SLOT) {
+        slot = m_AsciiSlots[c];
+    } else if (cell.glyphSlot < m_Glyphs.size() &&
+               m_Glyphs[cell.glyphSlot].valid &&
+               m_Glyphs[cell.glyphSlot].codepoint == c) {
+        slot = cell.glyphSlot;
+    } else if (const auto it = m_CodepointToSlot.find(c);
+               it != m_CodepointToSlot.end()) {
+        slot = it->second;
+        cell.glyphSlot = slot;
+    } else {
+        if (cell.character != c0::HT) {
+            m_MissingCodepoints.insert(c);
+        }
+        // Styled glyphs are rasterized when they're first drawn, until then the regular glyph stands in
+        const auto regular = m_CodepointToSlot.find(cell.character);
+        slot = cell.style != cell_style::REGULAR &&
+                       regular != m_CodepointToSlot.end()
+                   ? regular->second
+                   : m_CodepointToSlot.at(REPLACEMENT_CHAR);
+    }
+
+    // The first page is never evicted, so it doesn't need the stamps
+    const GlyphRecord& glyph = m_Glyphs[slot];
+    if (glyph.page != 0) {
+        m_Atlas.touch(glyph.page, m_Frame);
+        if (m_UsedPages.empty() || m_UsedPages.back() != glyph.page) {
+            m_UsedPages.push_back(glyph.page);
+        }
+    }
+    return slot;
+}
+
+void Font::prepareGlyphs(const std::unordered_set<codepoint_t>& codepoints,
+                         std::vector<RasterizedGlyph>& glyphs) {
+    // Glyphs which aren't in the atlas are taken from the cache, or rasterized when they're not in it either
+    std::vector<GlyphRequest> requests;
+    std::vector<codepoint_t> unresolved;
+    const auto request = [&](codepoint_t c) {
+        if (m_CodepointToSlot.contains(c) || m_Rasterizing.contains(c)) {
+            return;
+        }
+        // Cheaper to draw again than to cache, the same in every style
+        const codepoint_t glyphKey = GlyphRasterizer::getKeyGlyph(c);
+        const FT_Size_Metrics metrics = getMetricsInPx();
+        if (std::optional<RasterizedGlyph> glyph = BoxDrawing::render(
+                glyphKey, m_CellWidth, metrics.height, metrics.descender)) {
+            glyph->codepoint = c;
+            glyphs.push_back(std::move(glyph.value()));
+            return;
+        }
+        if (std::optional<RasterizedGlyph> glyph = m_Cache.get(c)) {
+            glyphs.push_back(std::move(glyph.value()));
+            return;
+        }
+        // Fallback fonts are only looked up for codepoints the main font doesn't have,
+        // shaped glyphs always come from the main font
+        uint16_t font = 0;
+        if ((glyphKey & GlyphRasterizer::GLYPH_INDEX_BIT) == 0 &&
+            FT_Get_Char_Index(m_Font, glyphKey) == 0) {
+            std::optional<uint16_t> fallback;
+            if (!m_Family.getFallback().resolve(glyphKey, fallback)) {
+                // Tried again on the next update, until then it's drawn with the replacement glyph
+                unresolved.push_back(c);
+                return;
+            }
+            if (fallback.has_value()) {
+                font = fallback.value() + 1;
+            }
+        }
+        m_Rasterizing.insert(c);
+        requests.push_back(
+            GlyphRequest{.codepoint = c, .font = font, .size = m_Size});
+    };
+    for (codepoint_t c : codepoints) {
+        request(c);
+    }
+    for (codepoint_t c : m_MissingCodepoints) {
+        request(c);
+    }
+    m_MissingCodepoints.clear();
+    m_MissingCodepoints.insert(unresolved.begin(), unresolved.end());
+    m_Family.getRasterizer().request(requests);
+
+    // Until their glyphs are finished, cells are drawn with the replacement glyph
+    const size_t cachedGlyphs = glyphs.size();
+    m_Family.getRasterizer().collect(m_Size, glyphs);
+    // A destroyed font of the same size could have requested glyphs which are still finishing
+    glyphs.erase(std::remove_if(glyphs.begin() + cachedGlyphs, glyphs.end(),
+                                [this](const RasterizedGlyph& glyph) {
+                                    return m_Rasterizing.erase(
+                                               glyph.codepoint) == 0;
+                                }),
+                 glyphs.end());
+    for (size_t i = cachedGlyphs; i < glyphs.size(); i++) {
+        // Missing glyphs aren't cached, a font covering them could be installed later
+        if (!glyphs[i].missing) {
+            m_Cache.add(glyphs[i], glyphs[i].font == 0
+                                       ? 0
+                                       : m_Family.getFallback().getStamp(
+                                             glyphs[i].font - 1));
+        }
+    }
+}
+
+AtlasUpdate Font::addGlyphs(const std::vector<RasterizedGlyph>& glyphs) {
+    if (glyphs.empty()) {
+        return AtlasUpdate::None;
+    }
+    Stats::add(Counter::AtlasUpdates, 1);
+
+    std::vector<stbrp_rect> rects;
+    rects.reserve(glyphs.size());
+    for (const RasterizedGlyph& glyph : glyphs) {
+        rects.push_back(
+            stbrp_rect{.id = 0,
+                       .w = static_cast<stbrp_coord>(glyph.width),
+                       .h = static_cast<stbrp_coord>(glyph.height),
+                       .x = 0,
+                       .y = 0,
+                       .was_packed = 0});
+    }
+
+    std::vector<size_t> pending(glyphs.size());
+    for (size_t i = 0; i < pending.size(); i++) {
+        pending[i] = i;
+    }
+    bool evicted = false;
+    std::vector<stbrp_rect> batch;
+    std::vector<uint32_t> pages;
+    while (true) {
+        batch.clear();
+        for (const size_t i : pending) {
+            batch.push_back(rects[i]);
+        }
+        m_Atlas.pack(batch, pages);
+
+        std::vector<size_t> remaining;
+        for (size_t j = 0; j < batch.size(); j++) {
+            const size_t i = pending[j];
+            if (!batch[j].was_packed) {
+                remaining.push_back(i);
+                continue;
+            }
+
+            const codepoint_t c = glyphs[i].codepoint;
+            const GlyphRecord record = {
+                .pos = makeGlyphPos(glyphs[i].metrics, batch[j], pages[j]),
+                .advance = (float)fracToPx(glyphs[i].metrics.horiAdvance),
+                .codepoint = c,
+                .page = pages[j],
+                .valid = true,
+            };
+            uint32_t slot = m_Glyphs.size();
+            if (m_FreeSlots.empty()) {
+                m_Glyphs.push_back(record);
+            } else {
+                slot = m_FreeSlots.back();
+                m_FreeSlots.pop_back();
+                m_Glyphs[slot] = record;
+            }
+            m_CodepointToSlot[c] = slot;
+            if (c < m_AsciiSlots.size()) {
+                m_AsciiSlots[c] = slot;
+            }
+            m_Atlas.touch(pages[j], m_Frame);
+            m_Atlas.upload(pages[j], batch[j], glyphs[i].bitmap.data());
+        }
+        if (remaining.empty()) {
+            break;
+        }
+
+        const std::optional<uint32_t> page = m_Atlas.evict(m_Frame);
+        if (!page.has_value()) {
+            SPDLOG_WARN("Font atlas budget is full, {} glyphs are missing",
+                        remaining.size());
+            break;
+        }
+        evictGlyphs(page.value());
+        evicted = true;
+        pending = std::move(remaining);
+    }
+
+    SPDLOG_DEBUG("Added {} glyphs to font atlas ({} pages)", glyphs.size(),
+                 m_Atlas.getPageCount());
+    return evicted ? AtlasUpdate::Evicted : AtlasUpdate::Added;
+}
+
+GlyphPos Font::makeGlyphPos(const FT_Glyph_Metrics& metrics,
+                            const stbrp_rect& rect, uint32_t page) {
+    GlyphPos gp{};
+    constexpr float pageSize = Atlas::PAGE_SIZE;
+
+    gp.al = rect.x / pageSize;
+    gp.at = (rect.y + rect.h) / pageSize;
+    gp.ar = (rect.x + rect.w) / pageSize;
+    gp.ab = rect.y / pageSize;
+    gp.layer = page;
+
+    gp.pl = fracToPx(metrics.horiBearingX);
+    gp.pt = -fracToPx(metrics.height - metrics.horiBearingY);
+    gp.pr = gp.pl + fracToPx(metrics.width);
+    gp.pb = gp.pt + fracToPx(metrics.height);
+    return gp;
+}
+
+void Font::evictGlyphs(uint32_t page) {
+    // Evicted glyphs are rasterized again when they're drawn next time
+    for (uint32_t slot = 0; slot < m_Glyphs.size(); slot++) {
+        GlyphRecord& glyph = m_Glyphs[slot];
+        if (!glyph.valid || glyph.page != page) {
+            continue;
+        }
+        m_CodepointToSlot.erase(glyph.codepoint);
+        if (glyph.codepoint < m_AsciiSlots.size()) {
+            m_AsciiSlots[glyph.codepoint] = NO_SLOT;
+        }
+        glyph.valid = false;
+        m_FreeSlots.push_back(slot);
+    }
+}
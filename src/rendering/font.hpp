@@ -5,16 +5,28 @@
 
 #include "../terminal/terminal_buffer.hpp"
 #include "atlas.hpp"
+#include "font_family.hpp"
+#include "glyph_cache.hpp"
+#include "glyph_rasterizer.hpp"
+#include "row_pages.hpp"
+#include "shaper.hpp"
+#include <array>
 #include <filesystem>
+#include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/vector_float2.hpp>
+#include <memory>
 #include <stb_rect_pack.h>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
-struct GlyphGeometry {
-    FT_Glyph_Metrics metrics;
-    stbrp_rect rect;
-    uint8_t* bitmap;
+enum class AtlasUpdate {
+    /// All codepoints already had a glyph
+    None,
+    /// New glyphs were added, atlas coordinates of the existing ones didn't change
+    Added,
+    /// The atlas was full and pages which weren't touched in the current frame were evicted
+    Evicted,
 };
 
 struct GlyphPos {
@@ -22,31 +34,123 @@ struct GlyphPos {
     float al, at, ar, ab;
     /// World coordinates
     float pl, pt, pr, pb;
+    /// Atlas page
+    float layer;
+};
+
+/// Everything needed to draw a glyph, computed once when the glyph is packed
+struct GlyphRecord {
+    GlyphPos pos;
+    float advance;
+    codepoint_t codepoint;
+    uint32_t page;
+    /// False for slots of evicted glyphs
+    bool valid;
 };
 
 class Font {
 public:
     Font() = delete;
-    Font(std::filesystem::path path, float size);
+    /// Doesn't use GL or wait for the rasterizer, so it can be created on another thread than the one drawing it.
+    /// Shaping only has an effect when built with YATE_HARFBUZZ
+    Font(FontFamily& family, float size,
+         size_t atlasBudget = Atlas::DEFAULT_BUDGET, bool shaping = false);
     ~Font();
 
-    bool updateAtlas(std::unordered_set<codepoint_t>& codepoints);
+    /// Blocks until the glyphs requested when the font was created are rasterized, so that the first frame
+    /// isn't drawn with replacement glyphs
+    void wait();
+    /// ASCII and the replacement glyph are in the atlas, so the font can be drawn
+    bool isLoaded() const;
+
+    /// New codepoints and codepoints which were missing since the last call are rasterized in the background,
+    /// glyphs which finished since the last call are packed into the free space of the atlas.
+    /// When the atlas budget is full, least recently used pages are evicted.
+    AtlasUpdate updateAtlas(std::unordered_set<codepoint_t>& codepoints);
+    /// Some glyphs were drawn with the fallback glyph or are still being rasterized
+    bool needsAtlasUpdate() const;
+    /// Starts a new frame for the last used stamps of atlas pages
+    void nextFrame();
+    /// Atlas pages of the glyphs looked up since the last call, without duplicates and without the first page,
+    /// which is never evicted. Taken after meshing a row, to be touched while the row stays in view.
+    std::vector<uint32_t> takeUsedPages();
+    /// Marks the pages of rows in view as used in the current frame
+    void touchPages(const RowPages& pages);
+    /// Evicts every atlas page but the first, which keeps ASCII, and frees their memory.
+    /// Called when the font isn't drawn anymore, the evicted glyphs are rasterized again once it is.
+    void trimAtlas();
+    bool hasGlyph(codepoint_t codepoint) const;
+    /// False when a cell of the row is drawn with the fallback glyph, because its codepoint isn't in the atlas yet
+    bool hasAllGlyphs(const std::vector<Cell>& row) const;
+    /// Same, but also checks the glyphs the row was shaped into
+    bool hasAllGlyphs(const std::vector<Cell>& row,
+                      const std::vector<ShapedGlyph>& shaped) const;
+    /// Every cell advances the pen by the cell width of the primary font. Wide characters advance it by
+    /// one cell for themselves and one for their continuation cell, which has no glyph of its own.
     GlyphPos getGlyphPos(const Cell& cell, glm::vec2& pen);
+    /// Same layout, but drawn with the glyph the cell was shaped into
+    GlyphPos getGlyphPos(const Cell& cell, const ShapedGlyph& shaped,
+                         glm::vec2& pen);
+    /// One glyph per cell of the row, out is left empty when shaping is disabled
+    void shapeRow(const std::vector<Cell>& row, std::vector<ShapedGlyph>& out);
+    /// Position of the cell's combining mark relative to the pen its base character was drawn at
+    GlyphPos getCombiningGlyphPos(const Cell& cell);
+    /// Glyph slot, used as the glyph's index in the glyph table
+    uint32_t getGlyphIndex(const Cell& cell);
+    /// Positions of all glyphs relative to the pen, indexed by glyph slot
+    std::vector<GlyphPos> makeGlyphTable();
+    void bindAtlas() const;
 
     FT_Size_Metrics getMetricsInPx() const;
     float getSize() const;
+    GlyphFormat getFormat() const;
     static double fracToPx(double value);
+    /// Multiplier of distance field values, so that the outline is antialiased over one screen pixel at any scale
+    static float getSdfScale(const glm::mat4& mvp, float screenWidth);
 
     constexpr static codepoint_t REPLACEMENT_CHAR = 0xfffd;
     constexpr static uint8_t TAB_WIDTH = 8;
+    /// Most used glyphs from the glyph cache which are loaded with the font
+    constexpr static size_t PRELOAD_GLYPHS = 512;
+    constexpr static uint32_t NO_SLOT = UINT32_MAX;
 
 private:
-    std::filesystem::path m_Path;
+    /// Looks up the glyph slot of the cell and marks its page as used, falls back to the replacement character
+    /// for missing glyphs. Regular ASCII goes through a direct table, other glyphs through the slot cached in the cell.
+    uint32_t useGlyph(const Cell& cell);
+    /// Takes glyphs of the codepoints from the cache or requests them from the rasterizer,
+    /// and appends them together with the glyphs the rasterizer finished since the last call
+    void prepareGlyphs(const std::unordered_set<codepoint_t>& codepoints,
+                       std::vector<RasterizedGlyph>& glyphs);
+    /// Packs the glyphs into the atlas and uploads them
+    AtlasUpdate addGlyphs(const std::vector<RasterizedGlyph>& glyphs);
+    static GlyphPos makeGlyphPos(const FT_Glyph_Metrics& metrics,
+                                 const stbrp_rect& rect, uint32_t page);
+    void evictGlyphs(uint32_t page);
+
+    FontFamily& m_Family;
     float m_Size;
+    /// Advance of a space in pixels
+    uint32_t m_CellWidth = 0;
     FT_Library m_Lib;
     FT_Face m_Font;
+    GlyphCache m_Cache;
     Atlas m_Atlas;
-    // TODO: Dynamically choose atlas size
-    const uint32_t atlasSize = 2048;
-    std::unordered_map<codepoint_t, GlyphGeometry> m_CodepointToGeometry;
+    /// Dense array of glyphs indexed by slot
+    std::vector<GlyphRecord> m_Glyphs;
+    std::unordered_map<codepoint_t, uint32_t> m_CodepointToSlot;
+    std::array<uint32_t, 128> m_AsciiSlots;
+    std::unordered_set<codepoint_t> m_MissingCodepoints;
+    /// Requested from the rasterizer, but not collected yet
+    std::unordered_set<codepoint_t> m_Rasterizing;
+    /// Slots of evicted glyphs, reused by new glyphs
+    std::vector<uint32_t> m_FreeSlots;
+    /// Prepared when the font was created, uploaded by the next atlas update
+    std::vector<RasterizedGlyph> m_Pending;
+    /// Pages of glyphs looked up since the last takeUsedPages call
+    std::vector<uint32_t> m_UsedPages;
+    uint64_t m_Frame = 0;
+#ifdef YATE_HARFBUZZ
+    std::unique_ptr<Shaper> m_Shaper;
+#endif
 };
@@ -0,0 +1,444 @@
+#include "font_fallback.hpp"
+#include "../trace.hpp"
+#include "../utils.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <unistd.h>
+
+static constexpr char MAGIC[8] = {'Y', 'A', 'T', 'E', 'C', 'O', 'V', 'R'};
+static constexpr uint32_t MAX_PATH_LENGTH = 4096;
+
+FontFallback::FontFallback(const std::filesystem::path& mainFont) {
+    if (const std::optional<std::filesystem::path> dir = getCacheDir()) {
+        m_CachePath = dir.value() / "coverage.bin";
+        loadCache();
+    }
+
+    if (const char* env = std::getenv("YATE_FALLBACK_FONTS");
+        env != nullptr && env[0] != '\0') {
+        std::string path;
+        for (const char* c = env;; c++) {
+            if (*c == ':' || *c == '\0') {
+                if (!path.empty()) {
+                    m_Paths.emplace_back(path);
+                }
+                path.clear();
+            } else {
+                path += *c;
+            }
+            if (*c == '\0') {
+                break;
+            }
+        }
+        m_Configured = true;
+    } else {
+        // Fonts are only discovered again when a font directory changed after the cache was written
+        bool fontDirsChanged = m_CachedPaths.empty();
+        std::error_code error;
+        const auto cacheTime =
+            m_CachePath.has_value()
+                ? std::filesystem::last_write_time(m_CachePath.value(), error)
+                : std::filesystem::file_time_type::min();
+        for (const std::filesystem::path& dir : getFontDirs()) {
+            if (fontDirsChanged) {
+                break;
+            }
+            auto it = std::filesystem::recursive_directory_iterator(
+                dir, std::filesystem::directory_options::skip_permission_denied,
+                error);
+            if (error) {
+                continue;
+            }
+            fontDirsChanged =
+                std::filesystem::last_write_time(dir, error) > cacheTime;
+            for (; !fontDirsChanged && it != std::filesystem::end(it);
+                 it.increment(error)) {
+                if (it->is_directory(error)) {
+                    fontDirsChanged = it->last_write_time(error) > cacheTime;
+                }
+            }
+        }
+
+        if (fontDirsChanged) {
+            m_Paths = discover(mainFont);
+            m_Dirty.store(true);
+        } else {
+            m_Paths = m_CachedPaths;
+        }
+    }
+    // Font 0 of the rasterizer is the main font
+    if (m_Paths.size() >= UINT16_MAX) {
+        m_Paths.resize(UINT16_MAX - 1);
+    }
+
+    m_Coverage.resize(m_Paths.size());
+    for (size_t i = 0; i < m_Paths.size(); i++) {
+        Coverage& coverage = m_Coverage[i];
+        getFileStamp(m_Paths[i], coverage.mtime, coverage.size);
+
+        const auto it = m_CachedCoverage.find(m_Paths[i].string());
+        if (it != m_CachedCoverage.end() &&
+            it->second.mtime == coverage.mtime &&
+            it->second.size == coverage.size) {
+            coverage = std::move(it->second);
+            m_CachedCoverage.erase(it);
+        }
+    }
+
+    // Codepoints no font covered are only known to be missing if the fonts didn't change
+    if (m_CachedFingerprint == getFingerprint()) {
+        for (const codepoint_t c : m_CachedMissing) {
+            m_Resolved[c] = std::nullopt;
+        }
+    }
+
+    // Fonts with cached coverage are ready right away, the others are read in the background
+    size_t built = 0;
+    while (built < m_Coverage.size() && m_Coverage[built].built) {
+        built++;
+    }
+    m_Built.store(built);
+    if (built < m_Paths.size()) {
+        m_Builder = std::thread([this]() { buildCoverage(); });
+    }
+
+    SPDLOG_DEBUG("Using {} fallback fonts ({} without cached coverage)",
+                 m_Paths.size(), m_Paths.size() - built);
+}
+
+FontFallback::~FontFallback() {
+    m_Stop.store(true, std::memory_order_relaxed);
+    if (m_Builder.joinable()) {
+        m_Builder.join();
+    }
+    if (m_Dirty.load()) {
+        saveCache();
+    }
+}
+
+bool FontFallback::resolve(codepoint_t codepoint,
+                           std::optional<uint16_t>& font) {
+    if (const auto it = m_Resolved.find(codepoint); it != m_Resolved.end()) {
+        font = it->second;
+        return true;
+    }
+
+    font = std::nullopt;
+    const size_t built = m_Built.load(std::memory_order_acquire);
+    for (size_t i = 0; i < built; i++) {
+        const Coverage& coverage = m_Coverage[i];
+        const auto block = coverage.blocks.find(codepoint >> 8);
+        if (block != coverage.blocks.end() &&
+            block->second.test(codepoint & 0xff)) {
+            font = (uint16_t)i;
+            break;
+        }
+    }
+    // One of the fonts which aren't read yet could cover it
+    if (!font.has_value() && built < m_Paths.size()) {
+        return false;
+    }
+
+    m_Resolved[codepoint] = font;
+    if (!font.has_value()) {
+        m_Dirty.store(true);
+    }
+    SPDLOG_TRACE("Resolved fallback font of '{}': {}", codepoint,
+                 font.has_value() ? m_Paths[font.value()].c_str() : "none");
+    return true;
+}
+
+const std::vector<std::filesystem::path>& FontFallback::getPaths() const {
+    return m_Paths;
+}
+
+uint64_t FontFallback::getStamp(size_t font) const {
+    // FNV-1a of the path, modification time and size
+    uint64_t hash = 0xcbf29ce484222325;
+    const auto add = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= ((const uint8_t*)data)[i];
+            hash *= 0x100000001b3;
+        }
+    };
+    const std::string path = m_Paths[font].string();
+    add(path.data(), path.size());
+    add(&m_Coverage[font].mtime, sizeof(int64_t));
+    add(&m_Coverage[font].size, sizeof(uint64_t));
+    return hash;
+}
+
+// PRIVATE
+void FontFallback::buildCoverage() {
+    Trace::setThreadName("font fallback");
+    FT_Library lib;
+    if (FT_Init_FreeType(&lib) != 0) {
+        FATAL("Failed to initialize freetype");
+    }
+
+    size_t read = 0;
+    for (size_t i = m_Built.load(); i < m_Paths.size(); i++) {
+        if (m_Stop.load(std::memory_order_relaxed)) {
+            break;
+        }
+        if (!m_Coverage[i].built) {
+            readCoverage(lib, m_Paths[i], m_Coverage[i]);
+            read++;
+        }
+        m_Built.store(i + 1, std::memory_order_release);
+    }
+    FT_Done_FreeType(lib);
+
+    if (read > 0) {
+        m_Dirty.store(true);
+    }
+    SPDLOG_DEBUG("Read coverage of {} fallback fonts", read);
+}
+
+void FontFallback::readCoverage(FT_Library lib,
+                                const std::filesystem::path& path,
+                                Coverage& coverage) {
+    Trace::Span span("FontFallback::readCoverage");
+    FT_Face face;
+    if (FT_New_Face(lib, path.c_str(), 0, &face) == 0) {
+        FT_UInt glyphIndex = 0;
+        FT_ULong c = FT_Get_First_Char(face, &glyphIndex);
+        while (glyphIndex != 0) {
+            coverage.blocks[c >> 8].set(c & 0xff);
+            c = FT_Get_Next_Char(face, c, &glyphIndex);
+        }
+        FT_Done_Face(face);
+    } else {
+        SPDLOG_WARN("Failed to load fallback font '{}'", path.c_str());
+    }
+
+    coverage.built = true;
+    SPDLOG_TRACE("Read coverage of fallback font '{}' ({} blocks)",
+                 path.c_str(), coverage.blocks.size());
+}
+
+uint64_t FontFallback::getFingerprint() const {
+    uint64_t fingerprint = 0xcbf29ce484222325;
+    for (size_t i = 0; i < m_Paths.size(); i++) {
+        fingerprint = (fingerprint ^ getStamp(i)) * 0x100000001b3;
+    }
+    return fingerprint;
+}
+
+void FontFallback::loadCache() {
+    std::ifstream file(m_CachePath.value(), std::ios::binary);
+    if (!file) {
+        return;
+    }
+
+    const auto read = [&file](auto& value) {
+        file.read((char*)&value, sizeof(value));
+        return (bool)file;
+    };
+    const auto readString = [&](std::string& str) {
+        uint32_t length = 0;
+        if (!read(length) || length > MAX_PATH_LENGTH) {
+            return false;
+        }
+        str.resize(length);
+        file.read(str.data(), length);
+        return (bool)file;
+    };
+
+    char magic[8];
+    uint32_t version = 0;
+    if (!read(magic) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !read(version) || version != VERSION) {
+        SPDLOG_DEBUG("Ignoring font coverage cache with another version");
+        return;
+    }
+
+    uint32_t pathCount = 0;
+    std::vector<std::filesystem::path> paths;
+    bool ok = read(pathCount);
+    for (uint32_t i = 0; ok && i < pathCount; i++) {
+        std::string path;
+        ok = readString(path);
+        paths.emplace_back(path);
+    }
+
+    uint32_t entryCount = 0;
+    std::unordered_map<std::string, Coverage> entries;
+    ok = ok && read(entryCount);
+    for (uint32_t i = 0; ok && i < entryCount; i++) {
+        std::string path;
+        Coverage coverage = {.built = true};
+        uint32_t blockCount = 0;
+        ok = readString(path) && read(coverage.mtime) &&
+             read(coverage.size) && read(blockCount);
+        for (uint32_t j = 0; ok && j < blockCount; j++) {
+            uint32_t index = 0;
+            uint8_t bytes[BLOCK_BYTES];
+            ok = read(index) && read(bytes);
+            Block& block = coverage.blocks[index];
+            for (size_t bit = 0; bit < block.size(); bit++) {
+                block[bit] = (bytes[bit / 8] >> (bit % 8)) & 1;
+            }
+        }
+        entries[path] = std::move(coverage);
+    }
+
+    uint64_t fingerprint = 0;
+    uint32_t missingCount = 0;
+    std::vector<codepoint_t> missing;
+    ok = ok && read(fingerprint) && read(missingCount);
+    for (uint32_t i = 0; ok && i < missingCount; i++) {
+        codepoint_t c = 0;
+        ok = read(c);
+        missing.push_back(c);
+    }
+
+    if (!ok) {
+        SPDLOG_WARN("Font coverage cache '{}' is corrupted",
+                    m_CachePath.value().c_str());
+        return;
+    }
+    m_CachedPaths = std::move(paths);
+    m_CachedCoverage = std::move(entries);
+    m_CachedFingerprint = fingerprint;
+    m_CachedMissing = std::move(missing);
+    SPDLOG_DEBUG("Loaded coverage of {} fonts from cache",
+                 m_CachedCoverage.size());
+}
+
+void FontFallback::saveCache() const {
+    if (!m_CachePath.has_value()) {
+        return;
+    }
+
+    const std::filesystem::path tmpPath =
+        m_CachePath.value().string() + fmt::format(".{}", getpid());
+    std::ofstream file(tmpPath, std::ios::binary);
+    if (!file) {
+        SPDLOG_WARN("Failed to write font coverage cache '{}'",
+                    tmpPath.c_str());
+        return;
+    }
+
+    const auto write = [&file](const auto& value) {
+        file.write((const char*)&value, sizeof(value));
+    };
+    const auto writeString = [&](const std::string& str) {
+        write((uint32_t)str.size());
+        file.write(str.data(), str.size());
+    };
+    const auto writeCoverage = [&](const std::string& path,
+                                   const Coverage& coverage) {
+        writeString(path);
+        write(coverage.mtime);
+        write(coverage.size);
+        write((uint32_t)coverage.blocks.size());
+        for (const auto& [index, block] : coverage.blocks) {
+            uint8_t bytes[BLOCK_BYTES] = {};
+            for (size_t bit = 0; bit < block.size(); bit++) {
+                bytes[bit / 8] |= block[bit] << (bit % 8);
+            }
+            write(index);
+            write(bytes);
+        }
+    };
+
+    file.write(MAGIC, sizeof(MAGIC));
+    write(VERSION);
+
+    // Configured fonts don't replace the discovered ones
+    const std::vector<std::filesystem::path>& paths =
+        m_Configured ? m_CachedPaths : m_Paths;
+    write((uint32_t)paths.size());
+    for (const std::filesystem::path& path : paths) {
+        writeString(path.string());
+    }
+
+    uint32_t entryCount = m_CachedCoverage.size();
+    for (const Coverage& coverage : m_Coverage) {
+        entryCount += coverage.built ? 1 : 0;
+    }
+    write(entryCount);
+    for (size_t i = 0; i < m_Paths.size(); i++) {
+        if (m_Coverage[i].built) {
+            writeCoverage(m_Paths[i].string(), m_Coverage[i]);
+        }
+    }
+    for (const auto& [path, coverage] : m_CachedCoverage) {
+        writeCoverage(path, coverage);
+    }
+
+    std::vector<codepoint_t> missing;
+    for (const auto& [codepoint, font] : m_Resolved) {
+        if (!font.has_value()) {
+            missing.push_back(codepoint);
+        }
+    }
+    write(getFingerprint());
+    write((uint32_t)missing.size());
+    for (const codepoint_t c : missing) {
+        write(c);
+    }
+    file.close();
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, m_CachePath.value(), error);
+    if (error) {
+        SPDLOG_WARN("Failed to replace font coverage cache '{}': {}",
+                    m_CachePath.value().c_str(), error.message());
+        std::filesystem::remove(tmpPath, error);
+        return;
+    }
+    SPDLOG_DEBUG("Saved coverage of {} fonts", entryCount);
+}
+
+// STATIC
+std::vector<std::filesystem::path>
+FontFallback::discover(const std::filesystem::path& mainFont) {
+    std::vector<std::filesystem::path> paths;
+    std::error_code error;
+    for (const std::filesystem::path& dir : getFontDirs()) {
+        auto it = std::filesystem::recursive_directory_iterator(
+            dir, std::filesystem::directory_options::skip_permission_denied,
+            error);
+        if (error) {
+            continue;
+        }
+        for (; it != std::filesystem::end(it); it.increment(error)) {
+            if (error || !it->is_regular_file(error)) {
+                continue;
+            }
+            std::string ext = it->path().extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            if ((ext == ".ttf" || ext == ".otf" || ext == ".ttc") &&
+                !std::filesystem::equivalent(it->path(), mainFont, error)) {
+                paths.push_back(it->path());
+            }
+        }
+    }
+
+    std::sort(paths.begin(), paths.end());
+    SPDLOG_DEBUG("Discovered {} fonts", paths.size());
+    return paths;
+}
+
+std::vector<std::filesystem::path> FontFallback::getFontDirs() {
+    std::vector<std::filesystem::path> dirs = {"/usr/share/fonts",
+                                               "/usr/local/share/fonts"};
+    if (const char* dataHome = std::getenv("XDG_DATA_HOME");
+        dataHome != nullptr && dataHome[0] != '\0') {
+        dirs.push_back(std::filesystem::path(dataHome) / "fonts");
+    } else if (const char* home = std::getenv("HOME"); home != nullptr) {
+        dirs.push_back(std::filesystem::path(home) / ".local/share/fonts");
+    }
+    if (const char* home = std::getenv("HOME"); home != nullptr) {
+        dirs.push_back(std::filesystem::path(home) / ".fonts");
+    }
+    return dirs;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "../terminal/unicode.hpp"
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// Ordered list of font files used for codepoints the main font doesn't have, set with YATE_FALLBACK_FONTS
+/// or discovered by scanning the font directories. Which codepoints each font covers is read from its cmap
+/// on a background thread, in order, and cached in $XDG_CACHE_HOME/yate together with the codepoints no font covers,
+/// so fonts are never opened just to look up a codepoint.
+class FontFallback {
+public:
+    FontFallback(const std::filesystem::path& mainFont);
+    ~FontFallback();
+
+    /// Sets font to the index of the first font covering the codepoint, or nothing if no font covers it.
+    /// Returns false while the coverage of the fonts is still being read, the codepoint is unresolved until then.
+    /// Results are remembered.
+    bool resolve(codepoint_t codepoint, std::optional<uint16_t>& font);
+    const std::vector<std::filesystem::path>& getPaths() const;
+    /// Changes when the font file changes, used to invalidate glyphs rasterized from the font
+    uint64_t getStamp(size_t font) const;
+
+    constexpr static uint32_t VERSION = 2;
+
+private:
+    using Block = std::bitset<256>;
+    constexpr static size_t BLOCK_BYTES = 256 / 8;
+    struct Coverage {
+        bool built = false;
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        /// Blocks of 256 codepoints with at least one covered codepoint
+        std::unordered_map<uint32_t, Block> blocks = {};
+    };
+
+    /// Reads the coverage of fonts which weren't cached, on the builder thread
+    void buildCoverage();
+    static void readCoverage(FT_Library lib, const std::filesystem::path& path,
+                             Coverage& coverage);
+    /// Changes when any of the fonts changes, so that cached negative results can be discarded
+    uint64_t getFingerprint() const;
+    void loadCache();
+    void saveCache() const;
+    static std::vector<std::filesystem::path>
+    discover(const std::filesystem::path& mainFont);
+    static std::vector<std::filesystem::path> getFontDirs();
+
+    std::optional<std::filesystem::path> m_CachePath = std::nullopt;
+    std::vector<std::filesystem::path> m_Paths;
+    std::vector<Coverage> m_Coverage;
+    /// Coverage of fonts loaded from the cache, by path
+    std::unordered_map<std::string, Coverage> m_CachedCoverage;
+    /// Font list discovered in a previous session
+    std::vector<std::filesystem::path> m_CachedPaths;
+    /// Codepoints which no font covered in a previous session, with the fingerprint of the fonts back then
+    std::vector<codepoint_t> m_CachedMissing;
+    uint64_t m_CachedFingerprint = 0;
+    std::unordered_map<codepoint_t, std::optional<uint16_t>> m_Resolved;
+    /// Fonts before this index have their coverage, it's only written by the builder
+    std::atomic<size_t> m_Built = 0;
+    std::thread m_Builder;
+    std::atomic<bool> m_Stop = false;
+    /// Set with YATE_FALLBACK_FONTS instead of discovered
+    bool m_Configured = false;
+    std::atomic<bool> m_Dirty = false;
+};
@@ -0,0 +1,83 @@
+#include "font_family.hpp"
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <string>
+
+FontFamily::FontFamily(const std::filesystem::path& path, GlyphFormat format)
+    : m_Path(path), m_Format(format), m_StyleFonts(findStyleFonts(path)),
+      m_Fallback(path), m_FallbackStamps(makeFallbackStamps(m_Fallback)),
+      m_Rasterizer(getRasterizerFonts(path, m_Fallback), format,
+                   GlyphRasterizer::getDefaultThreadCount(), m_StyleFonts) {}
+
+const std::filesystem::path& FontFamily::getPath() const {
+    return m_Path;
+}
+
+GlyphFormat FontFamily::getFormat() const {
+    return m_Format;
+}
+
+const GlyphRasterizer::StyleFonts& FontFamily::getStyleFonts() const {
+    return m_StyleFonts;
+}
+
+FontFallback& FontFamily::getFallback() {
+    return m_Fallback;
+}
+
+GlyphRasterizer& FontFamily::getRasterizer() {
+    return m_Rasterizer;
+}
+
+const std::unordered_set<uint64_t>& FontFamily::getFallbackStamps() const {
+    return m_FallbackStamps;
+}
+
+// STATIC
+GlyphRasterizer::StyleFonts
+FontFamily::findStyleFonts(const std::filesystem::path& path) {
+    constexpr const char* STYLE_NAMES[] = {"Regular", "Bold", "Italic",
+                                           "BoldItalic"};
+    GlyphRasterizer::StyleFonts fonts = {};
+    const std::string name = path.filename().string();
+    const size_t pos = name.find(STYLE_NAMES[cell_style::REGULAR]);
+    if (pos == std::string::npos) {
+        SPDLOG_DEBUG("Font '{}' isn't named as a regular face, synthesizing "
+                     "bold and italic",
+                     path.c_str());
+        return fonts;
+    }
+
+    for (uint8_t style = 1; style < cell_style::COUNT; style++) {
+        std::string styleName = name;
+        styleName.replace(pos, std::strlen(STYLE_NAMES[cell_style::REGULAR]),
+                          STYLE_NAMES[style]);
+        const std::filesystem::path stylePath =
+            path.parent_path() / styleName;
+        if (std::filesystem::exists(stylePath)) {
+            fonts[style] = stylePath;
+        } else {
+            SPDLOG_DEBUG("Font '{}' doesn't exist, synthesizing it",
+                         stylePath.c_str());
+        }
+    }
+    return fonts;
+}
+
+std::vector<std::filesystem::path>
+FontFamily::getRasterizerFonts(const std::filesystem::path& path,
+                               const FontFallback& fallback) {
+    std::vector<std::filesystem::path> fonts = {path};
+    fonts.insert(fonts.end(), fallback.getPaths().begin(),
+                 fallback.getPaths().end());
+    return fonts;
+}
+
+std::unordered_set<uint64_t>
+FontFamily::makeFallbackStamps(const FontFallback& fallback) {
+    std::unordered_set<uint64_t> stamps;
+    for (size_t i = 0; i < fallback.getPaths().size(); i++) {
+        stamps.insert(fallback.getStamp(i));
+    }
+    return stamps;
+}
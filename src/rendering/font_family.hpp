@@ -0,0 +1,43 @@
+#pragma once
+
+#include "font_fallback.hpp"
+#include "glyph_rasterizer.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <unordered_set>
+#include <vector>
+
+/// Everything about a font which doesn't depend on its size: the style faces, the fallback fonts and the rasterizer.
+/// Shared by all sizes of the font, so a new size doesn't walk the font directories or start threads again.
+/// Has to outlive its fonts, and fonts sharing it have to be of different sizes.
+class FontFamily {
+public:
+    FontFamily(const std::filesystem::path& path, GlyphFormat format);
+
+    const std::filesystem::path& getPath() const;
+    GlyphFormat getFormat() const;
+    const GlyphRasterizer::StyleFonts& getStyleFonts() const;
+    FontFallback& getFallback();
+    GlyphRasterizer& getRasterizer();
+    /// Stamps of all fallback fonts, glyphs cached from other fonts are outdated
+    const std::unordered_set<uint64_t>& getFallbackStamps() const;
+
+private:
+    /// Bold and italic faces next to the main font, found by replacing "Regular" in its file name
+    /// (e.g. JetBrainsMono-Regular.ttf -> JetBrainsMono-BoldItalic.ttf)
+    static GlyphRasterizer::StyleFonts
+    findStyleFonts(const std::filesystem::path& path);
+    /// Main font followed by the fallback fonts
+    static std::vector<std::filesystem::path>
+    getRasterizerFonts(const std::filesystem::path& path,
+                       const FontFallback& fallback);
+    static std::unordered_set<uint64_t>
+    makeFallbackStamps(const FontFallback& fallback);
+
+    std::filesystem::path m_Path;
+    GlyphFormat m_Format;
+    GlyphRasterizer::StyleFonts m_StyleFonts;
+    FontFallback m_Fallback;
+    std::unordered_set<uint64_t> m_FallbackStamps;
+    GlyphRasterizer m_Rasterizer;
+};
@@ -0,0 +1,116 @@
+#include "font_set.hpp"
+#include <algorithm>
+#include <cmath>
+#include <spdlog/spdlog.h>
+#include <unordered_set>
+
+FontSet::FontSet(const std::filesystem::path& path, float size,
+                 size_t atlasBudget, GlyphFormat format, bool shaping)
+    : m_BaseSize(size), m_AtlasBudget(atlasBudget), m_Shaping(shaping),
+      m_Family(path, format) {
+    const long initialSize = getZoomedSize(m_Zoom);
+    push(Entry{.size = initialSize,
+               .font = std::make_unique<Font>(m_Family, initialSize,
+                                              m_AtlasBudget, m_Shaping)});
+    m_Fonts.front().font->wait();
+}
+
+Font& FontSet::get() {
+    return *m_Fonts.front().font;
+}
+
+bool FontSet::zoom(FontZoom zoom) {
+    const int prevZoom = m_Zoom;
+    switch (zoom) {
+    case FontZoom::None:
+        break;
+    case FontZoom::In:
+        m_Zoom = std::min(m_Zoom + 1, MAX_ZOOM);
+        break;
+    case FontZoom::Out:
+        m_Zoom = std::max(m_Zoom - 1, MIN_ZOOM);
+        break;
+    case FontZoom::Reset:
+        m_Zoom = 0;
+        break;
+    }
+    if (m_Zoom == prevZoom) {
+        return false;
+    }
+
+    SPDLOG_DEBUG("Zoomed font to {}px", getZoomedSize(m_Zoom));
+    if (m_Family.getFormat() == GlyphFormat::Sdf) {
+        return true;
+    }
+    return use(getZoomedSize(m_Zoom));
+}
+
+bool FontSet::update() {
+    if (!m_Loading.has_value()) {
+        return false;
+    }
+
+    std::unordered_set<codepoint_t> none;
+    m_Loading->font->updateAtlas(none);
+    if (!m_Loading->font->isLoaded()) {
+        return false;
+    }
+    SPDLOG_DEBUG("Loaded font of size {}px", m_Loading->size);
+    push(std::move(m_Loading.value()));
+    m_Loading = std::nullopt;
+    return true;
+}
+
+float FontSet::getScale() const {
+    if (m_Family.getFormat() != GlyphFormat::Sdf) {
+        return 1;
+    }
+    return getZoomedSize(m_Zoom) / (float)getZoomedSize(0);
+}
+
+// PRIVATE
+long FontSet::getZoomedSize(int zoom) const {
+    // Whole pixels, so that zooming in and out ends up at sizes which are already cached
+    return std::max(
+        1L, std::lround(m_BaseSize * std::pow(ZOOM_FACTOR, zoom)));
+}
+
+bool FontSet::use(long size) {
+    const auto it = std::find_if(
+        m_Fonts.begin(), m_Fonts.end(),
+        [size](const Entry& entry) { return entry.size == size; });
+    if (it != m_Fonts.end()) {
+        // Zoomed back before the other size finished loading
+        m_Loading = std::nullopt;
+        std::rotate(m_Fonts.begin(), it, it + 1);
+        trimSwappedOut();
+        SPDLOG_DEBUG("Reusing font of size {}px", size);
+        return true;
+    }
+
+    if (m_Loading.has_value() && m_Loading->size == size) {
+        return false;
+    }
+    // A size which is still loading is abandoned, its requests are cancelled
+    m_Loading = std::nullopt;
+    m_Loading = Entry{.size = size,
+                      .font = std::make_unique<Font>(m_Family, size,
+                                                     m_AtlasBudget, m_Shaping)};
+    return false;
+}
+
+void FontSet::push(Entry entry) {
+    if (m_Fonts.size() >= MAX_SIZES) {
+        SPDLOG_DEBUG("Destroying font of size {}px", m_Fonts.back().size);
+        m_Fonts.pop_back();
+    }
+    m_Fonts.insert(m_Fonts.begin(), std::move(entry));
+    trimSwappedOut();
+}
+
+void FontSet::trimSwappedOut() {
+    if (m_Fonts.size() > 1) {
+        SPDLOG_DEBUG("Trimming atlas of font of size {}px", m_Fonts[1].size);
+        m_Fonts[1].font->trimAtlas();
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "atlas.hpp"
+#include "font.hpp"
+#include "font_family.hpp"
+#include "glyph_rasterizer.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+enum class FontZoom {
+    None,
+    In,
+    Out,
+    /// Back to the initial size
+    Reset,
+};
+
+/// The font at the current zoom level. Fonts of recently used sizes are kept together with the first page of their
+/// atlases, so switching back to one of them doesn't rasterize ASCII again, while only the current size takes up the
+/// atlas budget. A font of a new size is loaded in the background
+/// while the previous size is still drawn, and replaces it once ASCII is in its atlas. The rest is rasterized
+/// when it's drawn, so visible glyphs come first.
+/// Distance field fonts are never rasterized at another size, their glyphs are scaled instead.
+/// All sizes share the fallback fonts and the rasterizer, so coverage is only read once and no threads are started.
+class FontSet {
+public:
+    /// Blocks until the font is loaded, so that the first frame isn't drawn with replacement glyphs
+    FontSet(const std::filesystem::path& path, float size,
+            size_t atlasBudget = Atlas::DEFAULT_BUDGET,
+            GlyphFormat format = GlyphFormat::Coverage, bool shaping = false);
+
+    Font& get();
+    /// Returns whether the font returned by get changed, which is false when a new size started loading
+    bool zoom(FontZoom zoom);
+    /// Uploads the glyphs of the size being loaded, called every frame on the render thread.
+    /// Returns whether it finished loading and replaced the current font.
+    bool update();
+    /// Scale to draw the font's glyphs with, only distance field fonts are scaled
+    float getScale() const;
+
+    constexpr static float ZOOM_FACTOR = 1.1f;
+    constexpr static int MIN_ZOOM = -6;
+    constexpr static int MAX_ZOOM = 16;
+    /// Including the current one
+    constexpr static size_t MAX_SIZES = 4;
+
+private:
+    struct Entry {
+        /// Sizes are whole pixels
+        long size;
+        std::unique_ptr<Font> font;
+    };
+
+    long getZoomedSize(int zoom) const;
+    /// Moves the font of the size to the front, or starts loading it if it doesn't exist.
+    /// Returns whether the front font changed.
+    bool use(long size);
+    /// Adds the font to the front, destroying the least recently used one when there are too many
+    void push(Entry entry);
+    /// Frees the atlas pages of the font which was swapped out of the front
+    void trimSwappedOut();
+
+    float m_BaseSize;
+    size_t m_AtlasBudget;
+    bool m_Shaping;
+    /// Declared before the fonts, which use it until they're destroyed
+    FontFamily m_Family;
+    int m_Zoom = 0;
+    /// Most recently used first
+    std::vector<Entry> m_Fonts;
+    /// Font of the current size while it's loaded, the front font is drawn until then
+    std::optional<Entry> m_Loading = std::nullopt;
+};
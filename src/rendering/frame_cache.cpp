@@ -0,0 +1,153 @@
+#include "frame_cache.hpp"
+#include "../utils.hpp"
+#include "opengl.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <spdlog/spdlog.h>
+
+FrameCache::FrameCache(const GLsizei width, const GLsizei height)
+    : m_Width(width), m_Height(height) {
+    glCall(glGenRenderbuffers(2, m_RboIds));
+    glCall(glGenFramebuffers(2, m_FboIds));
+    for (size_t i = 0; i < 2; i++) {
+        glCall(glBindRenderbuffer(GL_RENDERBUFFER, m_RboIds[i]));
+        glCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height));
+        glCall(glBindFramebuffer(GL_FRAMEBUFFER, m_FboIds[i]));
+        glCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                         GL_RENDERBUFFER, m_RboIds[i]));
+
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            FATAL("Failed to create frame cache framebuffer: {:#x}", status);
+        }
+    }
+    glCall(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    invalidate();
+
+    SPDLOG_DEBUG("Created {}x{} frame cache", width, height);
+}
+
+FrameCache::~FrameCache() {
+    glCall(glDeleteFramebuffers(2, m_FboIds));
+    glCall(glDeleteRenderbuffers(2, m_RboIds));
+    SPDLOG_DEBUG("Deleted frame cache");
+}
+
+void FrameCache::scroll(const GLint dy) {
+    if (dy == 0) {
+        return;
+    }
+    if (std::abs(dy) >= m_Height) {
+        invalidate();
+        return;
+    }
+
+    const size_t back = 1 - m_Front;
+    const GLint srcBottom = std::max(0, -dy);
+    const GLint srcTop = m_Height - std::max(0, dy);
+    glCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FboIds[m_Front]));
+    glCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_FboIds[back]));
+    glCall(glBlitFramebuffer(0, srcBottom, m_Width, srcTop, 0, srcBottom + dy,
+                             m_Width, srcTop + dy, GL_COLOR_BUFFER_BIT,
+                             GL_NEAREST));
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    m_Front = back;
+
+    // Pending damage moves together with the content
+    for (Rect& rect : m_Damage) {
+        rect.y += dy;
+    }
+    if (dy > 0) {
+        addDamage(Rect{.x = 0, .y = 0, .width = m_Width, .height = dy});
+    } else {
+        addDamage(Rect{
+            .x = 0, .y = m_Height + dy, .width = m_Width, .height = -dy});
+    }
+}
+
+void FrameCache::addDamage(Rect rect) {
+    const GLint left = std::max(rect.x, 0);
+    const GLint bottom = std::max(rect.y, 0);
+    const GLint right = std::min(rect.x + rect.width, m_Width);
+    const GLint top = std::min(rect.y + rect.height, m_Height);
+    if (left >= right || bottom >= top) {
+        return;
+    }
+    m_Damage.push_back(Rect{.x = left,
+                            .y = bottom,
+                            .width = right - left,
+                            .height = top - bottom});
+}
+
+void FrameCache::invalidate() {
+    m_Damage.assign(
+        1, Rect{.x = 0, .y = 0, .width = m_Width, .height = m_Height});
+}
+
+void FrameCache::redraw(const std::function<void()>& draw) {
+    if (m_Damage.empty()) {
+        return;
+    }
+    mergeDamage();
+
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, m_FboIds[m_Front]));
+    glCall(glEnable(GL_SCISSOR_TEST));
+    size_t pixels = 0;
+    for (const Rect& rect : m_Damage) {
+        glCall(glScissor(rect.x, rect.y, rect.width, rect.height));
+        glCall(glClear(GL_COLOR_BUFFER_BIT));
+        draw();
+        pixels += (size_t)rect.width * rect.height;
+    }
+    // Blits are scissored too
+    glCall(glDisable(GL_SCISSOR_TEST));
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    SPDLOG_TRACE("Redrew {} rects, {} of {} pixels", m_Damage.size(), pixels,
+                 (size_t)m_Width * m_Height);
+    m_Damage.clear();
+}
+
+void FrameCache::present() const {
+    glCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FboIds[m_Front]));
+    glCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    glCall(glBlitFramebuffer(0, 0, m_Width, m_Height, 0, 0, m_Width, m_Height,
+                             GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+// PRIVATE
+void FrameCache::mergeDamage() {
+    // Overlapping or touching rectangles are replaced by their bounding box
+    std::sort(m_Damage.begin(), m_Damage.end(),
+              [](const Rect& a, const Rect& b) { return a.y < b.y; });
+    const auto merge = [](Rect& into, const Rect& rect) {
+        const GLint left = std::min(into.x, rect.x);
+        const GLint right =
+            std::max(into.x + into.width, rect.x + rect.width);
+        const GLint top =
+            std::max(into.y + into.height, rect.y + rect.height);
+        into.x = left;
+        into.width = right - left;
+        into.height = top - into.y;
+    };
+
+    std::vector<Rect> merged;
+    for (const Rect& rect : m_Damage) {
+        if (!merged.empty() &&
+            rect.y <= merged.back().y + merged.back().height) {
+            merge(merged.back(), rect);
+        } else {
+            merged.push_back(rect);
+        }
+    }
+
+    if (merged.size() > MAX_DAMAGE_RECTS) {
+        for (size_t i = 1; i < merged.size(); i++) {
+            merge(merged[0], merged[i]);
+        }
+        merged.resize(1);
+    }
+    m_Damage = std::move(merged);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "opengl.hpp"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/// Offscreen copy of the terminal content which persists across frames.
+/// Scrolling shifts the previous frame with a blit, other changes only redraw the damaged rectangles.
+class FrameCache {
+public:
+    /// In framebuffer pixels, origin at the bottom left like glScissor
+    struct Rect {
+        GLint x;
+        GLint y;
+        GLsizei width;
+        GLsizei height;
+    };
+
+    FrameCache() = delete;
+    FrameCache(const GLsizei width, const GLsizei height);
+    ~FrameCache();
+
+    /// Moves the cached content up by dy pixels (down when negative), the exposed strip becomes damaged
+    void scroll(const GLint dy);
+    /// Rectangles are clipped to the framebuffer, empty ones are ignored
+    void addDamage(Rect rect);
+    /// Everything is redrawn on the next call to redraw()
+    void invalidate();
+    /// Clears every damaged rectangle and calls draw with the scissor set to it
+    void redraw(const std::function<void()>& draw);
+    /// Copies the cached frame to the default framebuffer
+    void present() const;
+
+    /// More rectangles than this are merged into their bounding box, each one costs a draw call
+    constexpr static size_t MAX_DAMAGE_RECTS = 8;
+
+private:
+    void mergeDamage();
+
+    GLsizei m_Width;
+    GLsizei m_Height;
+    /// Blits between overlapping regions of the same framebuffer are undefined, so scrolling ping-pongs between two
+    GLuint m_FboIds[2] = {0, 0};
+    GLuint m_RboIds[2] = {0, 0};
+    size_t m_Front = 0;
+    std::vector<Rect> m_Damage;
+};
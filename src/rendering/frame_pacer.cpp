@@ -0,0 +1,89 @@
+#include "frame_pacer.hpp"
+#include "../trace.hpp"
+#include "opengl.hpp"
+#include <spdlog/spdlog.h>
+#include <thread>
+
+FramePacer::FramePacer(SDL_Window* window)
+    : m_Window(window), m_LastVblank(Clock::now()) {
+    SDL_DisplayMode mode;
+    int refreshRate = 60;
+    if (SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0) {
+        refreshRate = mode.refresh_rate;
+    } else {
+        SPDLOG_WARN("Unknown refresh rate, assuming {} Hz", refreshRate);
+    }
+    m_RefreshPeriod = std::chrono::microseconds(1'000'000 / refreshRate);
+    setSwapInterval();
+
+    SPDLOG_DEBUG("Initialized frame pacer ({} Hz)", refreshRate);
+}
+
+void FramePacer::setPacing(const FramePacing pacing,
+                           const std::chrono::microseconds deadline) {
+    m_Deadline = deadline;
+    if (pacing == m_Pacing) {
+        return;
+    }
+    m_Pacing = pacing;
+    setSwapInterval();
+}
+
+FramePacing FramePacer::getPacing() const {
+    return m_Pacing;
+}
+
+void FramePacer::waitForFrameStart() {
+    if (m_Pacing != FramePacing::LowLatency) {
+        return;
+    }
+
+    // Without vsync this also limits the frame rate to the refresh rate
+    const Clock::time_point start =
+        m_LastVblank + m_RefreshPeriod - m_Deadline;
+    if (Clock::now() < start) {
+        std::this_thread::sleep_until(start);
+    }
+}
+
+void FramePacer::swap() {
+    {
+        Trace::Span span("SDL_GL_SwapWindow");
+        SDL_GL_SwapWindow(m_Window);
+    }
+    if (m_Pacing != FramePacing::LowLatency) {
+        return;
+    }
+
+    // The fence signals once the GPU has processed the swap, waiting for it keeps the driver from queueing frames
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    constexpr GLuint64 TIMEOUT_NS = 100'000'000;
+    const GLenum result =
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, TIMEOUT_NS);
+    if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+        SPDLOG_TRACE("Frame fence wait failed: {:#x}", result);
+    }
+    glCall(glDeleteSync(fence));
+
+    m_LastVblank = Clock::now();
+}
+
+// PRIVATE
+void FramePacer::setSwapInterval() {
+    if (m_Pacing == FramePacing::VSync) {
+        SDL_GL_SetSwapInterval(1);
+        SPDLOG_INFO("Frame pacing: vsync");
+        return;
+    }
+
+    // Adaptive vsync tears instead of waiting a whole refresh period when a frame is late
+    if (SDL_GL_SetSwapInterval(-1) == 0) {
+        SPDLOG_INFO("Frame pacing: low latency, adaptive vsync");
+    } else if (SDL_GL_SetSwapInterval(1) == 0) {
+        SPDLOG_INFO("Frame pacing: low latency, adaptive vsync unsupported, "
+                    "falling back to vsync");
+    } else {
+        SPDLOG_WARN("Frame pacing: low latency, vsync unsupported: {}",
+                    SDL_GetError());
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "opengl.hpp"
+#include <SDL.h>
+#include <chrono>
+
+enum class FramePacing {
+    /// Regular vsync, the driver is free to queue frames
+    VSync,
+    /// Adaptive vsync with at most one frame in flight. The next frame is started as late as possible before the vblank,
+    /// so that input and terminal output which arrived in the meantime still make it to the screen.
+    LowLatency,
+};
+
+class FramePacer {
+public:
+    FramePacer() = delete;
+    FramePacer(SDL_Window* window);
+
+    /// Deadline is how long before the next vblank the frame is started, it has to fit event handling, mesh building and drawing
+    void setPacing(const FramePacing pacing,
+                   const std::chrono::microseconds deadline);
+    FramePacing getPacing() const;
+    /// In FramePacing::LowLatency sleeps until the deadline before the next vblank
+    void waitForFrameStart();
+    /// Swaps buffers. In FramePacing::LowLatency also waits until the GPU is done with the frame.
+    void swap();
+
+    constexpr static std::chrono::microseconds DEFAULT_DEADLINE =
+        std::chrono::milliseconds(4);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void setSwapInterval();
+
+    SDL_Window* m_Window;
+    FramePacing m_Pacing = FramePacing::VSync;
+    std::chrono::microseconds m_Deadline = DEFAULT_DEADLINE;
+    std::chrono::microseconds m_RefreshPeriod;
+    /// When the last frame finished on the GPU, which is the best available estimate of the last vblank
+    Clock::time_point m_LastVblank;
+};
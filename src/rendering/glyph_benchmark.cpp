@@ -0,0 +1,121 @@
+#include "glyph_benchmark.hpp"
+#include "atlas.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <spdlog/fmt/fmt.h>
+#include <stb_rect_pack.h>
+
+int GlyphBenchmark::run(const std::filesystem::path& font) {
+    if (!std::filesystem::exists(font)) {
+        fmt::print(stderr, "Font '{}' doesn't exist\n", font.c_str());
+        return EXIT_FAILURE;
+    }
+
+    fmt::print("{:<10}{:>6}{:>8}{:>12}{:>13}{:>8}\n", "format", "size",
+               "glyphs", "raster ms", "bitmap KiB", "pages");
+    const auto print = [](GlyphFormat format, float size,
+                          const Result& result) {
+        fmt::print("{:<10}{:>6}{:>8}{:>12.2f}{:>13.1f}{:>8}\n",
+                   GlyphRasterizer::getFormatName(format), size,
+                   result.glyphs, result.rasterMs,
+                   result.bitmapBytes / 1024.0, result.atlasPages);
+    };
+
+    Result coverage = {};
+    for (const float size : ZOOM_SIZES) {
+        const Result result = measure(font, size, GlyphFormat::Coverage);
+        print(GlyphFormat::Coverage, size, result);
+        coverage.rasterMs += result.rasterMs;
+        coverage.glyphs += result.glyphs;
+        coverage.bitmapBytes += result.bitmapBytes;
+        coverage.atlasPages += result.atlasPages;
+    }
+    const Result sdf = measure(font, BASE_SIZE, GlyphFormat::Sdf);
+    print(GlyphFormat::Sdf, BASE_SIZE, sdf);
+
+    fmt::print("\nAll {} zoom levels: coverage {:.2f} ms, {:.1f} KiB, {} "
+               "pages; sdf {:.2f} ms, {:.1f} KiB, {} pages\n",
+               std::size(ZOOM_SIZES), coverage.rasterMs,
+               coverage.bitmapBytes / 1024.0, coverage.atlasPages,
+               sdf.rasterMs, sdf.bitmapBytes / 1024.0, sdf.atlasPages);
+    return EXIT_SUCCESS;
+}
+
+// PRIVATE
+GlyphBenchmark::Result
+GlyphBenchmark::measure(const std::filesystem::path& font, float size,
+                        GlyphFormat format) {
+    std::vector<GlyphRequest> requests;
+    for (const codepoint_t c : getCodepoints()) {
+        requests.push_back(
+            GlyphRequest{.codepoint = c, .font = 0, .size = size});
+    }
+
+    // Same thread count as the terminal, the time includes opening the font like on startup
+    const auto start = std::chrono::steady_clock::now();
+    GlyphRasterizer rasterizer({font}, format,
+                               GlyphRasterizer::getDefaultThreadCount());
+    rasterizer.request(requests);
+    rasterizer.wait();
+    const auto end = std::chrono::steady_clock::now();
+
+    std::vector<RasterizedGlyph> glyphs;
+    rasterizer.collect(size, glyphs);
+    Result result = {
+        .rasterMs =
+            std::chrono::duration<double, std::milli>(end - start).count(),
+        .glyphs = glyphs.size(),
+        .bitmapBytes = 0,
+        .atlasPages = countPages(glyphs),
+    };
+    for (const RasterizedGlyph& glyph : glyphs) {
+        result.bitmapBytes += glyph.bitmap.size();
+    }
+    return result;
+}
+
+size_t GlyphBenchmark::countPages(const std::vector<RasterizedGlyph>& glyphs) {
+    std::vector<stbrp_rect> rects;
+    for (const RasterizedGlyph& glyph : glyphs) {
+        rects.push_back(
+            stbrp_rect{.id = 0,
+                       .w = static_cast<stbrp_coord>(glyph.width),
+                       .h = static_cast<stbrp_coord>(glyph.height),
+                       .x = 0,
+                       .y = 0,
+                       .was_packed = 0});
+    }
+
+    // Packed like the atlas does it, without creating textures
+    size_t pages = 0;
+    std::vector<stbrp_node> nodes(Atlas::PAGE_SIZE);
+    while (!rects.empty()) {
+        stbrp_context context;
+        stbrp_init_target(&context, Atlas::PAGE_SIZE, Atlas::PAGE_SIZE,
+                          nodes.data(), nodes.size());
+        stbrp_pack_rects(&context, rects.data(), rects.size());
+        const size_t packed = std::erase_if(
+            rects, [](const stbrp_rect& rect) { return rect.was_packed; });
+        if (packed == 0) {
+            break;
+        }
+        pages++;
+    }
+    return pages;
+}
+
+std::vector<codepoint_t> GlyphBenchmark::getCodepoints() {
+    // ASCII, Latin-1 and box drawing, what a shell session mostly consists of
+    std::vector<codepoint_t> codepoints;
+    for (codepoint_t c = ' '; c <= '~'; c++) {
+        codepoints.push_back(c);
+    }
+    for (codepoint_t c = 0xa0; c <= 0xff; c++) {
+        codepoints.push_back(c);
+    }
+    for (codepoint_t c = 0x2500; c <= 0x259f; c++) {
+        codepoints.push_back(c);
+    }
+    return codepoints;
+}
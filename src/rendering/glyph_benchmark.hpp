@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../terminal/unicode.hpp"
+#include "glyph_rasterizer.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+/// Compares glyph formats without opening a window, run with `yate --bench-glyphs [font]`.
+/// A coverage atlas has to be rasterized again at every zoom level, a distance field atlas only once,
+/// so coverage glyphs are measured at all zoom levels and distance field glyphs at the base size.
+class GlyphBenchmark {
+public:
+    static int run(const std::filesystem::path& font);
+
+    constexpr static float BASE_SIZE = 16;
+    constexpr static float ZOOM_SIZES[] = {12, 16, 20, 24, 32, 48};
+
+private:
+    struct Result {
+        double rasterMs;
+        size_t glyphs;
+        size_t bitmapBytes;
+        size_t atlasPages;
+    };
+
+    static Result measure(const std::filesystem::path& font, float size,
+                          GlyphFormat format);
+    static size_t countPages(const std::vector<RasterizedGlyph>& glyphs);
+    static std::vector<codepoint_t> getCodepoints();
+};
@@ -0,0 +1,291 @@
+#include "glyph_cache.hpp"
+#include "../utils.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr char MAGIC[8] = {'Y', 'A', 'T', 'E', 'G', 'L', 'Y', 'F'};
+
+GlyphCache::GlyphCache(const std::filesystem::path& fontPath, float size,
+                       const char* renderMode,
+                       std::unordered_set<uint64_t> fallbackStamps)
+    : m_FallbackStamps(std::move(fallbackStamps)) {
+    const std::optional<std::filesystem::path> dir = getCacheDir();
+    if (!dir.has_value()) {
+        SPDLOG_WARN("No cache directory, glyph cache disabled");
+        return;
+    }
+
+    // Size in 26.6 fixed point, like FT_Set_Char_Size
+    m_Path = dir.value() / fmt::format("glyphs-{:016x}-{}-{}.bin",
+                                       hashFile(fontPath),
+                                       (uint32_t)(size * 64), renderMode);
+    load();
+}
+
+GlyphCache::~GlyphCache() {
+    if (m_Data != nullptr) {
+        munmap((void*)m_Data, m_Size);
+    }
+}
+
+std::optional<RasterizedGlyph> GlyphCache::get(codepoint_t codepoint) {
+    if (const auto it = m_New.find(codepoint); it != m_New.end()) {
+        m_Used.insert(codepoint);
+        return it->second.glyph;
+    }
+
+    const auto it = m_Entries.find(codepoint);
+    if (it == m_Entries.end()) {
+        return std::nullopt;
+    }
+    EntryHeader entry;
+    std::memcpy(&entry, m_Data + it->second, sizeof(EntryHeader));
+    if (isOutdated(entry)) {
+        return std::nullopt;
+    }
+    m_Used.insert(codepoint);
+
+    const uint8_t* bitmap = m_Data + it->second + sizeof(EntryHeader);
+    return RasterizedGlyph{
+        .codepoint = codepoint,
+        .metrics = entry.metrics,
+        .width = entry.width,
+        .height = entry.height,
+        .bitmap = std::vector<uint8_t>(
+            bitmap, bitmap + (size_t)entry.width * entry.height),
+    };
+}
+
+void GlyphCache::add(const RasterizedGlyph& glyph, uint64_t fontStamp) {
+    m_New[glyph.codepoint] = NewGlyph{.glyph = glyph, .fontStamp = fontStamp};
+    m_Used.insert(glyph.codepoint);
+}
+
+std::vector<codepoint_t> GlyphCache::getMostUsed(size_t count) const {
+    std::vector<std::pair<uint32_t, codepoint_t>> used;
+    used.reserve(m_Entries.size());
+    for (const auto& [codepoint, offset] : m_Entries) {
+        EntryHeader entry;
+        std::memcpy(&entry, m_Data + offset, sizeof(EntryHeader));
+        used.emplace_back(entry.useCount, codepoint);
+    }
+
+    count = std::min(count, used.size());
+    std::partial_sort(used.begin(), used.begin() + count, used.end(),
+                      std::greater<>());
+
+    std::vector<codepoint_t> codepoints;
+    codepoints.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        codepoints.push_back(used[i].second);
+    }
+    return codepoints;
+}
+
+void GlyphCache::save() {
+    if (!m_Path.has_value() || (m_New.empty() && m_Used.empty())) {
+        return;
+    }
+
+    // Most used glyphs first, the ones which don't fit into MAX_BYTES are dropped
+    struct Kept {
+        uint32_t useCount;
+        /// Offset of a cached glyph, nothing for a new glyph
+        std::optional<size_t> offset;
+        codepoint_t codepoint;
+    };
+    std::vector<Kept> kept;
+    for (const auto& [codepoint, offset] : m_Entries) {
+        EntryHeader entry;
+        std::memcpy(&entry, m_Data + offset, sizeof(EntryHeader));
+        // Outdated glyphs which were rasterized again are new
+        if (!isOutdated(entry) && !m_New.contains(codepoint)) {
+            kept.push_back(Kept{
+                .useCount =
+                    entry.useCount + (m_Used.contains(codepoint) ? 1 : 0),
+                .offset = offset,
+                .codepoint = codepoint});
+        }
+    }
+    for (const auto& [codepoint, glyph] : m_New) {
+        kept.push_back(Kept{
+            .useCount = 1, .offset = std::nullopt, .codepoint = codepoint});
+    }
+    std::sort(kept.begin(), kept.end(), [](const Kept& a, const Kept& b) {
+        return a.useCount > b.useCount;
+    });
+    size_t bytes = sizeof(Header);
+    size_t count = 0;
+    for (; count < kept.size(); count++) {
+        const Kept& glyph = kept[count];
+        size_t bitmapSize = 0;
+        if (glyph.offset.has_value()) {
+            EntryHeader entry;
+            std::memcpy(&entry, m_Data + glyph.offset.value(),
+                        sizeof(EntryHeader));
+            bitmapSize = (size_t)entry.width * entry.height;
+        } else {
+            bitmapSize = m_New.at(glyph.codepoint).glyph.bitmap.size();
+        }
+        if (bytes + sizeof(EntryHeader) + bitmapSize > MAX_BYTES) {
+            break;
+        }
+        bytes += sizeof(EntryHeader) + bitmapSize;
+    }
+    if (count < kept.size()) {
+        SPDLOG_DEBUG("Glyph cache is full, dropping {} least used glyphs",
+                     kept.size() - count);
+    }
+
+    // Written next to the old file and renamed over it, so that other processes never read a partial file.
+    // When several processes save at the same time, the last one wins, which is fine for a cache.
+    const std::filesystem::path tmpPath =
+        m_Path.value().string() + fmt::format(".{}", getpid());
+    std::ofstream file(tmpPath, std::ios::binary);
+    if (!file) {
+        SPDLOG_WARN("Failed to write glyph cache '{}'", tmpPath.c_str());
+        return;
+    }
+
+    Header header = {.magic = {}, .version = VERSION, .count = (uint32_t)count};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    file.write((const char*)&header, sizeof(Header));
+
+    for (size_t i = 0; i < count; i++) {
+        const Kept& glyph = kept[i];
+        if (glyph.offset.has_value()) {
+            const size_t offset = glyph.offset.value();
+            EntryHeader entry;
+            std::memcpy(&entry, m_Data + offset, sizeof(EntryHeader));
+            entry.useCount = glyph.useCount;
+            file.write((const char*)&entry, sizeof(EntryHeader));
+            file.write((const char*)(m_Data + offset + sizeof(EntryHeader)),
+                       (size_t)entry.width * entry.height);
+            continue;
+        }
+
+        const NewGlyph& newGlyph = m_New.at(glyph.codepoint);
+        const EntryHeader entry = {
+            .codepoint = glyph.codepoint,
+            .useCount = glyph.useCount,
+            .width = newGlyph.glyph.width,
+            .height = newGlyph.glyph.height,
+            .metrics = newGlyph.glyph.metrics,
+            .fontStamp = newGlyph.fontStamp,
+        };
+        file.write((const char*)&entry, sizeof(EntryHeader));
+        file.write((const char*)newGlyph.glyph.bitmap.data(),
+                   newGlyph.glyph.bitmap.size());
+    }
+    file.close();
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, m_Path.value(), error);
+    if (error) {
+        SPDLOG_WARN("Failed to replace glyph cache '{}': {}",
+                    m_Path.value().c_str(), error.message());
+        std::filesystem::remove(tmpPath, error);
+        return;
+    }
+    SPDLOG_DEBUG("Saved {} glyphs to glyph cache ({} new)", header.count,
+                 m_New.size());
+}
+
+// PRIVATE
+void GlyphCache::load() {
+    const int fd = open(m_Path.value().c_str(), O_RDONLY);
+    if (fd == -1) {
+        SPDLOG_DEBUG("No glyph cache at '{}'", m_Path.value().c_str());
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(Header)) {
+        close(fd);
+        return;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        SPDLOG_WARN("Failed to map glyph cache '{}'", m_Path.value().c_str());
+        return;
+    }
+    m_Data = (const uint8_t*)data;
+    m_Size = st.st_size;
+
+    Header header;
+    std::memcpy(&header, m_Data, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION) {
+        SPDLOG_DEBUG("Ignoring glyph cache with another version");
+        return;
+    }
+
+    size_t offset = sizeof(Header);
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (offset + sizeof(EntryHeader) > m_Size) {
+            break;
+        }
+        EntryHeader entry;
+        std::memcpy(&entry, m_Data + offset, sizeof(EntryHeader));
+        const size_t bitmapSize = (size_t)entry.width * entry.height;
+        if (offset + sizeof(EntryHeader) + bitmapSize > m_Size) {
+            break;
+        }
+        m_Entries[entry.codepoint] = offset;
+        offset += sizeof(EntryHeader) + bitmapSize;
+    }
+    if (m_Entries.size() != header.count) {
+        SPDLOG_WARN("Glyph cache '{}' is truncated", m_Path.value().c_str());
+    }
+
+    SPDLOG_DEBUG("Loaded {} glyphs from glyph cache '{}'", m_Entries.size(),
+                 m_Path.value().c_str());
+}
+
+bool GlyphCache::isOutdated(const EntryHeader& entry) const {
+    return entry.fontStamp != 0 && !m_FallbackStamps.contains(entry.fontStamp);
+}
+
+// STATIC
+uint64_t GlyphCache::hashFile(const std::filesystem::path& path) {
+    // Every size of the font has a cache, so the hash is only computed again when the file changes
+    struct Hash {
+        int64_t mtime;
+        uint64_t size;
+        uint64_t hash;
+    };
+    static std::mutex mutex;
+    static std::unordered_map<std::string, Hash> hashes;
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    getFileStamp(path, mtime, size);
+    std::unique_lock lock(mutex);
+    if (const auto it = hashes.find(path.string());
+        it != hashes.end() && it->second.mtime == mtime &&
+        it->second.size == size) {
+        return it->second.hash;
+    }
+
+    // FNV-1a
+    std::ifstream file(path, std::ios::binary);
+    uint64_t hash = 0xcbf29ce484222325;
+    char buf[64 * 1024];
+    while (file.read(buf, sizeof(buf)) || file.gcount() > 0) {
+        for (std::streamsize i = 0; i < file.gcount(); i++) {
+            hash ^= (uint8_t)buf[i];
+            hash *= 0x100000001b3;
+        }
+    }
+    hashes[path.string()] = Hash{.mtime = mtime, .size = size, .hash = hash};
+    return hash;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../terminal/unicode.hpp"
+#include "glyph_rasterizer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// Rasterized glyphs stored in $XDG_CACHE_HOME/yate, so that new processes don't have to rasterize them again.
+/// There is a file per font file hash, size and render mode. It's memory-mapped when the font is loaded,
+/// glyphs rasterized during the session are added to it when the font is destroyed.
+/// Glyphs of fallback fonts are stored with the stamp of their font, so that they're rasterized again when it changes.
+class GlyphCache {
+public:
+    /// fallbackStamps: see FontFallback::getStamp, glyphs of fallback fonts with other stamps are outdated
+    GlyphCache(const std::filesystem::path& fontPath, float size,
+               const char* renderMode,
+               std::unordered_set<uint64_t> fallbackStamps);
+    ~GlyphCache();
+
+    /// Marks the glyph as used in this session
+    std::optional<RasterizedGlyph> get(codepoint_t codepoint);
+    /// fontStamp: stamp of the fallback font the glyph was rendered from, 0 for the main font
+    void add(const RasterizedGlyph& glyph, uint64_t fontStamp);
+    /// Codepoints used in the most sessions
+    std::vector<codepoint_t> getMostUsed(size_t count) const;
+    /// Writes the cached and new glyphs to a new file, which replaces the old one.
+    /// Glyphs used in the fewest sessions are left out when the file would be larger than MAX_BYTES.
+    void save();
+
+    constexpr static uint32_t VERSION = 2;
+    constexpr static size_t MAX_BYTES = 16 * 1024 * 1024;
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t count;
+    };
+    /// Followed by width * height bytes of the bitmap
+    struct EntryHeader {
+        codepoint_t codepoint;
+        /// Number of sessions which used the glyph
+        uint32_t useCount;
+        uint32_t width;
+        uint32_t height;
+        FT_Glyph_Metrics metrics;
+        /// Of the fallback font the glyph was rendered from, 0 for the main font, whose hash is in the file name
+        uint64_t fontStamp;
+    };
+    struct NewGlyph {
+        RasterizedGlyph glyph;
+        uint64_t fontStamp;
+    };
+
+    void load();
+    bool isOutdated(const EntryHeader& entry) const;
+    /// Hash of the font file's contents, memoized by its path, modification time and size
+    static uint64_t hashFile(const std::filesystem::path& path);
+
+    std::optional<std::filesystem::path> m_Path = std::nullopt;
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+    /// Offsets of entries in the mapped file
+    std::unordered_map<codepoint_t, size_t> m_Entries;
+    std::unordered_map<codepoint_t, NewGlyph> m_New;
+    std::unordered_set<codepoint_t> m_Used;
+    std::unordered_set<uint64_t> m_FallbackStamps;
+};
@@ -0,0 +1,297 @@
+#include "glyph_rasterizer.hpp"
+#include "../stats.hpp"
+#include "../trace.hpp"
+#include "../utils.hpp"
+#include <algorithm>
+#include <freetype/ftmodapi.h>
+#include <freetype/ftsynth.h>
+#include <iterator>
+#include <spdlog/spdlog.h>
+
+GlyphRasterizer::GlyphRasterizer(
+    const std::vector<std::filesystem::path>& fonts, GlyphFormat format,
+    size_t threads, const StyleFonts& styleFonts)
+    : m_Fonts(fonts), m_StyleFonts(styleFonts), m_Format(format) {
+    for (size_t i = 0; i < threads; i++) {
+        m_Workers.emplace_back([this, i]() { work(i); });
+    }
+    SPDLOG_DEBUG("Started {} glyph rasterizer threads", threads);
+}
+
+GlyphRasterizer::~GlyphRasterizer() {
+    {
+        std::unique_lock lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_RequestCv.notify_all();
+    for (std::thread& worker : m_Workers) {
+        worker.join();
+    }
+    SPDLOG_DEBUG("Stopped glyph rasterizer threads");
+}
+
+void GlyphRasterizer::request(const std::vector<GlyphRequest>& requests) {
+    if (requests.empty()) {
+        return;
+    }
+    {
+        std::unique_lock lock(m_Mutex);
+        m_Requests.insert(m_Requests.end(), requests.begin(), requests.end());
+        m_Pending += requests.size();
+        for (const GlyphRequest& request : requests) {
+            m_Sizes.insert(getSizeKey(request.size));
+        }
+    }
+    m_RequestCv.notify_all();
+}
+
+void GlyphRasterizer::collect(float size, std::vector<RasterizedGlyph>& out) {
+    std::unique_lock lock(m_Mutex);
+    const auto it = m_Finished.find(getSizeKey(size));
+    if (it == m_Finished.end()) {
+        return;
+    }
+    out.insert(out.end(), std::make_move_iterator(it->second.begin()),
+               std::make_move_iterator(it->second.end()));
+    m_Finished.erase(it);
+}
+
+void GlyphRasterizer::cancel(float size) {
+    {
+        std::unique_lock lock(m_Mutex);
+        const uint32_t key = getSizeKey(size);
+        m_Pending -= std::erase_if(m_Requests, [key](const GlyphRequest& r) {
+            return getSizeKey(r.size) == key;
+        });
+        m_Finished.erase(key);
+        m_Sizes.erase(key);
+    }
+    m_FinishedCv.notify_all();
+}
+
+void GlyphRasterizer::wait() {
+    std::unique_lock lock(m_Mutex);
+    m_FinishedCv.wait(lock, [this]() { return m_Pending == 0; });
+}
+
+// STATIC
+size_t GlyphRasterizer::getDefaultThreadCount() {
+    // Leave cores for the render and terminal threads
+    return std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 4);
+}
+
+const char* GlyphRasterizer::getFormatName(GlyphFormat format) {
+    switch (format) {
+    case GlyphFormat::Coverage:
+        return "normal";
+    case GlyphFormat::Sdf:
+        return "sdf";
+    }
+    return "unknown";
+}
+
+// PRIVATE
+uint32_t GlyphRasterizer::getSizeKey(float size) {
+    return (uint32_t)(size * 64);
+}
+
+void GlyphRasterizer::work([[maybe_unused]] size_t id) {
+    Trace::setThreadName("rasterizer");
+    FT_Error error = 0;
+    FT_Library lib;
+    error = FT_Init_FreeType(&lib);
+    if (error) {
+        FATAL("Failed to initialize freetype");
+    }
+    if (m_Format == GlyphFormat::Sdf) {
+        // Set explicitly, the shaders depend on it
+        const FT_Int spread = SDF_SPREAD;
+        FT_Property_Set(lib, "sdf", "spread", &spread);
+        FT_Property_Set(lib, "bsdf", "spread", &spread);
+    }
+
+    // Faces are shared by all sizes, the size is only set again when it changes between requests
+    const auto setSize = [](FT_Face face, uint32_t& current, float size) {
+        if (current != getSizeKey(size)) {
+            current = getSizeKey(size);
+            FT_Set_Char_Size(face, 0, current, 0, 0);
+        }
+    };
+
+    // Opened on first use, most fallback fonts are never needed
+    std::vector<FT_Face> faces(m_Fonts.size(), nullptr);
+    std::vector<uint32_t> faceSizes(m_Fonts.size(), 0);
+    const auto getFace = [&](uint16_t font, float size) -> FT_Face {
+        if (faces[font] != nullptr) {
+            setSize(faces[font], faceSizes[font], size);
+            return faces[font];
+        }
+        error = FT_New_Face(lib, m_Fonts[font].c_str(), 0, &faces[font]);
+        if (error) {
+            if (font == 0) {
+                FATAL("Failed to load font '{}'", m_Fonts[font].c_str());
+            }
+            SPDLOG_WARN("Failed to load fallback font '{}'",
+                        m_Fonts[font].c_str());
+            faces[font] = nullptr;
+            return nullptr;
+        }
+        setSize(faces[font], faceSizes[font], size);
+        return faces[font];
+    };
+    if (FT_New_Face(lib, m_Fonts[0].c_str(), 0, &faces[0]) != 0) {
+        FATAL("Failed to load font '{}'", m_Fonts[0].c_str());
+    }
+
+    // Also opened on first use, styled text is rare. A face which fails to load is synthesized instead.
+    std::array<FT_Face, cell_style::COUNT> styleFaces = {};
+    std::array<uint32_t, cell_style::COUNT> styleSizes = {};
+    std::array<bool, cell_style::COUNT> styleFailed = {};
+    const auto getStyleFace = [&](uint8_t style, float size) -> FT_Face {
+        if (style == cell_style::REGULAR || styleFailed[style] ||
+            !m_StyleFonts[style].has_value()) {
+            return nullptr;
+        }
+        if (styleFaces[style] != nullptr) {
+            setSize(styleFaces[style], styleSizes[style], size);
+            return styleFaces[style];
+        }
+        const std::filesystem::path& path = m_StyleFonts[style].value();
+        if (FT_New_Face(lib, path.c_str(), 0, &styleFaces[style]) != 0) {
+            SPDLOG_WARN("Failed to load font '{}', synthesizing it",
+                        path.c_str());
+            styleFaces[style] = nullptr;
+            styleFailed[style] = true;
+            return nullptr;
+        }
+        setSize(styleFaces[style], styleSizes[style], size);
+        return styleFaces[style];
+    };
+
+    while (true) {
+        GlyphRequest request;
+        {
+            std::unique_lock lock(m_Mutex);
+            m_RequestCv.wait(
+                lock, [this]() { return m_Stop || !m_Requests.empty(); });
+            if (m_Stop) {
+                break;
+            }
+            request = m_Requests.front();
+            m_Requests.pop_front();
+        }
+
+        // Fallback fonts only have their regular face, their styles are always synthesized
+        const uint8_t style = getKeyStyle(request.codepoint);
+        std::optional<RasterizedGlyph> glyph = std::nullopt;
+        if (request.font != 0) {
+            if (FT_Face face = getFace(request.font, request.size);
+                face != nullptr) {
+                glyph = rasterize(face, request.codepoint, m_Format, style);
+                glyph->font = request.font;
+            }
+        }
+        if (!glyph.has_value() && style != cell_style::REGULAR) {
+            if (FT_Face face = getStyleFace(style, request.size);
+                face != nullptr) {
+                glyph = rasterize(face, request.codepoint, m_Format,
+                                  cell_style::REGULAR);
+            }
+        }
+        // Fallback fonts which fail to render (e.g. color bitmap fonts) fall back to the main font's .notdef
+        if (!glyph.has_value() || glyph->missing) {
+            glyph = rasterize(getFace(0, request.size), request.codepoint,
+                              m_Format, style);
+        }
+
+        {
+            std::unique_lock lock(m_Mutex);
+            const uint32_t key = getSizeKey(request.size);
+            if (m_Sizes.contains(key)) {
+                m_Finished[key].push_back(std::move(glyph.value()));
+            }
+            m_Pending--;
+        }
+        m_FinishedCv.notify_all();
+        Stats::add(Counter::GlyphsRasterized, 1);
+        SPDLOG_TRACE("Rasterizer {} finished glyph '{}' from font {}", id,
+                     request.codepoint, request.font);
+    }
+
+    for (FT_Face face : faces) {
+        if (face != nullptr) {
+            FT_Done_Face(face);
+        }
+    }
+    for (FT_Face face : styleFaces) {
+        if (face != nullptr) {
+            FT_Done_Face(face);
+        }
+    }
+    FT_Done_FreeType(lib);
+}
+
+RasterizedGlyph GlyphRasterizer::rasterize(FT_Face face, codepoint_t key,
+                                           GlyphFormat format,
+                                           uint8_t synthesize) {
+    Trace::Span span("GlyphRasterizer::rasterize");
+    const codepoint_t codepoint = getKeyGlyph(key);
+    const FT_UInt glyphIndex = (codepoint & GLYPH_INDEX_BIT) != 0
+                                   ? codepoint & ~GLYPH_INDEX_BIT
+                                   : FT_Get_Char_Index(face, codepoint);
+    RasterizedGlyph glyph = {.codepoint = key,
+                             .metrics = {},
+                             .width = 0,
+                             .height = 0,
+                             .bitmap = {},
+                             .missing = glyphIndex == 0};
+
+    if (FT_Load_Glyph(face, glyphIndex, FT_LOAD_DEFAULT) != 0) {
+        SPDLOG_DEBUG("Failed to load glyph '{}' from '{}'", codepoint,
+                     face->family_name ? face->family_name : "?");
+        glyph.missing = true;
+        return glyph;
+    }
+    if (face->glyph->format == FT_GLYPH_FORMAT_OUTLINE) {
+        if (synthesize & cell_style::ITALIC) {
+            FT_GlyphSlot_Oblique(face->glyph);
+        }
+        if (synthesize & cell_style::BOLD) {
+            FT_GlyphSlot_Embolden(face->glyph);
+        }
+    }
+    glyph.metrics = face->glyph->metrics;
+    // The SDF renderer fails on empty outlines, there is nothing to draw anyway
+    if (format == GlyphFormat::Sdf &&
+        face->glyph->format == FT_GLYPH_FORMAT_OUTLINE &&
+        face->glyph->outline.n_points == 0) {
+        return glyph;
+    }
+
+    const FT_Bitmap& bitmap = face->glyph->bitmap;
+    const FT_Render_Mode mode = format == GlyphFormat::Sdf
+                                    ? FT_RENDER_MODE_SDF
+                                    : FT_RENDER_MODE_NORMAL;
+    // Only 8-bit coverage fits the atlas, empty bitmaps (e.g. space) have no pixel mode
+    if (FT_Render_Glyph(face->glyph, mode) != 0 ||
+        (bitmap.width > 0 && bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)) {
+        SPDLOG_DEBUG("Failed to render glyph '{}' from '{}'", codepoint,
+                     face->family_name ? face->family_name : "?");
+        glyph.missing = true;
+        return glyph;
+    }
+
+    glyph.width = bitmap.width;
+    glyph.height = bitmap.rows;
+    if (format == GlyphFormat::Sdf) {
+        // The field extends past the outline by the spread, so the quad is made to cover the whole bitmap
+        glyph.metrics.width = bitmap.width * 64;
+        glyph.metrics.height = bitmap.rows * 64;
+        glyph.metrics.horiBearingX = face->glyph->bitmap_left * 64;
+        glyph.metrics.horiBearingY = face->glyph->bitmap_top * 64;
+    }
+    // Have to copy, the bitmap buffer is overwritten by the next glyph
+    glyph.bitmap = std::vector<uint8_t>(
+        bitmap.buffer, bitmap.buffer + bitmap.rows * bitmap.width);
+    return glyph;
+}
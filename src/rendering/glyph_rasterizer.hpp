@@ -0,0 +1,121 @@
+#pragma once
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "../terminal/unicode.hpp"
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+enum class GlyphFormat {
+    /// 8-bit coverage, only sharp at the rasterized size
+    Coverage,
+    /// 8-bit signed distance field (FT_RENDER_MODE_SDF), 128 is the outline and values grow towards the inside.
+    /// Stays sharp when scaled, so zooming only changes a uniform.
+    Sdf,
+};
+
+struct GlyphRequest {
+    /// Glyph key, see GlyphRasterizer::makeKey
+    codepoint_t codepoint;
+    /// Index into the rasterizer's fonts, 0 is the main font
+    uint16_t font;
+    /// In pixels, one rasterizer serves all sizes of the font
+    float size;
+};
+
+struct RasterizedGlyph {
+    codepoint_t codepoint;
+    FT_Glyph_Metrics metrics;
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> bitmap;
+    /// The font has no glyph for the codepoint, .notdef was rendered instead
+    bool missing = false;
+    /// Index into the rasterizer's fonts of the font the glyph was rendered from, 0 is the main font
+    uint16_t font = 0;
+};
+
+/// Pool of workers rasterizing glyphs in the background, each with its own FT_Face per font (faces can't be shared between threads).
+/// Finished glyphs are collected on the render thread by their size, which only has to pack and upload them.
+class GlyphRasterizer {
+public:
+    /// Faces of the main font for each cell style, indexed by the style. Styles without a face are synthesized
+    /// from the regular face.
+    using StyleFonts =
+        std::array<std::optional<std::filesystem::path>, cell_style::COUNT>;
+
+    /// The first font is the main font, fallback fonts and style faces are only opened when a glyph is requested from them
+    GlyphRasterizer(const std::vector<std::filesystem::path>& fonts,
+                    GlyphFormat format, size_t threads,
+                    const StyleFonts& styleFonts = {});
+    ~GlyphRasterizer();
+
+    void request(const std::vector<GlyphRequest>& requests);
+    /// Moves finished glyphs of the size to the end of out, never blocks
+    void collect(float size, std::vector<RasterizedGlyph>& out);
+    /// Drops requested and finished glyphs of the size, called when a font of the size is destroyed
+    void cancel(float size);
+    /// Blocks until all requested glyphs are finished
+    void wait();
+
+    static size_t getDefaultThreadCount();
+    /// Used in glyph cache file names
+    static const char* getFormatName(GlyphFormat format);
+
+    /// Distance in pixels covered by the distance field on each side of the outline
+    constexpr static int SDF_SPREAD = 8;
+    /// Marks shaped glyphs (e.g. ligatures), which have no codepoint. They're keyed by glyph index
+    /// with this bit set everywhere codepoints are, so the atlas and the glyph cache treat them alike.
+    constexpr static codepoint_t GLYPH_INDEX_BIT = 0x80000000;
+    /// The cell style is kept in the bits below GLYPH_INDEX_BIT, so all faces share the atlas and the glyph cache
+    constexpr static uint32_t STYLE_SHIFT = 29;
+
+    /// Key of a codepoint (or a glyph index with GLYPH_INDEX_BIT) in the given style
+    constexpr static codepoint_t makeKey(codepoint_t codepoint,
+                                         uint8_t style) {
+        return codepoint | (codepoint_t)style << STYLE_SHIFT;
+    }
+    constexpr static uint8_t getKeyStyle(codepoint_t key) {
+        return (key >> STYLE_SHIFT) & (cell_style::COUNT - 1);
+    }
+    /// Codepoint or glyph index with GLYPH_INDEX_BIT
+    constexpr static codepoint_t getKeyGlyph(codepoint_t key) {
+        return key & ~((codepoint_t)(cell_style::COUNT - 1) << STYLE_SHIFT);
+    }
+
+private:
+    /// Sizes in 26.6 fixed point, like FT_Set_Char_Size
+    static uint32_t getSizeKey(float size);
+    void work(size_t id);
+    /// synthesize: cell_style flags which the face doesn't have and are applied to the outline
+    static RasterizedGlyph rasterize(FT_Face face, codepoint_t key,
+                                     GlyphFormat format, uint8_t synthesize);
+
+    std::vector<std::filesystem::path> m_Fonts;
+    StyleFonts m_StyleFonts;
+    GlyphFormat m_Format;
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    /// Signalled when requests are added or the workers have to stop
+    std::condition_variable m_RequestCv;
+    /// Signalled when a glyph is finished
+    std::condition_variable m_FinishedCv;
+    std::deque<GlyphRequest> m_Requests;
+    /// Staging area of glyphs which weren't collected yet, by size key
+    std::unordered_map<uint32_t, std::vector<RasterizedGlyph>> m_Finished;
+    /// Size keys with requests which weren't cancelled, glyphs of other sizes are dropped when they're finished
+    std::unordered_set<uint32_t> m_Sizes;
+    /// Requested glyphs which aren't finished yet
+    size_t m_Pending = 0;
+    bool m_Stop = false;
+};
@@ -0,0 +1,47 @@
+#include "gpu_timer.hpp"
+#include "opengl.hpp"
+
+GpuTimer::GpuTimer(Counter counter) : m_Counter(counter) {
+    glCall(glGenQueries(m_Queries.size(), m_Queries.data()));
+}
+
+GpuTimer::~GpuTimer() {
+    glCall(glDeleteQueries(m_Queries.size(), m_Queries.data()));
+}
+
+void GpuTimer::begin() {
+    collect();
+    if (m_InFlight == m_Queries.size()) {
+        return;
+    }
+    const GLuint query = m_Queries[(m_First + m_InFlight) % m_Queries.size()];
+    glCall(glBeginQuery(GL_TIME_ELAPSED, query));
+    m_Active = true;
+}
+
+void GpuTimer::end() {
+    if (!m_Active) {
+        return;
+    }
+    glCall(glEndQuery(GL_TIME_ELAPSED));
+    m_InFlight++;
+    m_Active = false;
+}
+
+// PRIVATE
+void GpuTimer::collect() {
+    while (m_InFlight > 0) {
+        const GLuint query = m_Queries[m_First];
+        GLint available = GL_FALSE;
+        glCall(glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE,
+                                  &available));
+        if (available == GL_FALSE) {
+            return;
+        }
+        GLuint64 ns = 0;
+        glCall(glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns));
+        Stats::add(m_Counter, ns);
+        m_First = (m_First + 1) % m_Queries.size();
+        m_InFlight--;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../stats.hpp"
+#include "opengl.hpp"
+#include <array>
+#include <cstddef>
+
+/// GL_TIME_ELAPSED queries around a part of the frame, added to a counter. Results are read once they're available,
+/// a few frames later, so that the CPU never waits for the GPU. Frames are skipped while all queries are in flight.
+class GpuTimer {
+public:
+    explicit GpuTimer(Counter counter);
+    ~GpuTimer();
+
+    void begin();
+    void end();
+
+    constexpr static size_t QUERIES = 4;
+
+private:
+    /// Adds the results of finished queries, oldest first
+    void collect();
+
+    Counter m_Counter;
+    std::array<GLuint, QUERIES> m_Queries;
+    /// Index of the oldest query in flight
+    size_t m_First = 0;
+    size_t m_InFlight = 0;
+    bool m_Active = false;
+};
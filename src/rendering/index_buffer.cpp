@@ -1,4 +1,5 @@
 #include "index_buffer.hpp"
+#include "../stats.hpp"
 #include "opengl.hpp"
 #include <spdlog/spdlog.h>
 
@@ -26,6 +27,7 @@ void IndexBuffer::update(std::vector<index_t>& indices) {
     m_Count = indices.size();
     glCall(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
                            indices.size() * sizeof(index_t), indices.data()));
+    Stats::add(Counter::UploadBytes, indices.size() * sizeof(index_t));
 }
 
 GLsizei IndexBuffer::getCount() const {
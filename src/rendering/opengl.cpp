@@ -1,6 +1,13 @@
 #include "opengl.hpp"
+#include <cstring>
 #include <spdlog/spdlog.h>
 
+#ifndef GL_ARB_get_program_binary
+PFNGLGETPROGRAMBINARYPROC glGetProgramBinary = nullptr;
+PFNGLPROGRAMBINARYPROC glProgramBinary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC glProgramParameteri = nullptr;
+#endif
+
 bool checkError() {
     while (GLenum error = glGetError()) {
         SPDLOG_ERROR("[OpenGL error] ({:#x})", error);
@@ -14,3 +21,43 @@ void clearError() {
     while (glGetError() != GL_NO_ERROR)
         ;
 }
+
+bool loadProgramBinary(GLADloadproc load) {
+#ifndef GL_ARB_get_program_binary
+    bool supported =
+        GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 1);
+    GLint extensions = 0;
+    glCall(glGetIntegerv(GL_NUM_EXTENSIONS, &extensions));
+    for (GLint i = 0; i < extensions && !supported; i++) {
+        glCall(const GLubyte* name = glGetStringi(GL_EXTENSIONS, i));
+        supported = std::strcmp((const char*)name,
+                                "GL_ARB_get_program_binary") == 0;
+    }
+    if (supported) {
+        glGetProgramBinary =
+            (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+        glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+        glProgramParameteri =
+            (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+    }
+#endif
+    if (!hasProgramBinary()) {
+        SPDLOG_DEBUG("Program binaries aren't supported");
+        return false;
+    }
+
+    // Some drivers have the extension without any binary format
+    GLint formats = 0;
+    glCall(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats));
+    if (formats == 0) {
+        SPDLOG_DEBUG("Program binaries aren't supported (no binary formats)");
+        glGetProgramBinary = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool hasProgramBinary() {
+    return glGetProgramBinary != nullptr && glProgramBinary != nullptr &&
+           glProgramParameteri != nullptr;
+}
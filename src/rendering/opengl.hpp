@@ -14,3 +14,29 @@
 
 bool checkError();
 void clearError();
+
+// ARB_get_program_binary (core since OpenGL 4.1) isn't part of the generated OpenGL 3.3 loader
+#ifndef GL_ARB_get_program_binary
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+typedef void(APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program,
+                                                  GLsizei bufSize,
+                                                  GLsizei* length,
+                                                  GLenum* binaryFormat,
+                                                  void* binary);
+typedef void(APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program,
+                                               GLenum binaryFormat,
+                                               const void* binary,
+                                               GLsizei length);
+typedef void(APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program,
+                                                   GLenum pname, GLint value);
+/// Null when the driver doesn't support program binaries
+extern PFNGLGETPROGRAMBINARYPROC glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC glProgramParameteri;
+#endif
+
+/// Loads the program binary functions after the rest of OpenGL, returns whether the driver supports them
+bool loadProgramBinary(GLADloadproc load);
+bool hasProgramBinary();
@@ -0,0 +1,264 @@
+#include "overlay.hpp"
+#include "index_buffer.hpp"
+#include "opengl.hpp"
+#include "vertex_array.hpp"
+#include "vertex_buffer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <spdlog/spdlog.h>
+
+namespace {
+struct CellPos {
+    size_t x;
+    size_t y;
+
+    bool operator==(const CellPos&) const = default;
+};
+
+CellPos toCell(const cursor_t& cursor) {
+    return CellPos{.x = (size_t)std::lround(cursor.x),
+                   .y = (size_t)std::lround(cursor.y)};
+}
+} // namespace
+
+bool CellRange::operator==(const CellRange& other) const {
+    return toCell(start) == toCell(other.start) &&
+           toCell(end) == toCell(other.end);
+}
+
+Overlay::Overlay() {
+    reserve(MIN_QUADS);
+    SPDLOG_DEBUG("Created overlay");
+}
+
+Overlay::~Overlay() {
+    SPDLOG_DEBUG("Deleted overlay");
+}
+
+void Overlay::setCursor(cursor_t cursor, CursorStyle style) {
+    if (toCell(cursor) == toCell(m_Cursor) && style == m_CursorStyle) {
+        return;
+    }
+    m_Cursor = cursor;
+    m_CursorStyle = style;
+    m_Dirty = true;
+}
+
+void Overlay::setCursorVisible(bool visible) {
+    if (visible == m_CursorVisible) {
+        return;
+    }
+    m_CursorVisible = visible;
+    m_Dirty = true;
+}
+
+void Overlay::setSelection(const std::optional<CellRange>& selection) {
+    if (selection == m_Selection) {
+        return;
+    }
+    m_Selection = selection;
+    m_Dirty = true;
+}
+
+void Overlay::setHighlights(const std::vector<CellRange>& highlights) {
+    if (highlights == m_Highlights) {
+        return;
+    }
+    m_Highlights = highlights;
+    m_Dirty = true;
+}
+
+void Overlay::invalidate() {
+    m_Dirty = true;
+}
+
+void Overlay::update(const TerminalBuf& termBuf, Font& font) {
+    // Cell positions depend on the contents of the row (tabs), so the quads are outdated when one of their rows changes
+    const bool rowsChanged =
+        std::any_of(m_Rows.begin(), m_Rows.end(), [&](const RowState& state) {
+            return state.version != getVersion(termBuf, state.row);
+        });
+    if (!m_Dirty && !rowsChanged) {
+        return;
+    }
+
+    m_Vertices.clear();
+    m_Rows.clear();
+
+    for (const CellRange& highlight : m_Highlights) {
+        addRange(termBuf, highlight, colors::highlight, font);
+    }
+    if (m_Selection.has_value()) {
+        addRange(termBuf, m_Selection.value(), colors::selection, font);
+    }
+
+    m_InvertQuads = 0;
+    if (m_CursorVisible) {
+        const auto metrics = font.getMetricsInPx();
+        const float left =
+            getCellLeft(termBuf, m_Cursor.y, m_Cursor.x, font);
+        const float right = left + metrics.max_advance;
+        const float bottom = -m_Cursor.y * metrics.height + metrics.descender;
+        const float top = bottom + metrics.height;
+        const float thickness =
+            std::max(1.0f, std::round(metrics.height * CURSOR_THICKNESS));
+
+        switch (m_CursorStyle) {
+        case CursorStyle::Block: {
+            // Drawn last, so that it also inverts the selection below
+            addQuad(left, right, top, bottom, colors::cursor);
+            m_InvertQuads = 1;
+            break;
+        }
+        case CursorStyle::Bar: {
+            addQuad(left, left + thickness, top, bottom, colors::cursor);
+            break;
+        }
+        case CursorStyle::Underline: {
+            addQuad(left, right, bottom + thickness, bottom, colors::cursor);
+            break;
+        }
+        }
+    }
+
+    reserve(m_Vertices.size() / 4);
+    if (!m_Vertices.empty()) {
+        m_Vb->update(m_Vertices);
+    }
+    m_Dirty = false;
+    SPDLOG_TRACE("Regenerated overlay with {} quads", m_Vertices.size() / 4);
+}
+
+void Overlay::draw(const glm::mat4& mvp, Program& program) const {
+    if (m_Vertices.empty()) {
+        return;
+    }
+
+    program.setUniformMatrix4("u_MVP", mvp);
+    m_Va->bind();
+    m_Ib->bind();
+
+    const size_t blendedQuads = m_Vertices.size() / 4 - m_InvertQuads;
+    if (blendedQuads > 0) {
+        glCall(glDrawElements(GL_TRIANGLES, blendedQuads * 6, GL_UNSIGNED_INT,
+                              nullptr));
+    }
+    if (m_InvertQuads > 0) {
+        // White quad inverts whatever is below it, so the text under a block cursor stays readable
+        glCall(glBlendFunc(GL_ONE_MINUS_DST_COLOR, GL_ZERO));
+        glCall(glDrawElements(
+            GL_TRIANGLES, m_InvertQuads * 6, GL_UNSIGNED_INT,
+            (const void*)(blendedQuads * 6 * sizeof(index_t))));
+        glCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    }
+}
+
+// PRIVATE
+void Overlay::addRange(const TerminalBuf& termBuf, const CellRange& range,
+                       color_t color, Font& font) {
+    const auto& rows = termBuf.getRows();
+    const auto metrics = font.getMetricsInPx();
+
+    // Ranges can be given in both directions (e.g. selecting upwards)
+    const CellPos first = toCell(range.start);
+    const CellPos last = toCell(range.end);
+    const bool reversed =
+        first.y > last.y || (first.y == last.y && first.x > last.x);
+    const CellPos start = reversed ? last : first;
+    const CellPos end = reversed ? first : last;
+
+    for (size_t y = start.y; y <= end.y && y < rows.size(); y++) {
+        const size_t firstX = y == start.y ? start.x : 0;
+        // Rows which are selected until their end show at least one cell, so that empty rows are visible
+        const size_t endX =
+            y == end.y ? end.x : std::max(rows[y].size(), firstX + 1);
+        if (endX <= firstX) {
+            continue;
+        }
+
+        const float left = getCellLeft(termBuf, y, firstX, font);
+        const float right =
+            getCellLeft(termBuf, y, endX - 1, font) + metrics.max_advance;
+        const float bottom = -(float)y * metrics.height + metrics.descender;
+        addQuad(left, right, bottom + metrics.height, bottom, color);
+    }
+}
+
+void Overlay::addQuad(float left, float right, float top, float bottom,
+                      color_t color) {
+    m_Vertices.emplace_back(Vertex{.pos = {left, bottom, 0.0f},
+                                   .color = color,
+                                   .uv = {0.0f, 0.0f, 0.0f},
+                                   .bg = true}); // left bottom
+    m_Vertices.emplace_back(Vertex{.pos = {right, bottom, 0.0f},
+                                   .color = color,
+                                   .uv = {0.0f, 0.0f, 0.0f},
+                                   .bg = true}); // right bottom
+    m_Vertices.emplace_back(Vertex{.pos = {right, top, 0.0f},
+                                   .color = color,
+                                   .uv = {0.0f, 0.0f, 0.0f},
+                                   .bg = true}); // right top
+    m_Vertices.emplace_back(Vertex{.pos = {left, top, 0.0f},
+                                   .color = color,
+                                   .uv = {0.0f, 0.0f, 0.0f},
+                                   .bg = true}); // left top
+}
+
+float Overlay::getCellLeft(const TerminalBuf& termBuf, size_t y, size_t x,
+                           Font& font) {
+    const auto& rows = termBuf.getRows();
+    if (m_Rows.empty() || m_Rows.back().row != y) {
+        m_Rows.push_back(
+            RowState{.row = y, .version = getVersion(termBuf, y)});
+    }
+
+    // Same layout as the text mesh: the pen is advanced before a cell is drawn
+    glm::vec2 pen(0);
+    for (size_t i = 0; i <= x; i++) {
+        if (y < rows.size() && i < rows[y].size()) {
+            font.getGlyphPos(rows[y][i], pen);
+        } else {
+            font.getGlyphPos(Cell{.character = ' '}, pen);
+        }
+    }
+    return pen.x;
+}
+
+std::optional<uint64_t> Overlay::getVersion(const TerminalBuf& termBuf,
+                                            size_t y) {
+    if (y >= termBuf.getRows().size()) {
+        return std::nullopt;
+    }
+    return termBuf.getRowVersion(y);
+}
+
+void Overlay::reserve(size_t quads) {
+    if (quads <= m_Capacity) {
+        return;
+    }
+    size_t capacity = std::max(m_Capacity, MIN_QUADS);
+    while (capacity < quads) {
+        capacity *= 2;
+    }
+
+    m_Va = std::make_unique<VertexArray>();
+    m_Vb = std::make_unique<VertexBuffer>(capacity * 4);
+    m_Ib = std::make_unique<IndexBuffer>(capacity * 6);
+    m_Va->addBuffer(*m_Vb);
+
+    std::vector<index_t> indices;
+    indices.reserve(capacity * 6);
+    for (index_t i = 0; i < capacity * 4; i += 4) {
+        // First triangle
+        indices.push_back(i + 0);
+        indices.push_back(i + 1);
+        indices.push_back(i + 3);
+
+        // Second triangle
+        indices.push_back(i + 1);
+        indices.push_back(i + 2);
+        indices.push_back(i + 3);
+    }
+    m_Ib->update(indices);
+    m_Capacity = capacity;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../terminal/terminal_buffer.hpp"
+#include "../terminal/types.hpp"
+#include "font.hpp"
+#include "index_buffer.hpp"
+#include "program.hpp"
+#include "vertex_array.hpp"
+#include "vertex_buffer.hpp"
+#include <glm/ext/matrix_float4x4.hpp>
+#include <memory>
+#include <optional>
+#include <vector>
+
+enum class CursorStyle {
+    Block,
+    Bar,
+    Underline,
+};
+
+/// Cells from start up to (but not including) end, can span multiple rows
+struct CellRange {
+    cursor_t start;
+    cursor_t end;
+
+    /// Compared by cell, cursors are whole numbers stored as floats
+    bool operator==(const CellRange& other) const;
+};
+
+/// Cursor, selection and search highlights drawn on top of the text, with their own small vertex buffer.
+/// Changing them only regenerates a few quads, the text mesh and the frame cache are never touched.
+class Overlay {
+public:
+    Overlay();
+    ~Overlay();
+
+    void setCursor(cursor_t cursor, CursorStyle style);
+    void setCursorVisible(bool visible);
+    void setSelection(const std::optional<CellRange>& selection);
+    void setHighlights(const std::vector<CellRange>& highlights);
+    /// Forces the quads to be regenerated, e.g. when the font metrics changed
+    void invalidate();
+    /// Regenerates the quads if anything changed since the last call, including the rows they lie on
+    void update(const TerminalBuf& termBuf, Font& font);
+    void draw(const glm::mat4& mvp, Program& program) const;
+
+    constexpr static size_t MIN_QUADS = 16;
+    /// Width of the bar and height of the underline cursor, relative to the row height
+    constexpr static float CURSOR_THICKNESS = 0.1f;
+
+private:
+    struct RowState {
+        size_t row;
+        /// Empty for rows which didn't exist yet
+        std::optional<uint64_t> version;
+    };
+
+    void addRange(const TerminalBuf& termBuf, const CellRange& range,
+                  color_t color, Font& font);
+    void addQuad(float left, float right, float top, float bottom,
+                 color_t color);
+    /// Left edge of cell x, x can be past the end of the row
+    float getCellLeft(const TerminalBuf& termBuf, size_t y, size_t x,
+                      Font& font);
+    static std::optional<uint64_t> getVersion(const TerminalBuf& termBuf,
+                                              size_t y);
+    void reserve(size_t quads);
+
+    cursor_t m_Cursor = cursor_t(0);
+    CursorStyle m_CursorStyle = CursorStyle::Block;
+    bool m_CursorVisible = true;
+    std::optional<CellRange> m_Selection = std::nullopt;
+    std::vector<CellRange> m_Highlights;
+
+    bool m_Dirty = true;
+    /// Rows whose layout the quads were generated from
+    std::vector<RowState> m_Rows;
+    std::vector<Vertex> m_Vertices;
+    /// Quads of the block cursor, they're drawn inverting the text below instead of alpha blended
+    size_t m_InvertQuads = 0;
+    size_t m_Capacity = 0;
+
+    std::unique_ptr<VertexArray> m_Va;
+    std::unique_ptr<VertexBuffer> m_Vb;
+    std::unique_ptr<IndexBuffer> m_Ib;
+};
@@ -0,0 +1,38 @@
+#include "palette_texture.hpp"
+#include "opengl.hpp"
+#include <spdlog/spdlog.h>
+
+PaletteTexture::PaletteTexture() {
+    glCall(glGenTextures(1, &m_TexId));
+    glCall(glActiveTexture(GL_TEXTURE0 + UNIT));
+    glCall(glBindTexture(GL_TEXTURE_2D, m_TexId));
+    glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    glCall(glActiveTexture(GL_TEXTURE0));
+}
+
+PaletteTexture::~PaletteTexture() {
+    glCall(glDeleteTextures(1, &m_TexId));
+}
+
+bool PaletteTexture::update(const Palette& palette) {
+    if (m_Version == palette.getVersion()) {
+        return false;
+    }
+
+    glCall(glActiveTexture(GL_TEXTURE0 + UNIT));
+    glCall(glBindTexture(GL_TEXTURE_2D, m_TexId));
+    glCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, colors::PALETTE_SIZE, 1,
+                        0, GL_RGBA, GL_FLOAT, palette.getColors().data()));
+    glCall(glActiveTexture(GL_TEXTURE0));
+
+    m_Version = palette.getVersion();
+    SPDLOG_DEBUG("Uploaded palette (version {})", m_Version.value());
+    return true;
+}
+
+void PaletteTexture::bind() const {
+    glCall(glActiveTexture(GL_TEXTURE0 + UNIT));
+    glCall(glBindTexture(GL_TEXTURE_2D, m_TexId));
+    glCall(glActiveTexture(GL_TEXTURE0));
+}
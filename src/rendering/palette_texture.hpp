@@ -0,0 +1,23 @@
+#pragma once
+
+#include "../terminal/palette.hpp"
+#include "opengl.hpp"
+#include <optional>
+
+/// Palette uploaded to a texture with one texel per entry, shaders resolve color_t through it
+class PaletteTexture {
+public:
+    PaletteTexture();
+    ~PaletteTexture();
+
+    /// Only uploads when the palette changed since the last call, returns whether it did
+    bool update(const Palette& palette);
+    /// Binds to UNIT, leaves GL_TEXTURE0 active
+    void bind() const;
+
+    constexpr static GLint UNIT = 3;
+
+private:
+    GLuint m_TexId = 0;
+    std::optional<uint64_t> m_Version = std::nullopt;
+};
@@ -3,14 +3,29 @@
 #include "opengl.hpp"
 #include <assert.h>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <spdlog/fmt/fmt.h>
 #include <spdlog/spdlog.h>
+#include <unistd.h>
+
+static constexpr char MAGIC[8] = {'Y', 'A', 'T', 'E', 'P', 'R', 'O', 'G'};
 
 Program::Program(const std::string vertexShader,
-                 const std::string fragmentShader) {
-    GLuint vertexShaderId = loadShader(vertexShader, GL_VERTEX_SHADER);
-    GLuint fragmentShaderId = loadShader(fragmentShader, GL_FRAGMENT_SHADER);
+                 const std::string fragmentShader,
+                 const std::vector<std::string>& defines) {
+    const std::optional<std::filesystem::path> binaryPath =
+        getBinaryPath(vertexShader, fragmentShader, defines);
+    if (binaryPath.has_value() && loadBinary(binaryPath.value())) {
+        return;
+    }
+
+    GLuint vertexShaderId =
+        loadShader(vertexShader, GL_VERTEX_SHADER, defines);
+    GLuint fragmentShaderId =
+        loadShader(fragmentShader, GL_FRAGMENT_SHADER, defines);
     GLuint shaders[] = {vertexShaderId, fragmentShaderId};
 
     glCall(GLuint programId = glCreateProgram());
@@ -19,6 +34,11 @@ Program::Program(const std::string vertexShader,
     for (GLuint shader : shaders) {
         glCall(glAttachShader(programId, shader));
     }
+    if (binaryPath.has_value()) {
+        glCall(glProgramParameteri(programId,
+                                   GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                   GL_TRUE));
+    }
     glCall(glLinkProgram(programId));
 
     GLint success = GL_FALSE;
@@ -37,6 +57,10 @@ Program::Program(const std::string vertexShader,
     for (GLuint shader : shaders) {
         glCall(glDeleteShader(shader));
     }
+
+    if (binaryPath.has_value()) {
+        saveBinary(binaryPath.value());
+    }
 }
 
 Program::~Program() {
@@ -54,6 +78,24 @@ void Program::setUniformFloat(const GLchar* const name, const float value) {
     glCall(glUniform1f(location, value));
 }
 
+void Program::setUniformInt(const GLchar* const name, const GLint value) {
+    use();
+    const GLint location = getUniformLocation(name);
+    glCall(glUniform1i(location, value));
+}
+
+void Program::setUniformVec2(const GLchar* const name, const glm::vec2& vec) {
+    use();
+    const GLint location = getUniformLocation(name);
+    glCall(glUniform2f(location, vec.x, vec.y));
+}
+
+void Program::setUniformVec3(const GLchar* const name, const glm::vec3& vec) {
+    use();
+    const GLint location = getUniformLocation(name);
+    glCall(glUniform3f(location, vec.x, vec.y, vec.z));
+}
+
 void Program::setUniformMatrix4(const GLchar* const name,
                                 const glm::mat4& mat) {
     use();
@@ -62,9 +104,19 @@ void Program::setUniformMatrix4(const GLchar* const name,
 }
 
 // PRIVATE
-GLuint Program::loadShader(const std::string contents, const GLuint type) {
+GLuint Program::loadShader(const std::string contents, const GLuint type,
+                           const std::vector<std::string>& defines) {
     assert(contents.length() > 0);
-    const GLchar* const string = contents.c_str();
+    // #version has to stay the first line
+    std::string source = contents;
+    size_t lineEnd = source.find('\n');
+    lineEnd = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    std::string defineLines;
+    for (const std::string& define : defines) {
+        defineLines += "#define " + define + "\n";
+    }
+    source.insert(lineEnd, defineLines);
+    const GLchar* const string = source.c_str();
 
     glCall(GLuint shaderId = glCreateShader(type));
     glCall(glShaderSource(shaderId, 1, &string, nullptr));
@@ -100,3 +152,118 @@ GLint Program::getUniformLocation(const GLchar* const name) {
         return location;
     }
 }
+
+bool Program::loadBinary(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        SPDLOG_DEBUG("No program binary at '{}'", path.c_str());
+        return false;
+    }
+    BinaryHeader header;
+    if (!file.read((char*)&header, sizeof(BinaryHeader)) ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != BINARY_VERSION) {
+        SPDLOG_DEBUG("Ignoring program binary with another version");
+        return false;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size())) {
+        SPDLOG_WARN("Program binary '{}' is truncated", path.c_str());
+        return false;
+    }
+
+    glCall(GLuint programId = glCreateProgram());
+    // The driver rejects binaries of other driver versions or hardware, they're compiled again.
+    // A format it doesn't know is reported as an error instead of a failed link, so it isn't checked by glCall.
+    clearError();
+    glProgramBinary(programId, header.format, binary.data(), binary.size());
+    const bool invalidFormat = glGetError() != GL_NO_ERROR;
+    GLint success = GL_FALSE;
+    glCall(glGetProgramiv(programId, GL_LINK_STATUS, &success));
+    if (invalidFormat || success == GL_FALSE) {
+        SPDLOG_DEBUG("Driver rejected program binary '{}'", path.c_str());
+        glCall(glDeleteProgram(programId));
+        return false;
+    }
+
+    m_Id = programId;
+    SPDLOG_DEBUG("Loaded shader program with id={} from '{}'", programId,
+                 path.c_str());
+    return true;
+}
+
+void Program::saveBinary(const std::filesystem::path& path) const {
+    GLint length = 0;
+    glCall(glGetProgramiv(m_Id, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0) {
+        return;
+    }
+    BinaryHeader header = {
+        .magic = {}, .version = BINARY_VERSION, .format = 0, .length = 0};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    glCall(glGetProgramBinary(m_Id, length, &written, &header.format,
+                              binary.data()));
+    header.length = written;
+
+    // Renamed over the old file like the glyph cache, so that other processes never read a partial file
+    const std::filesystem::path tmpPath =
+        path.string() + fmt::format(".{}", getpid());
+    std::ofstream file(tmpPath, std::ios::binary);
+    if (!file) {
+        SPDLOG_WARN("Failed to write program binary '{}'", tmpPath.c_str());
+        return;
+    }
+    file.write((const char*)&header, sizeof(BinaryHeader));
+    file.write(binary.data(), written);
+    file.close();
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+    if (error) {
+        SPDLOG_WARN("Failed to replace program binary '{}': {}", path.c_str(),
+                    error.message());
+        std::filesystem::remove(tmpPath, error);
+        return;
+    }
+    SPDLOG_DEBUG("Saved program binary '{}' ({} bytes)", path.c_str(),
+                 written);
+}
+
+// STATIC
+std::optional<std::filesystem::path>
+Program::getBinaryPath(const std::string& vertexShader,
+                       const std::string& fragmentShader,
+                       const std::vector<std::string>& defines) {
+    if (!hasProgramBinary()) {
+        return std::nullopt;
+    }
+    const std::optional<std::filesystem::path> dir = getCacheDir();
+    if (!dir.has_value()) {
+        return std::nullopt;
+    }
+
+    // FNV-1a of everything the binary depends on, a driver update changes the version string
+    uint64_t hash = 0xcbf29ce484222325;
+    const auto add = [&hash](const char* data) {
+        // The terminator separates the strings
+        for (const char* c = data;; c++) {
+            hash ^= (uint8_t)*c;
+            hash *= 0x100000001b3;
+            if (*c == '\0') {
+                break;
+            }
+        }
+    };
+    add(vertexShader.c_str());
+    add(fragmentShader.c_str());
+    for (const std::string& define : defines) {
+        add(define.c_str());
+    }
+    for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        glCall(const GLubyte* value = glGetString(name));
+        add(value != nullptr ? (const char*)value : "");
+    }
+    return dir.value() / fmt::format("program-{:016x}.bin", hash);
+}
@@ -1,23 +1,55 @@
 #pragma once
 
 #include "opengl.hpp"
+#include <cstdint>
+#include <filesystem>
 #include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <optional>
 #include <spdlog/spdlog.h>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
+/// Linked programs are stored in $XDG_CACHE_HOME/yate when the driver supports program binaries,
+/// so that later processes skip compiling and linking. There is a file per shader sources, defines and driver.
 class Program {
 public:
     Program() = delete;
-    Program(const std::string vertexShader, const std::string fragmentShader);
+    /// Defines are inserted after the #version line of both shaders, to compile variants of the same source
+    Program(const std::string vertexShader, const std::string fragmentShader,
+            const std::vector<std::string>& defines = {});
     ~Program();
 
     void use() const;
     void setUniformFloat(const GLchar* const name, const float value);
+    void setUniformInt(const GLchar* const name, const GLint value);
+    void setUniformVec2(const GLchar* const name, const glm::vec2& vec);
+    void setUniformVec3(const GLchar* const name, const glm::vec3& vec);
     void setUniformMatrix4(const GLchar* const name, const glm::mat4& mat);
 
+    constexpr static uint32_t BINARY_VERSION = 1;
+
 private:
-    GLuint loadShader(const std::string contents, const GLuint type);
+    struct BinaryHeader {
+        char magic[8];
+        uint32_t version;
+        GLenum format;
+        uint32_t length;
+    };
+
+    GLuint loadShader(const std::string contents, const GLuint type,
+                      const std::vector<std::string>& defines);
     GLint getUniformLocation(const GLchar* const name);
+    /// Returns whether the cached binary was loaded and linked
+    bool loadBinary(const std::filesystem::path& path);
+    void saveBinary(const std::filesystem::path& path) const;
+    /// Nothing when program binaries aren't supported or there is no cache directory
+    static std::optional<std::filesystem::path>
+    getBinaryPath(const std::string& vertexShader,
+                  const std::string& fragmentShader,
+                  const std::vector<std::string>& defines);
 
     GLuint m_Id = 0;
     /// name -> location
@@ -2,9 +2,13 @@
 #include "../application.hpp"
 #include "../terminal/parser.hpp"
 #include "../terminal/types.hpp"
+#include "../trace.hpp"
 #include "../utils.hpp"
 #include "opengl.hpp"
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <optional>
 #include <spdlog/spdlog.h>
 #include <vector>
 
@@ -13,12 +17,12 @@ Renderer::Renderer(SDL_Window* window, float contentScale = 1)
           glm::ortho(0.0f, ((float)Application::WIDTH * contentScale),
                      (-(float)Application::HEIGHT * contentScale), 0.0f)),
       m_ViewMat(1), m_ContentScale(contentScale) {
-    SDL_GLContext ctx = SDL_GL_CreateContext(window);
-    SDL_GL_SetSwapInterval(1);
+    m_GlContext = SDL_GL_CreateContext(window);
 
     if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
         FATAL("Failed to initialize OpenGL");
     }
+    loadProgramBinary((GLADloadproc)SDL_GL_GetProcAddress);
 
     glCall(SPDLOG_INFO("OpenGL version: {}", (GLchar*)glGetString(GL_VERSION)));
 
@@ -26,168 +30,252 @@ Renderer::Renderer(SDL_Window* window, float contentScale = 1)
     glCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
     glCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
 
+    m_FramePacer = std::make_unique<FramePacer>(window);
+    m_Overlay = std::make_unique<Overlay>();
+    m_PaletteTexture = std::make_unique<PaletteTexture>();
+    m_DrawTimer = std::make_unique<GpuTimer>(Counter::DrawGpuNs);
+    m_FrameCache = std::make_unique<FrameCache>(
+        std::round(Application::WIDTH * contentScale),
+        std::round(Application::HEIGHT * contentScale));
+
     SPDLOG_DEBUG("Initialized renderer");
 }
 
-void Renderer::makeTextMesh(const std::vector<std::vector<Cell>>& cells,
-                            cursor_t cursor, Font& font) {
-    m_Vertices.clear();
-    m_Indices.clear();
+void Renderer::makeTextMesh(const TerminalBuf& termBuf,
+                            const Viewport& viewport, Font& font) {
+    Trace::Span span("Renderer::makeTextMesh");
+    if (m_RenderMode == RenderMode::Grid) {
+        if (m_CellGrid == nullptr) {
+            m_CellGrid = std::make_unique<CellGrid>(font.getFormat());
+        }
+        const std::vector<size_t> updatedRows =
+            m_CellGrid->update(termBuf, viewport, font);
+        m_DamagedRows.insert(m_DamagedRows.end(), updatedRows.begin(),
+                             updatedRows.end());
+        return;
+    }
 
-    std::vector<index_t> bgIndices, fgIndices;
-    size_t curIndex = 0;
-    glm::vec2 pen(0);
+    const auto& rows = termBuf.getRows();
+    const size_t firstRow = std::min(viewport.firstRow, rows.size());
+    const size_t endRow =
+        std::min(viewport.firstRow + viewport.rowCount, rows.size());
 
-    const double bgOffsetY = font.getMetricsInPx().descender;
-    const glm::vec2 bgSize(font.getMetricsInPx().max_advance,
-                           font.getMetricsInPx().height);
+    const auto isStale = [&](size_t y) {
+        if (m_RowSlots.empty()) {
+            return true;
+        }
+        const RowSlot& slot = m_RowSlots[y % m_RowSlots.size()];
+        return !slot.valid || slot.row != y ||
+               slot.version != termBuf.getRowVersion(y);
+    };
+
+    std::vector<size_t> staleRows;
+    size_t requiredQuads = 0;
+    for (size_t y = firstRow; y < endRow; y++) {
+        if (isStale(y)) {
+            staleRows.push_back(y);
+            requiredQuads = std::max(requiredQuads, rows[y].size());
+        }
+    }
 
-    for (size_t y = 0; y < cells.size(); y++) {
-        const auto& row = cells[y];
+    if (m_TextMesh == nullptr ||
+        viewport.rowCount > m_TextMesh->getSlotCount() ||
+        requiredQuads > m_TextMesh->getQuadsPerSlot()) {
+        size_t quadsPerSlot =
+            m_TextMesh ? m_TextMesh->getQuadsPerSlot() : MIN_QUADS_PER_ROW;
+        for (size_t y = firstRow; y < endRow; y++) {
+            while (quadsPerSlot < rows[y].size()) {
+                quadsPerSlot *= 2;
+            }
+        }
 
-        for (size_t x = 0; x < row.size(); x++) {
-            const auto& cell = row[x];
-            const GlyphPos g = font.getGlyphPos(cell, pen);
-            const bool isCursor = y == cursor.y && x == cursor.x;
+        // Growing discards the whole mesh, which is rare because row capacity doubles every time
+        m_TextMesh =
+            std::make_unique<RowMesh>(viewport.rowCount, quadsPerSlot);
+        m_RowSlots.assign(viewport.rowCount, RowSlot{});
+        m_RowPages.resize(viewport.rowCount);
+        staleRows.clear();
+        for (size_t y = firstRow; y < endRow; y++) {
+            staleRows.push_back(y);
+        }
+    }
 
-#ifndef NDEBUG
-            assert(!Parser::isEol(cell.character));
-#endif
+    // Pages looked up outside of rows aren't kept
+    font.takeUsedPages();
+    for (const size_t y : staleRows) {
+        makeRow(rows[y], y, font);
+
+        const size_t slot = y % m_RowSlots.size();
+        m_TextMesh->updateSlot(slot, m_BgVertices, m_FgVertices);
+        m_RowPages.set(slot, font.takeUsedPages());
+        m_RowSlots[slot] =
+            RowSlot{.row = y,
+                    .version = termBuf.getRowVersion(y),
+                    .valid = true,
+                    .missingGlyphs =
+                        m_ShapedGlyphs.empty()
+                            ? !font.hasAllGlyphs(rows[y])
+                            : !font.hasAllGlyphs(rows[y], m_ShapedGlyphs)};
+        m_DamagedRows.push_back(y);
+    }
+
+    // Clear slots of rows which went out of view or were deleted
+    for (size_t slot = 0; slot < m_RowSlots.size(); slot++) {
+        const RowSlot& rowSlot = m_RowSlots[slot];
+        if (rowSlot.valid &&
+            (rowSlot.row < firstRow || rowSlot.row >= endRow)) {
+            m_TextMesh->clearSlot(slot);
+            m_RowSlots[slot].valid = false;
+            m_RowPages.clear(slot);
+            m_DamagedRows.push_back(rowSlot.row);
+        }
+    }
+
+    SPDLOG_TRACE("Regenerated {} of {} visible rows", staleRows.size(),
+                 endRow - firstRow);
+}
+
+void Renderer::invalidateTextMesh() {
+    for (RowSlot& slot : m_RowSlots) {
+        slot.valid = false;
+    }
+    if (m_CellGrid != nullptr) {
+        m_CellGrid->invalidate();
+    }
+    m_FrameCache->invalidate();
+    m_Overlay->invalidate();
+}
+
+void Renderer::invalidateMissingGlyphs() {
+    // Existing glyphs didn't move, so the remaining rows and the frame cache stay valid
+    for (RowSlot& slot : m_RowSlots) {
+        if (slot.missingGlyphs) {
+            slot.valid = false;
+        }
+    }
+    if (m_CellGrid != nullptr) {
+        m_CellGrid->invalidateMissingGlyphs();
+    }
+}
+
+void Renderer::touchPages(Font& font) {
+    if (m_RenderMode == RenderMode::Grid) {
+        if (m_CellGrid != nullptr) {
+            m_CellGrid->touchPages(font);
+        }
+        return;
+    }
+    font.touchPages(m_RowPages);
+}
+
+void Renderer::drawText(const glm::mat4& transform, Program& program,
+                        const Font& font) {
+    Trace::Span span("Renderer::drawText");
+    m_DrawTimer->begin();
+    glm::mat4 mvp = m_ProjectionMat * m_ViewMat * transform;
 
-            if (cell.character != c0::HT || isCursor) {
-                const glm::vec4 bgColor =
-                    isCursor ? glm::vec4(1) : cell.bgColor;
-
-                // Background
-                m_Vertices.emplace_back(
-                    Vertex{.pos = {pen.x, pen.y + bgSize.y + bgOffsetY, 0.0f},
-                           .color = bgColor,
-                           .bg = true}); // left bottom
-                m_Vertices.emplace_back(
-                    Vertex{.pos = {pen.x + bgSize.x,
-                                   pen.y + bgSize.y + bgOffsetY, 0.0f},
-                           .color = bgColor,
-                           .bg = true}); // right bottom
-                m_Vertices.emplace_back(
-                    Vertex{.pos = {pen.x + bgSize.x, pen.y + bgOffsetY, 0.0f},
-                           .color = bgColor,
-                           .bg = true}); // right top
-                m_Vertices.emplace_back(
-                    Vertex{.pos = {pen.x, pen.y + bgOffsetY, 0.0f},
-                           .color = bgColor,
-                           .bg = true}); // left top
-
-                // Background first triangle
-                bgIndices.push_back(curIndex + 0);
-                bgIndices.push_back(curIndex + 1);
-                bgIndices.push_back(curIndex + 3);
-
-                // Background second triangle
-                bgIndices.push_back(curIndex + 1);
-                bgIndices.push_back(curIndex + 2);
-                bgIndices.push_back(curIndex + 3);
-                curIndex += 4;
+    if (const std::optional<GLint> dy = getScrollOffset(mvp); dy.has_value()) {
+        m_FrameCache->scroll(dy.value());
+    } else {
+        m_FrameCache->invalidate();
+    }
+    m_PrevMvp = mvp;
+
+    m_PaletteTexture->bind();
+    program.setUniformInt("u_Palette", PaletteTexture::UNIT);
+
+    for (const size_t y : m_DamagedRows) {
+        m_FrameCache->addDamage(getRowRect(y, mvp, font));
+    }
+    m_DamagedRows.clear();
+
+    m_FrameCache->redraw([&]() {
+        if (m_RenderMode == RenderMode::Grid) {
+            if (m_CellGrid != nullptr) {
+                m_CellGrid->draw(
+                    mvp,
+                    glm::vec2(Application::WIDTH * m_ContentScale,
+                              Application::HEIGHT * m_ContentScale),
+                    font);
             }
+            return;
+        }
+
+        if (m_TextMesh == nullptr) {
+            return;
+        }
+        program.setUniformMatrix4("u_MVP", mvp);
+        if (font.getFormat() == GlyphFormat::Sdf) {
+            program.setUniformFloat(
+                "u_SdfScale",
+                Font::getSdfScale(mvp, Application::WIDTH * m_ContentScale));
+        }
+        font.bindAtlas();
+        m_TextMesh->draw();
+    });
+    m_FrameCache->present();
+    // Not cached, so that moving the cursor or the selection never damages the frame cache
+    m_Overlay->draw(mvp, program);
+    m_DrawTimer->end();
+}
+
+Overlay& Renderer::getOverlay() {
+    return *m_Overlay;
+}
 
-            // Foreground
-            const glm::vec4 fgColor =
-                isCursor ? glm::vec4(0, 0, 0, 1) : cell.fgColor;
-
-            m_Vertices.emplace_back(
-                Vertex{.pos = {pen.x + g.pl, pen.y + g.pb, 0.0f},
-                       .color = fgColor,
-                       .uv = {g.al, g.ab},
-                       .bg = false}); // left bottom
-            m_Vertices.emplace_back(
-                Vertex{.pos = {pen.x + g.pr, pen.y + g.pb, 0.0f},
-                       .color = fgColor,
-                       .uv = {g.ar, g.ab},
-                       .bg = false}); // right bottom
-            m_Vertices.emplace_back(
-                Vertex{.pos = {pen.x + g.pr, pen.y + g.pt, 0.0f},
-                       .color = fgColor,
-                       .uv = {g.ar, g.at},
-                       .bg = false}); // right top
-            m_Vertices.emplace_back(
-                Vertex{.pos = {pen.x + g.pl, pen.y + g.pt, 0.0f},
-                       .color = fgColor,
-                       .uv = {g.al, g.at},
-                       .bg = false}); // left top
-
-            // Foreground first triangle
-            fgIndices.push_back(curIndex + 0);
-            fgIndices.push_back(curIndex + 1);
-            fgIndices.push_back(curIndex + 3);
-
-            // Foreground second triangle
-            fgIndices.push_back(curIndex + 1);
-            fgIndices.push_back(curIndex + 2);
-            fgIndices.push_back(curIndex + 3);
-
-            curIndex += 4;
-        }
-
-        // Draw additional quad when cursor is at the end of the row
-        if (cursor.y == y && cursor.x == row.size()) {
-            const Cell cursorCell = {.bgColor = glm::vec4(1)};
-            font.getGlyphPos(cursorCell, pen);
-
-            // Background
-            m_Vertices.emplace_back(
-                Vertex{.pos = {pen.x, pen.y + bgSize.y + bgOffsetY, 0.0f},
-                       .color = cursorCell.bgColor,
-                       .bg = true}); // left bottom
-            m_Vertices.emplace_back(Vertex{
-                .pos = {pen.x + bgSize.x, pen.y + bgSize.y + bgOffsetY, 0.0f},
-                .color = cursorCell.bgColor,
-                .bg = true}); // right bottom
-            m_Vertices.emplace_back(
-                Vertex{.pos = {pen.x + bgSize.x, pen.y + bgOffsetY, 0.0f},
-                       .color = cursorCell.bgColor,
-                       .bg = true}); // right top
-            m_Vertices.emplace_back(
-                Vertex{.pos = {pen.x, pen.y + bgOffsetY, 0.0f},
-                       .color = cursorCell.bgColor,
-                       .bg = true}); // left top
-
-            // Background first triangle
-            bgIndices.push_back(curIndex + 0);
-            bgIndices.push_back(curIndex + 1);
-            bgIndices.push_back(curIndex + 3);
-
-            // Background second triangle
-            bgIndices.push_back(curIndex + 1);
-            bgIndices.push_back(curIndex + 2);
-            bgIndices.push_back(curIndex + 3);
-            curIndex += 4;
-        }
-
-        pen.x = 0;
-        pen.y -= font.getMetricsInPx().height;
-    }
-
-    m_Indices.insert(m_Indices.end(), bgIndices.begin(), bgIndices.end());
-    m_Indices.insert(m_Indices.end(), fgIndices.begin(), fgIndices.end());
-}
-
-void Renderer::drawText(const glm::mat4& transform, Program& program) {
-    if (m_GlyphMesh == nullptr) {
-        // TODO: Proper cell sizing
-        m_GlyphMesh = std::make_unique<Mesh>(
-            Application::WIDTH * Application::HEIGHT * 4,
-            Application::WIDTH * Application::HEIGHT * 6, transform, program);
-    }
-
-    m_GlyphMesh->update(m_Vertices, m_Indices);
-    m_GlyphMesh->draw(m_ProjectionMat, m_ViewMat);
+void Renderer::updatePalette(const Palette& palette) {
+    if (!m_PaletteTexture->update(palette)) {
+        return;
+    }
+    // Cells only store palette indices, so nothing but the cached frame has to be redrawn
+    const glm::vec4& bg = palette.get(colors::defaultBg);
+    setBgColor(glm::vec3(bg.r, bg.g, bg.b));
+}
+
+void Renderer::setFramePacing(const FramePacing pacing,
+                              const std::chrono::microseconds deadline) {
+    m_FramePacer->setPacing(pacing, deadline);
+}
+
+FramePacing Renderer::getFramePacing() const {
+    return m_FramePacer->getPacing();
+}
+
+void Renderer::waitForFrameStart() {
+    m_FramePacer->waitForFrameStart();
+}
+
+void Renderer::swap() {
+    m_FramePacer->swap();
+}
+
+void Renderer::setRenderMode(const RenderMode mode) {
+    if (mode == m_RenderMode) {
+        return;
+    }
+    m_RenderMode = mode;
+    // The other path hasn't been updated while it was inactive
+    invalidateTextMesh();
+    SPDLOG_INFO("Switched render mode to {}",
+                mode == RenderMode::Grid ? "grid" : "mesh");
+}
+
+RenderMode Renderer::getRenderMode() const {
+    return m_RenderMode;
 }
 
 void Renderer::setWireframe(const bool enabled) {
+    if (enabled == m_Wireframe) {
+        return;
+    }
+    m_Wireframe = enabled;
+    m_FrameCache->invalidate();
     glCall(glPolygonMode(GL_FRONT_AND_BACK, enabled ? GL_LINE : GL_FILL));
 }
 
 void Renderer::setBgColor(const glm::vec3& color) {
     glCall(glClearColor(color.r, color.g, color.b, 1.0f));
+    m_FrameCache->invalidate();
 }
 
 void Renderer::clear() {
@@ -201,3 +289,172 @@ SDL_GLContext Renderer::getContext() const {
 void Renderer::setViewMat(const glm::mat4& mat) {
     m_ViewMat = mat;
 }
+
+// PRIVATE
+void Renderer::makeRow(const std::vector<Cell>& row, size_t y, Font& font) {
+    m_BgVertices.clear();
+    m_FgVertices.clear();
+
+    glm::vec2 pen(0, -(float)y * font.getMetricsInPx().height);
+    const double bgOffsetY = font.getMetricsInPx().descender;
+    const glm::vec2 bgSize(font.getMetricsInPx().max_advance,
+                           font.getMetricsInPx().height);
+
+    const auto pushBackground = [&](float left, float right,
+                                    color_t bgColor) {
+        m_BgVertices.emplace_back(
+            Vertex{.pos = {left, pen.y + bgSize.y + bgOffsetY, 0.0f},
+                   .color = bgColor,
+                   .uv = {0.0f, 0.0f, 0.0f},
+                   .bg = true}); // left bottom
+        m_BgVertices.emplace_back(
+            Vertex{.pos = {right, pen.y + bgSize.y + bgOffsetY, 0.0f},
+                   .color = bgColor,
+                   .uv = {0.0f, 0.0f, 0.0f},
+                   .bg = true}); // right bottom
+        m_BgVertices.emplace_back(
+            Vertex{.pos = {right, pen.y + bgOffsetY, 0.0f},
+                   .color = bgColor,
+                   .uv = {0.0f, 0.0f, 0.0f},
+                   .bg = true}); // right top
+        m_BgVertices.emplace_back(
+            Vertex{.pos = {left, pen.y + bgOffsetY, 0.0f},
+                   .color = bgColor,
+                   .uv = {0.0f, 0.0f, 0.0f},
+                   .bg = true}); // left top
+    };
+
+    // Adjacent cells with the same background are merged into a single quad.
+    // The default background isn't drawn at all, the clear color shows through anyway.
+    std::optional<color_t> runColor = std::nullopt;
+    float runLeft = 0;
+    float runRight = 0;
+    const auto endRun = [&]() {
+        if (runColor.has_value()) {
+            pushBackground(runLeft, runRight, runColor.value());
+            runColor = std::nullopt;
+        }
+    };
+    const auto addBackground = [&](color_t bgColor) {
+        if (bgColor == colors::defaultBg) {
+            endRun();
+            return;
+        }
+        if (runColor.has_value() && runColor.value() == bgColor) {
+            runRight = pen.x + bgSize.x;
+            return;
+        }
+        endRun();
+        runColor = bgColor;
+        runLeft = pen.x;
+        runRight = pen.x + bgSize.x;
+    };
+
+    const auto pushGlyph = [&](const GlyphPos& g, color_t fgColor) {
+        // Glyphs without a bitmap (e.g. space) don't need a quad
+        if (g.pr <= g.pl || g.pb <= g.pt) {
+            return;
+        }
+
+        m_FgVertices.emplace_back(
+            Vertex{.pos = {pen.x + g.pl, pen.y + g.pb, 0.0f},
+                   .color = fgColor,
+                   .uv = {g.al, g.ab, g.layer},
+                   .bg = false}); // left bottom
+        m_FgVertices.emplace_back(
+            Vertex{.pos = {pen.x + g.pr, pen.y + g.pb, 0.0f},
+                   .color = fgColor,
+                   .uv = {g.ar, g.ab, g.layer},
+                   .bg = false}); // right bottom
+        m_FgVertices.emplace_back(
+            Vertex{.pos = {pen.x + g.pr, pen.y + g.pt, 0.0f},
+                   .color = fgColor,
+                   .uv = {g.ar, g.at, g.layer},
+                   .bg = false}); // right top
+        m_FgVertices.emplace_back(
+            Vertex{.pos = {pen.x + g.pl, pen.y + g.pt, 0.0f},
+                   .color = fgColor,
+                   .uv = {g.al, g.at, g.layer},
+                   .bg = false}); // left top
+    };
+
+    // Ligatures are only drawn by the mesh renderer
+    font.shapeRow(row, m_ShapedGlyphs);
+
+    for (size_t x = 0; x < row.size(); x++) {
+        const auto& cell = row[x];
+        const GlyphPos g =
+            m_ShapedGlyphs.empty()
+                ? font.getGlyphPos(cell, pen)
+                : font.getGlyphPos(cell, m_ShapedGlyphs[x], pen);
+
+#ifndef NDEBUG
+        assert(!Parser::isEol(cell.character));
+#endif
+
+        if (cell.character != c0::HT) {
+            addBackground(cell.bgColor);
+        } else {
+            endRun();
+        }
+
+        pushGlyph(g, cell.fgColor);
+        if (cell.combining != 0) {
+            pushGlyph(font.getCombiningGlyphPos(cell), cell.fgColor);
+        }
+    }
+    endRun();
+}
+
+std::optional<GLint> Renderer::getScrollOffset(const glm::mat4& mvp) const {
+    if (!m_PrevMvp.has_value()) {
+        return std::nullopt;
+    }
+    const glm::mat4& prev = m_PrevMvp.value();
+    constexpr float EPSILON = 1e-5;
+
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            // Column 3, row 1 is the vertical translation
+            if (col == 3 && row == 1) {
+                continue;
+            }
+            if (std::abs(mvp[col][row] - prev[col][row]) > EPSILON) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    // Clip space spans 2 units across the framebuffer height
+    const float dy = (mvp[3][1] - prev[3][1]) *
+                     std::round(Application::HEIGHT * m_ContentScale) / 2;
+    if (std::abs(dy - std::round(dy)) > 0.01f) {
+        return std::nullopt;
+    }
+    return (GLint)std::round(dy);
+}
+
+FrameCache::Rect Renderer::getRowRect(size_t y, const glm::mat4& mvp,
+                                      const Font& font) const {
+    const float height = font.getMetricsInPx().height;
+    // Glyphs can overhang into the neighbouring rows, so half a row is added on both sides
+    const float bottom =
+        -(float)y * height + font.getMetricsInPx().descender - height / 2;
+    const float top = bottom + height * 2;
+
+    const float screenHeight = std::round(Application::HEIGHT * m_ContentScale);
+    const auto toPixels = [&](float worldY) {
+        const glm::vec4 clip = mvp * glm::vec4(0, worldY, 0, 1);
+        return (clip.y / clip.w + 1) / 2 * screenHeight;
+    };
+    const float a = toPixels(bottom);
+    const float b = toPixels(top);
+    const GLint pxBottom = std::floor(std::min(a, b));
+    const GLint pxTop = std::ceil(std::max(a, b));
+
+    return FrameCache::Rect{
+        .x = 0,
+        .y = pxBottom,
+        .width = (GLsizei)std::round(Application::WIDTH * m_ContentScale),
+        .height = pxTop - pxBottom};
+}
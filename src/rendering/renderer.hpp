@@ -1,31 +1,105 @@
 #pragma once
 
+#include "cell_grid.hpp"
 #include "font.hpp"
-#include "mesh.hpp"
+#include "frame_cache.hpp"
+#include "frame_pacer.hpp"
+#include "gpu_timer.hpp"
+#include "overlay.hpp"
+#include "palette_texture.hpp"
 #include "program.hpp"
+#include "row_mesh.hpp"
+#include "viewport.hpp"
 #include <SDL.h>
+#include <chrono>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/vector_float3.hpp>
 #include <memory>
+#include <optional>
+
+enum class RenderMode {
+    /// Quads for every cell, generated on the CPU
+    Mesh,
+    /// Cells uploaded to a texture and resolved in the fragment shader, see CellGrid
+    Grid,
+};
 
 class Renderer {
 public:
     Renderer(SDL_Window* window, float contentScale);
 
-    void makeTextMesh(const std::vector<std::vector<Cell>>& cells,
-                      cursor_t cursor, Font& font);
-    void drawText(const glm::mat4& transform, Program& program);
+    /// Only visible rows which changed since the last call are regenerated and uploaded.
+    /// In RenderMode::Grid the rows are uploaded to the cell grid instead of being meshed.
+    void makeTextMesh(const TerminalBuf& termBuf, const Viewport& viewport,
+                      Font& font);
+    /// Forces all rows to be regenerated, e.g. when glyph positions in the atlas changed
+    void invalidateTextMesh();
+    /// Regenerates only rows drawn with fallback glyphs, after their glyphs were added to the atlas
+    void invalidateMissingGlyphs();
+    /// Marks the atlas pages of rows in view as used in the font's current frame. Called before the atlas is updated,
+    /// rows which didn't change aren't meshed again, so their pages would otherwise look unused and be evicted first.
+    void touchPages(Font& font);
+    /// Text is drawn into a FrameCache, only rows changed by makeTextMesh and rows exposed by scrolling are redrawn.
+    /// The cached frame is then copied to the window and the overlay is drawn over it.
+    void drawText(const glm::mat4& transform, Program& program,
+                  const Font& font);
+    Overlay& getOverlay();
+    /// Uploads the palette when it changed, the clear color follows the default background
+    void updatePalette(const Palette& palette);
+    void setFramePacing(const FramePacing pacing,
+                        const std::chrono::microseconds deadline);
+    FramePacing getFramePacing() const;
+    /// Called before handling events, so that they are sampled as late as the frame pacing allows
+    void waitForFrameStart();
+    void swap();
+    void setRenderMode(const RenderMode mode);
+    RenderMode getRenderMode() const;
     void setWireframe(const bool enabled);
     void setBgColor(const glm::vec3& color);
     void clear();
     SDL_GLContext getContext() const;
     void setViewMat(const glm::mat4& mat);
 
+    constexpr static size_t MIN_QUADS_PER_ROW = 128;
+
 private:
-    std::vector<Vertex> m_Vertices;
-    std::vector<index_t> m_Indices;
-    std::unique_ptr<Mesh> m_GlyphMesh;
+    struct RowSlot {
+        size_t row;
+        uint64_t version;
+        bool valid = false;
+        /// Some cells were drawn with the fallback glyph
+        bool missingGlyphs = false;
+    };
+
+    void makeRow(const std::vector<Cell>& row, size_t y, Font& font);
+    /// Pixel offset when mvp only differs from the previous one by a vertical translation of whole pixels
+    std::optional<GLint> getScrollOffset(const glm::mat4& mvp) const;
+    FrameCache::Rect getRowRect(size_t y, const glm::mat4& mvp,
+                                const Font& font) const;
+
+    /// Vertices of the row currently being generated
+    std::vector<Vertex> m_BgVertices;
+    std::vector<Vertex> m_FgVertices;
+    /// Glyphs of the row currently being generated, empty when shaping is disabled
+    std::vector<ShapedGlyph> m_ShapedGlyphs;
+    /// Which row (and which version of it) is stored in each mesh slot.
+    /// Row y is always stored in slot y % slot count, so scrolling only replaces the rows that came into view.
+    std::vector<RowSlot> m_RowSlots;
+    /// Atlas pages of the row in each mesh slot
+    RowPages m_RowPages;
+    std::unique_ptr<RowMesh> m_TextMesh;
+    std::unique_ptr<CellGrid> m_CellGrid;
+    std::unique_ptr<FrameCache> m_FrameCache;
+    std::unique_ptr<FramePacer> m_FramePacer;
+    std::unique_ptr<Overlay> m_Overlay;
+    std::unique_ptr<PaletteTexture> m_PaletteTexture;
+    std::unique_ptr<GpuTimer> m_DrawTimer;
+    /// Rows regenerated by makeTextMesh since the last drawText
+    std::vector<size_t> m_DamagedRows;
+    std::optional<glm::mat4> m_PrevMvp = std::nullopt;
+    bool m_Wireframe = false;
+    RenderMode m_RenderMode = RenderMode::Mesh;
     SDL_GLContext m_GlContext;
     glm::mat4 m_ProjectionMat;
     glm::mat4 m_ViewMat;
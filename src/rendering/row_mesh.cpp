@@ -0,0 +1,99 @@
+#include "row_mesh.hpp"
+#include "index_buffer.hpp"
+#include "opengl.hpp"
+#include "vertex_array.hpp"
+#include "vertex_buffer.hpp"
+#include <spdlog/spdlog.h>
+
+RowMesh::RowMesh(const size_t slotCount, const size_t quadsPerSlot)
+    : m_SlotCount(slotCount), m_QuadsPerSlot(quadsPerSlot),
+      m_BgQuadCounts(slotCount, 0), m_FgQuadCounts(slotCount, 0) {
+    m_Va = std::make_unique<VertexArray>();
+    m_Ib = std::make_unique<IndexBuffer>(quadsPerSlot * 6);
+    m_Vb = std::make_unique<VertexBuffer>(slotCount * quadsPerSlot * 2 * 4);
+    m_Va->addBuffer(*m_Vb);
+
+    // Every slot has the same quad layout, so one set of indices is shared by all of them (see glMultiDrawElementsBaseVertex)
+    std::vector<index_t> indices;
+    indices.reserve(quadsPerSlot * 6);
+    for (index_t i = 0; i < quadsPerSlot * 4; i += 4) {
+        // First triangle
+        indices.push_back(i + 0);
+        indices.push_back(i + 1);
+        indices.push_back(i + 3);
+
+        // Second triangle
+        indices.push_back(i + 1);
+        indices.push_back(i + 2);
+        indices.push_back(i + 3);
+    }
+    m_Ib->update(indices);
+
+    SPDLOG_DEBUG("Created row mesh with {} slots of {} quads", slotCount,
+                 quadsPerSlot);
+}
+
+RowMesh::~RowMesh() {
+    SPDLOG_DEBUG("Deleted row mesh");
+}
+
+void RowMesh::updateSlot(const size_t slot, std::vector<Vertex>& bgVertices,
+                         std::vector<Vertex>& fgVertices) {
+    assert(slot < m_SlotCount);
+    assert(bgVertices.size() <= m_QuadsPerSlot * 4);
+    assert(fgVertices.size() <= m_QuadsPerSlot * 4);
+
+    const size_t slotStart = slot * m_QuadsPerSlot * 2 * 4;
+    if (!bgVertices.empty()) {
+        m_Vb->update(bgVertices, slotStart);
+    }
+    if (!fgVertices.empty()) {
+        m_Vb->update(fgVertices, slotStart + m_QuadsPerSlot * 4);
+    }
+    m_BgQuadCounts[slot] = bgVertices.size() / 4;
+    m_FgQuadCounts[slot] = fgVertices.size() / 4;
+}
+
+void RowMesh::clearSlot(const size_t slot) {
+    m_BgQuadCounts[slot] = 0;
+    m_FgQuadCounts[slot] = 0;
+}
+
+void RowMesh::draw() const {
+    m_Va->bind();
+    m_Ib->bind();
+    drawPass(m_BgQuadCounts, 0);
+    drawPass(m_FgQuadCounts, m_QuadsPerSlot * 4);
+}
+
+size_t RowMesh::getSlotCount() const {
+    return m_SlotCount;
+}
+
+size_t RowMesh::getQuadsPerSlot() const {
+    return m_QuadsPerSlot;
+}
+
+// PRIVATE
+void RowMesh::drawPass(const std::vector<GLsizei>& quadCounts,
+                       const size_t vertexOffset) const {
+    std::vector<GLsizei> counts;
+    std::vector<const void*> indexOffsets;
+    std::vector<GLint> baseVertices;
+
+    for (size_t slot = 0; slot < m_SlotCount; slot++) {
+        if (quadCounts[slot] == 0) {
+            continue;
+        }
+        counts.push_back(quadCounts[slot] * 6);
+        indexOffsets.push_back(nullptr);
+        baseVertices.push_back(slot * m_QuadsPerSlot * 2 * 4 + vertexOffset);
+    }
+    if (counts.empty()) {
+        return;
+    }
+
+    glCall(glMultiDrawElementsBaseVertex(
+        GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, indexOffsets.data(),
+        counts.size(), baseVertices.data()));
+}
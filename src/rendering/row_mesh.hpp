@@ -0,0 +1,41 @@
+#pragma once
+
+#include "index_buffer.hpp"
+#include "opengl.hpp"
+#include "vertex_array.hpp"
+#include "vertex_buffer.hpp"
+#include <memory>
+#include <vector>
+
+/// Mesh split into equally sized slots, one per terminal row.
+/// Each slot holds the row's background quads followed by its foreground quads,
+/// so a single row can be replaced without uploading the rest of the mesh.
+class RowMesh {
+public:
+    RowMesh() = delete;
+    RowMesh(const size_t slotCount, const size_t quadsPerSlot);
+    ~RowMesh();
+
+    /// Both vectors must contain whole quads (4 vertices each)
+    void updateSlot(const size_t slot, std::vector<Vertex>& bgVertices,
+                    std::vector<Vertex>& fgVertices);
+    void clearSlot(const size_t slot);
+    /// Draws backgrounds of all slots first, so that glyphs overhanging into neighbouring cells aren't covered
+    void draw() const;
+
+    size_t getSlotCount() const;
+    size_t getQuadsPerSlot() const;
+
+private:
+    void drawPass(const std::vector<GLsizei>& quadCounts,
+                  const size_t vertexOffset) const;
+
+    size_t m_SlotCount;
+    size_t m_QuadsPerSlot;
+    std::vector<GLsizei> m_BgQuadCounts;
+    std::vector<GLsizei> m_FgQuadCounts;
+
+    std::unique_ptr<VertexArray> m_Va;
+    std::unique_ptr<VertexBuffer> m_Vb;
+    std::unique_ptr<IndexBuffer> m_Ib;
+};
@@ -0,0 +1,21 @@
+#include "row_pages.hpp"
+
+void RowPages::resize(size_t slots) {
+    m_Pages.assign(slots, {});
+}
+
+void RowPages::set(size_t slot, std::vector<uint32_t> pages) {
+    m_Pages[slot] = std::move(pages);
+}
+
+void RowPages::clear(size_t slot) {
+    m_Pages[slot].clear();
+}
+
+void RowPages::touch(Atlas& atlas, uint64_t frame) const {
+    for (const std::vector<uint32_t>& pages : m_Pages) {
+        for (const uint32_t page : pages) {
+            atlas.touch(page, frame);
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "atlas.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Atlas pages used by the row in each row slot. Rows are only meshed again when they change, so the pages of
+/// rows which stay in view are touched from here every frame, before the atlas evicts anything.
+class RowPages {
+public:
+    /// Forgets the pages of all slots
+    void resize(size_t slots);
+    void set(size_t slot, std::vector<uint32_t> pages);
+    void clear(size_t slot);
+    /// Marks the pages of all slots as used in the frame
+    void touch(Atlas& atlas, uint64_t frame) const;
+
+private:
+    std::vector<std::vector<uint32_t>> m_Pages;
+};
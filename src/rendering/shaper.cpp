@@ -0,0 +1,158 @@
+#ifdef YATE_HARFBUZZ
+#include "shaper.hpp"
+#include "../utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+#include <spdlog/spdlog.h>
+
+Shaper::Shaper(
+    const std::array<std::filesystem::path, cell_style::COUNT>& paths,
+    float size)
+    : m_Paths(paths), m_Size(size) {
+    m_Buffer = hb_buffer_create();
+    SPDLOG_DEBUG("Created shaper for '{}' at {}px",
+                 paths[cell_style::REGULAR].c_str(), size);
+}
+
+Shaper::~Shaper() {
+    hb_buffer_destroy(m_Buffer);
+    for (const Face& face : m_Faces) {
+        if (face.blob != nullptr) {
+            hb_font_destroy(face.font);
+            hb_face_destroy(face.face);
+            hb_blob_destroy(face.blob);
+        }
+    }
+}
+
+void Shaper::shapeRow(const std::vector<Cell>& row,
+                      std::vector<ShapedGlyph>& out) {
+    out.assign(row.size(), ShapedGlyph{});
+
+    size_t start = 0;
+    m_Run.clear();
+    const auto endRun = [&]() {
+        // A single character can't form a ligature
+        if (m_Run.size() >= 3) {
+            const std::vector<ShapedGlyph>& glyphs = shapeRun(m_Run);
+            std::copy(glyphs.begin(), glyphs.end(), out.begin() + start);
+        }
+        m_Run.clear();
+    };
+
+    for (size_t x = 0; x < row.size(); x++) {
+        const Cell& cell = row[x];
+        if (!isShapeable(cell)) {
+            endRun();
+            continue;
+        }
+        if (!m_Run.empty() && (cell.fgColor != row[x - 1].fgColor ||
+                               cell.bgColor != row[x - 1].bgColor ||
+                               cell.style != row[x - 1].style)) {
+            endRun();
+        }
+        if (m_Run.empty()) {
+            start = x;
+            m_Run.push_back(cell.style);
+        }
+        m_Run.push_back(cell.character);
+    }
+    endRun();
+}
+
+// PRIVATE
+const std::vector<ShapedGlyph>& Shaper::shapeRun(const std::u32string& run) {
+    if (const auto it = m_Cache.find(run); it != m_Cache.end()) {
+        return it->second;
+    }
+    if (m_Cache.size() >= MAX_CACHED_RUNS) {
+        SPDLOG_DEBUG("Shaping cache is full, clearing {} runs",
+                     m_Cache.size());
+        m_Cache.clear();
+    }
+
+    hb_font_t* font = getFont(run[0]);
+    const std::u32string_view text = std::u32string_view(run).substr(1);
+    hb_buffer_clear_contents(m_Buffer);
+    for (size_t i = 0; i < text.size(); i++) {
+        hb_buffer_add(m_Buffer, text[i], i);
+    }
+    hb_buffer_set_direction(m_Buffer, HB_DIRECTION_LTR);
+    hb_buffer_set_script(m_Buffer, HB_SCRIPT_LATIN);
+    hb_shape(font, m_Buffer, nullptr, 0);
+
+    unsigned int count = 0;
+    const hb_glyph_info_t* infos = hb_buffer_get_glyph_infos(m_Buffer, &count);
+    const hb_glyph_position_t* positions =
+        hb_buffer_get_glyph_positions(m_Buffer, &count);
+
+    // Where each cell's glyph would be without shaping
+    std::vector<hb_codepoint_t> nominal(text.size(), 0);
+    std::vector<hb_position_t> cellX(text.size(), 0);
+    for (size_t i = 0; i < text.size(); i++) {
+        hb_font_get_nominal_glyph(font, text[i], &nominal[i]);
+        if (i + 1 < text.size()) {
+            cellX[i + 1] =
+                cellX[i] + hb_font_get_glyph_h_advance(font, nominal[i]);
+        }
+    }
+
+    // Cells without a glyph of their own were merged into a ligature
+    std::vector<ShapedGlyph> glyphs(text.size(),
+                                    ShapedGlyph{.glyph = ShapedGlyph::NONE});
+    std::vector<bool> placed(text.size(), false);
+    hb_position_t penX = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        const uint32_t cell = infos[i].cluster;
+        // A cell only has room for one glyph, further glyphs of its cluster are dropped
+        if (cell < glyphs.size() && !placed[cell]) {
+            placed[cell] = true;
+            const hb_position_t offsetX =
+                penX + positions[i].x_offset - cellX[cell];
+            const hb_position_t offsetY = positions[i].y_offset;
+            const bool unchanged = infos[i].codepoint == nominal[cell] &&
+                                   offsetX == 0 && offsetY == 0;
+            // .notdef is left to the fallback fonts
+            if (unchanged || infos[i].codepoint == 0) {
+                glyphs[cell] = ShapedGlyph{};
+            } else {
+                glyphs[cell] = ShapedGlyph{.glyph = infos[i].codepoint,
+                                           .offsetX = offsetX / 64.0f,
+                                           .offsetY = offsetY / 64.0f};
+            }
+        }
+        penX += positions[i].x_advance;
+    }
+
+    SPDLOG_TRACE("Shaped run of {} characters into {} glyphs", text.size(),
+                 count);
+    return m_Cache.emplace(run, std::move(glyphs)).first->second;
+}
+
+hb_font_t* Shaper::getFont(uint8_t style) {
+    Face& face = m_Faces[style];
+    if (face.blob != nullptr) {
+        return face.font;
+    }
+
+    // Shaped with HarfBuzz's own OpenType functions, so it doesn't have to be built against freetype
+    const std::filesystem::path& path = m_Paths[style];
+    face.blob = hb_blob_create_from_file_or_fail(path.c_str());
+    if (face.blob == nullptr) {
+        FATAL("Failed to load font '{}' for shaping", path.c_str());
+    }
+    face.face = hb_face_create(face.blob, 0);
+    face.font = hb_font_create(face.face);
+    // Same units as freetype metrics (26.6 pixels)
+    const int scale = std::lround(m_Size * 64);
+    hb_font_set_scale(face.font, scale, scale);
+    SPDLOG_DEBUG("Opened '{}' for shaping", path.c_str());
+    return face.font;
+}
+
+bool Shaper::isShapeable(const Cell& cell) {
+    return cell.character > ' ' && cell.character <= '~' && cell.width == 1 &&
+           cell.combining == 0;
+}
+#endif
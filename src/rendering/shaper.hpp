@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../terminal/terminal_buffer.hpp"
+#include <cstdint>
+#include <vector>
+
+/// Glyph of a cell after shaping, relative to the glyph the cell would be drawn with on its own
+struct ShapedGlyph {
+    /// Glyph index in the main font, or NOMINAL / NONE
+    uint32_t glyph = NOMINAL;
+    /// Pixels from the cell's pen
+    float offsetX = 0;
+    float offsetY = 0;
+
+    /// Drawn with the glyph of its codepoint, as without shaping
+    constexpr static uint32_t NOMINAL = UINT32_MAX;
+    /// Covered by a ligature drawn from an earlier cell
+    constexpr static uint32_t NONE = UINT32_MAX - 1;
+};
+
+#ifdef YATE_HARFBUZZ
+#include <array>
+#include <filesystem>
+#include <hb.h>
+#include <string>
+#include <unordered_map>
+
+/// Shapes runs of printable ASCII with HarfBuzz, so that programming ligatures are drawn. Every cell keeps its
+/// column, a ligature is drawn from the first cell of its cluster and the other cells of the cluster stay empty.
+/// Shaped runs are cached by their style and text, the cache belongs to one font, so the font and its size are part of the key.
+class Shaper {
+public:
+    /// One face per cell style, faces are opened when text of their style is first shaped
+    Shaper(const std::array<std::filesystem::path, cell_style::COUNT>& paths,
+           float size);
+    ~Shaper();
+
+    /// One glyph per cell. Runs of cells with the same colors and style are shaped together, ligatures don't cross
+    /// style changes, spaces or characters outside of ASCII.
+    void shapeRow(const std::vector<Cell>& row, std::vector<ShapedGlyph>& out);
+
+    /// The cache is dropped as a whole when it grows past this, runs are short and cheap to shape again
+    constexpr static size_t MAX_CACHED_RUNS = 8192;
+
+private:
+    struct Face {
+        hb_blob_t* blob = nullptr;
+        hb_face_t* face = nullptr;
+        hb_font_t* font = nullptr;
+    };
+
+    /// The run starts with its style, followed by its text
+    const std::vector<ShapedGlyph>& shapeRun(const std::u32string& run);
+    hb_font_t* getFont(uint8_t style);
+    static bool isShapeable(const Cell& cell);
+
+    std::array<std::filesystem::path, cell_style::COUNT> m_Paths;
+    float m_Size;
+    std::array<Face, cell_style::COUNT> m_Faces;
+    hb_buffer_t* m_Buffer;
+    std::unordered_map<std::u32string, std::vector<ShapedGlyph>> m_Cache;
+    /// Style and text of the run currently being collected
+    std::u32string m_Run;
+};
+#endif
@@ -0,0 +1,150 @@
+#include "shaping_benchmark.hpp"
+#include "../application.hpp"
+#include "../utils.hpp"
+#include "atlas.hpp"
+#include <SDL.h>
+#include <chrono>
+#include <cstdlib>
+#include <spdlog/fmt/fmt.h>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+
+int ShapingBenchmark::run(const std::filesystem::path& font) {
+#ifndef YATE_HARFBUZZ
+    (void)font;
+    fmt::print(stderr, "Built without HarfBuzz, configure with "
+                       "-DYATE_HARFBUZZ=ON to measure shaping\n");
+    return EXIT_FAILURE;
+#else
+    if (!std::filesystem::exists(font)) {
+        fmt::print(stderr, "Font '{}' doesn't exist\n", font.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // Meshing uploads the rows, so it needs a context, but not a visible window
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        FATAL("Failed to initialize SDL: {}", SDL_GetError());
+    }
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
+                        SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_Window* window = SDL_CreateWindow(
+        "yate", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+        Application::WIDTH, Application::HEIGHT,
+        SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (window == nullptr) {
+        FATAL("Failed to create window: {}", SDL_GetError());
+    }
+
+    {
+        Renderer renderer(window, 1);
+        const TerminalBuf termBuf = makeScreen();
+
+        // Fonts of the same size can't share a family at the same time, so the first one is destroyed first
+        FontFamily family(font, GlyphFormat::Coverage);
+        Result plain;
+        {
+            Font plainFont(family, FONT_SIZE, Atlas::DEFAULT_BUDGET, false);
+            plain = measure(renderer, plainFont, termBuf);
+        }
+        Font shapedFont(family, FONT_SIZE, Atlas::DEFAULT_BUDGET, true);
+        const Result shaped = measure(renderer, shapedFont, termBuf);
+
+        fmt::print("{:<10}{:>18}{:>12}\n", "shaping", "first frame ms",
+                   "frame ms");
+        fmt::print("{:<10}{:>18.3f}{:>12.3f}\n", "off", plain.firstFrameMs,
+                   plain.frameMs);
+        fmt::print("{:<10}{:>18.3f}{:>12.3f}\n", "on", shaped.firstFrameMs,
+                   shaped.frameMs);
+        fmt::print("\nShaping adds {:.1f}% to the first frame and {:.1f}% to "
+                   "the following frames of {} rows\n",
+                   (shaped.firstFrameMs / plain.firstFrameMs - 1) * 100,
+                   (shaped.frameMs / plain.frameMs - 1) * 100, ROWS);
+    }
+
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return EXIT_SUCCESS;
+#endif
+}
+
+// PRIVATE
+ShapingBenchmark::Result
+ShapingBenchmark::measure(Renderer& renderer, Font& font,
+                          const TerminalBuf& termBuf) {
+    using clock = std::chrono::steady_clock;
+    const Viewport viewport = {.firstRow = 0,
+                               .rowCount = termBuf.getRows().size()};
+
+    // Rasterization isn't measured, the benchmark is about meshing
+    std::unordered_set<codepoint_t> codepoints;
+    for (const auto& row : termBuf.getRows()) {
+        for (const Cell& cell : row) {
+            codepoints.insert(cell.character);
+        }
+    }
+    font.updateAtlas(codepoints);
+    fillAtlas(font);
+
+    renderer.invalidateTextMesh();
+    auto start = clock::now();
+    renderer.makeTextMesh(termBuf, viewport, font);
+    const double firstFrameMs =
+        std::chrono::duration<double, std::milli>(clock::now() - start)
+            .count();
+    // Ligature glyphs are only requested once they're drawn
+    fillAtlas(font);
+
+    start = clock::now();
+    for (size_t i = 0; i < FRAMES; i++) {
+        renderer.invalidateTextMesh();
+        renderer.makeTextMesh(termBuf, viewport, font);
+    }
+    const double frameMs =
+        std::chrono::duration<double, std::milli>(clock::now() - start)
+            .count() /
+        FRAMES;
+
+    return Result{.firstFrameMs = firstFrameMs, .frameMs = frameMs};
+}
+
+void ShapingBenchmark::fillAtlas(Font& font) {
+    std::unordered_set<codepoint_t> none;
+    font.updateAtlas(none);
+    while (font.needsAtlasUpdate()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        font.updateAtlas(none);
+    }
+}
+
+TerminalBuf ShapingBenchmark::makeScreen() {
+    // Code with the usual ligature candidates, repeated to fill the screen
+    constexpr std::string_view LINES[] = {
+        "template <typename T> auto clamp(T v, T lo, T hi) -> T {",
+        "    return v < lo ? lo : (v > hi ? hi : v); // <= and >= work too",
+        "}",
+        "const isValid = (x) => x !== null && x !== undefined || x === 0;",
+        "for (size_t i = 0; i != items.size(); ++i) { total += items[i]; }",
+        "if (a == b && c != d || !(e >= f)) { std::cout << a << '\\n'; }",
+        "main :: IO ()",
+        "main = getLine >>= putStrLn . map toUpper <$> pure \"=<< ->\"",
+        "/* Block comments */ let r = x |> f |> g; www <!-- --> ... ::= ",
+        "    auto it = std::find_if(v.begin(), v.end(), [&](auto& e) {",
+        "        return e->id == id && e->parent != nullptr;",
+        "    });",
+    };
+
+    TerminalBuf termBuf;
+    for (size_t y = 0; y < ROWS; y++) {
+        const std::string_view line = LINES[y % std::size(LINES)];
+        std::vector<Cell> row;
+        for (size_t x = 0; x < line.size(); x++) {
+            row.push_back(Cell{.character = (codepoint_t)line[x],
+                               .offset = (uint32_t)x});
+        }
+        termBuf.pushRow(std::move(row));
+    }
+    return termBuf;
+}
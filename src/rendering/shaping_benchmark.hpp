@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../terminal/terminal_buffer.hpp"
+#include "font.hpp"
+#include "renderer.hpp"
+#include <cstddef>
+#include <filesystem>
+
+/// Measures what shaping adds to generating the text mesh, run with `yate --bench-shaping [font]`.
+/// A screen of source code is meshed from scratch without shaping and with shaping. The first frame with shaping
+/// shapes every run, the following ones take them from the shaping cache, like rows which are redrawn without changes.
+class ShapingBenchmark {
+public:
+    static int run(const std::filesystem::path& font);
+
+    constexpr static float FONT_SIZE = 16;
+    constexpr static size_t ROWS = 60;
+    constexpr static size_t FRAMES = 200;
+
+private:
+    struct Result {
+        double firstFrameMs;
+        double frameMs;
+    };
+
+    static Result measure(Renderer& renderer, Font& font,
+                          const TerminalBuf& termBuf);
+    /// Waits until all glyphs requested by the font are in the atlas
+    static void fillAtlas(Font& font);
+    static TerminalBuf makeScreen();
+};
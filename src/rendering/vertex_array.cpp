@@ -22,11 +22,11 @@ void VertexArray::addBuffer(const VertexBuffer& vb) const {
                                  (const void*)offsetof(Vertex, pos)));
     glCall(glEnableVertexAttribArray(0));
 
-    glCall(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                                 (const void*)offsetof(Vertex, color)));
+    glCall(glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(Vertex),
+                                  (const void*)offsetof(Vertex, color)));
     glCall(glEnableVertexAttribArray(1));
 
-    glCall(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+    glCall(glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
                                  (const void*)offsetof(Vertex, uv)));
     glCall(glEnableVertexAttribArray(2));
 
@@ -1,4 +1,5 @@
 #include "vertex_buffer.hpp"
+#include "../stats.hpp"
 #include "opengl.hpp"
 #include <spdlog/spdlog.h>
 
@@ -27,6 +28,14 @@ void VertexBuffer::update(std::vector<Vertex>& vertices) {
     bind();
     glCall(glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex),
                            vertices.data()));
+    Stats::add(Counter::UploadBytes, vertices.size() * sizeof(Vertex));
+}
+
+void VertexBuffer::update(std::vector<Vertex>& vertices, size_t offset) {
+    bind();
+    glCall(glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(Vertex),
+                           vertices.size() * sizeof(Vertex), vertices.data()));
+    Stats::add(Counter::UploadBytes, vertices.size() * sizeof(Vertex));
 }
 
 GLuint VertexBuffer::getId() const {
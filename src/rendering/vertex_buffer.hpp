@@ -1,15 +1,17 @@
 #pragma once
 
+#include "colors.hpp"
 #include "opengl.hpp"
 #include <glm/ext/vector_float2.hpp>
 #include <glm/ext/vector_float3.hpp>
-#include <glm/ext/vector_float4.hpp>
 #include <vector>
 
 struct Vertex {
     glm::vec3 pos;
-    glm::vec4 color;
-    glm::vec2 uv;
+    /// Resolved in the vertex shader
+    color_t color;
+    /// Atlas coordinates and page
+    glm::vec3 uv;
     GLint bg;
 };
 
@@ -22,6 +24,8 @@ public:
     void bind() const;
     void unbind() const;
     void update(std::vector<Vertex>& vertices);
+    /// Offset is in vertices, not bytes
+    void update(std::vector<Vertex>& vertices, size_t offset);
 
     GLuint getId() const;
 
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+/// Range of terminal rows visible on screen
+struct Viewport {
+    size_t firstRow;
+    size_t rowCount;
+
+    bool operator==(const Viewport& rhs) const = default;
+};
@@ -0,0 +1,37 @@
+#include "startup_timer.hpp"
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+StartupTimer::StartupTimer() : m_Start(clock::now()), m_Last(m_Start) {}
+
+void StartupTimer::mark(const char* phase) {
+    const clock::time_point now = clock::now();
+    m_Phases.push_back(Phase{
+        .name = phase,
+        .ms = std::chrono::duration<double, std::milli>(now - m_Last).count(),
+        .parallel = false});
+    m_Last = now;
+}
+
+void StartupTimer::addParallel(const char* phase, clock::time_point start,
+                               clock::time_point end) {
+    m_Phases.push_back(Phase{
+        .name = phase,
+        .ms = std::chrono::duration<double, std::milli>(end - start).count(),
+        .parallel = true});
+}
+
+void StartupTimer::log() const {
+    std::string phases;
+    for (const Phase& phase : m_Phases) {
+        if (!phases.empty()) {
+            phases += ", ";
+        }
+        phases += fmt::format("{} {:.1f} ms{}", phase.name, phase.ms,
+                              phase.parallel ? " (parallel)" : "");
+    }
+    SPDLOG_INFO(
+        "Started in {:.1f} ms: {}",
+        std::chrono::duration<double, std::milli>(m_Last - m_Start).count(),
+        phases);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/// Durations of the startup phases, logged once the first frame is on screen.
+/// Phases on the main thread follow each other, phases on other threads overlap them.
+class StartupTimer {
+public:
+    using clock = std::chrono::steady_clock;
+
+    StartupTimer();
+
+    /// Ends the current phase of the main thread, the next one starts now
+    void mark(const char* phase);
+    /// Phase which ran on another thread, started at start
+    void addParallel(const char* phase, clock::time_point start,
+                     clock::time_point end);
+    /// Logs every phase and the time since the timer was created
+    void log() const;
+
+private:
+    struct Phase {
+        const char* name;
+        double ms;
+        bool parallel;
+    };
+
+    clock::time_point m_Start;
+    clock::time_point m_Last;
+    std::vector<Phase> m_Phases;
+};
@@ -0,0 +1,22 @@
+#include "stats.hpp"
+
+std::array<std::atomic<uint64_t>, (size_t)Counter::Count> Stats::s_Counters =
+    {};
+
+Stats::Timer::Timer(Counter counter)
+    : m_Counter(counter), m_Start(std::chrono::steady_clock::now()) {}
+
+Stats::Timer::~Timer() {
+    addSince(m_Counter, m_Start);
+}
+
+void Stats::addSince(Counter counter,
+                     std::chrono::steady_clock::time_point start) {
+    add(counter, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count());
+}
+
+uint64_t Stats::take(Counter counter) {
+    return s_Counters[(size_t)counter].exchange(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+enum class Counter : uint8_t {
+    /// Bytes read from the pty
+    BytesRead,
+    ParseNs,
+    /// Cells printed by the parser
+    CellsWritten,
+    /// Meshing or updating the cell grid of the visible rows
+    MeshNs,
+    /// Vertex, index and texture data sent to the GPU
+    UploadBytes,
+    /// GPU time of drawing the text, reported a few frames late
+    DrawGpuNs,
+    /// Atlas updates which added glyphs
+    AtlasUpdates,
+    GlyphsRasterized,
+    /// Time spent waiting for the locks of the terminal state
+    LockWaitNs,
+    /// Codepoints waiting for the render thread, sampled once per frame
+    QueueDepth,
+    FrameNs,
+    Count,
+};
+
+/// Counters of the terminal, rasterizer and render threads. They're always compiled in, so that slowdowns
+/// can be diagnosed without a profiler. Writers only do relaxed atomic adds, the debug UI takes the values once per frame.
+class Stats {
+public:
+    /// Adds the time since it was created to the counter
+    class Timer {
+    public:
+        explicit Timer(Counter counter);
+        ~Timer();
+
+    private:
+        Counter m_Counter;
+        std::chrono::steady_clock::time_point m_Start;
+    };
+
+    static void add(Counter counter, uint64_t value) {
+        s_Counters[(size_t)counter].fetch_add(value,
+                                              std::memory_order_relaxed);
+    }
+    static void addSince(Counter counter,
+                         std::chrono::steady_clock::time_point start);
+    /// Value accumulated since the last call, the counter starts again from zero
+    static uint64_t take(Counter counter);
+
+private:
+    static std::array<std::atomic<uint64_t>, (size_t)Counter::Count>
+        s_Counters;
+};
@@ -1,4 +1,5 @@
 #include "csi_parser.hpp"
+#include "../trace.hpp"
 #include "parser.hpp"
 #include "types.hpp"
 #include <optional>
@@ -48,6 +49,15 @@ void CsiParser::parse(iter_t& it, iter_t end, ParserState& parserState,
     };
 
     if (m_Handlers.contains(ident)) {
+        char name[3];
+        size_t nameLen = 0;
+        for (const std::optional<char> c : {prefix, intermediate}) {
+            if (c.has_value()) {
+                name[nameLen++] = c.value();
+            }
+        }
+        name[nameLen++] = final;
+        Trace::Span span("CSI", std::string_view(name, nameLen));
         m_Handlers[ident](!ps.empty() ? ps : std::vector<uint32_t>(),
                           parserState, termBuf, cursor);
     } else {
@@ -1,4 +1,5 @@
 #include "event_handler.hpp"
+#include "../trace.hpp"
 #include "codes.hpp"
 #include "csi_idents.hpp"
 #include "nav_keys.hpp"
@@ -11,8 +12,8 @@ EventHandler::~EventHandler() {
     SDL_StopTextInput();
 }
 
-void EventHandler::handleEvents(bool& quit, Terminal& terminal,
-                                DebugUI& debugUI) {
+void EventHandler::handleEvents(bool& quit, FontZoom& zoom,
+                                Terminal& terminal, DebugUI& debugUI) {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
         debugUI.handleEvent(event);
@@ -89,6 +90,10 @@ void EventHandler::handleEvents(bool& quit, Terminal& terminal,
             }
 
 // #ifndef NDEBUG
+            case SDLK_F11: {
+                Trace::toggle();
+                break;
+            }
             case SDLK_F12: {
                 debugUI.toggle();
                 break;
@@ -98,6 +103,25 @@ void EventHandler::handleEvents(bool& quit, Terminal& terminal,
 
             // Have to stop text input when Ctrl is held down to allow for repeating Ctrl-C for example
             if (key.mod & KMOD_CTRL) {
+                switch (key.sym) {
+                case SDLK_EQUALS:
+                case SDLK_PLUS:
+                case SDLK_KP_PLUS: {
+                    zoom = FontZoom::In;
+                    break;
+                }
+                case SDLK_MINUS:
+                case SDLK_KP_MINUS: {
+                    zoom = FontZoom::Out;
+                    break;
+                }
+                case SDLK_0:
+                case SDLK_KP_0: {
+                    zoom = FontZoom::Reset;
+                    break;
+                }
+                }
+
                 SDL_StopTextInput();
                 // Have to check range otherwise segfault if big number
                 if (key.sym <= 127 && std::isalpha(key.sym)) {
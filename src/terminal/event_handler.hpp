@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../debug_ui.hpp"
+#include "../rendering/font_set.hpp"
 #include "terminal.hpp"
 #include <SDL.h>
 
@@ -9,7 +10,9 @@ public:
     EventHandler(SDL_Window* window);
     ~EventHandler();
 
-    void handleEvents(bool& quit, Terminal& terminal, DebugUI& debugUI);
+    /// Zoom is set when a font zoom binding (Ctrl+=, Ctrl+-, Ctrl+0) was pressed
+    void handleEvents(bool& quit, FontZoom& zoom, Terminal& terminal,
+                      DebugUI& debugUI);
 
 private:
     SDL_Window* m_Window;
@@ -1,4 +1,5 @@
 #include "osc_parser.hpp"
+#include "../trace.hpp"
 #include "../utils.hpp"
 #include "codes.hpp"
 #include "types.hpp"
@@ -23,15 +24,18 @@ void OscParser::parse(iter_t& it, iter_t end, TerminalBuf& termBuf,
     }
     SPDLOG_TRACE("OSC:ident = {}", ident.value());
 
-    if (*it != ARG_SEPARATOR) {
+    // Some sequences (e.g. OSC 104) can end right after the ident
+    if (*it == ARG_SEPARATOR) {
+        it++;
+    } else if (*it != c0::BEL && *it != c1::ST && *it != c0::ESC) {
         SPDLOG_ERROR("OSC - expected separator:{}", spdlog::to_hex(it, end));
         return;
     }
-    it++;
 
     uint8_t identv = ident.value();
     std::vector<std::string> args = parseArgs(it, end);
     if (m_Handlers.contains(identv)) {
+        Trace::Span span("OSC", identStr);
         m_Handlers[identv](args, termBuf, cursor);
     } else {
         SPDLOG_WARN("Unsupported OSC sequence with ident={}", identv);
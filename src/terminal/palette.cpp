@@ -0,0 +1,108 @@
+#include "palette.hpp"
+#include <cassert>
+#include <cctype>
+#include <optional>
+#include <string>
+#include <vector>
+
+Palette::Palette() {
+    for (color_t i = 0; i < colors::PALETTE_SIZE; i++) {
+        m_Colors[i] = getThemeColor(i);
+    }
+}
+
+const glm::vec4& Palette::get(color_t index) const {
+    assert(index < colors::PALETTE_SIZE);
+    return m_Colors[index];
+}
+
+void Palette::set(color_t index, const glm::vec4& color) {
+    assert(index < colors::PALETTE_SIZE);
+    m_Colors[index] = color;
+    m_Version++;
+}
+
+void Palette::reset(color_t index) {
+    set(index, getThemeColor(index));
+}
+
+uint64_t Palette::getVersion() const {
+    return m_Version;
+}
+
+const std::array<glm::vec4, colors::PALETTE_SIZE>& Palette::getColors() const {
+    return m_Colors;
+}
+
+// STATIC
+glm::vec4 Palette::getThemeColor(color_t index) {
+    assert(index < colors::PALETTE_SIZE);
+    if (index < 256) {
+        return colors::colors256[index];
+    }
+
+    switch (index) {
+    case colors::defaultFg:
+        return colors::themeDefaultFg;
+    case colors::defaultBg:
+        return colors::themeDefaultBg;
+    case colors::cursor:
+        return colors::themeCursor;
+    case colors::selection:
+        return colors::themeSelection;
+    case colors::highlight:
+        return colors::themeHighlight;
+    default:
+        return glm::vec4(0);
+    }
+}
+
+std::optional<glm::vec4> Palette::parseColorSpec(const std::string& spec) {
+    // Channel with 1-4 hex digits, scaled so that all digits set is 1
+    const auto parseChannel =
+        [](const std::string& hex) -> std::optional<float> {
+        if (hex.empty() || hex.size() > 4) {
+            return std::nullopt;
+        }
+        uint32_t value = 0;
+        for (const char c : hex) {
+            if (!std::isxdigit(c)) {
+                return std::nullopt;
+            }
+            value = value * 16 + (std::isdigit(c) ? c - '0'
+                                                  : std::tolower(c) - 'a' + 10);
+        }
+        return value / (float)((1 << (hex.size() * 4)) - 1);
+    };
+
+    std::vector<std::string> channels;
+    if (spec.starts_with("rgb:")) {
+        std::string channel;
+        for (size_t i = 4; i <= spec.size(); i++) {
+            if (i == spec.size() || spec[i] == '/') {
+                channels.push_back(channel);
+                channel.clear();
+            } else {
+                channel += spec[i];
+            }
+        }
+    } else if (spec.starts_with("#") && (spec.size() - 1) % 3 == 0) {
+        const size_t digits = (spec.size() - 1) / 3;
+        for (size_t i = 0; i < 3; i++) {
+            channels.push_back(spec.substr(1 + i * digits, digits));
+        }
+    }
+    if (channels.size() != 3) {
+        return std::nullopt;
+    }
+
+    glm::vec4 color(0, 0, 0, 1);
+    for (size_t i = 0; i < 3; i++) {
+        const std::optional<float> value = parseChannel(channels[i]);
+        if (!value.has_value()) {
+            return std::nullopt;
+        }
+        color[i] = value.value();
+    }
+    return color;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../rendering/colors.hpp"
+#include <array>
+#include <cstdint>
+#include <glm/ext/vector_float4.hpp>
+#include <optional>
+#include <string>
+
+/// RGBA values of palette indices (see color_t), changed by OSC 4/10/11/12 and their resets.
+/// The renderer resolves colors on the GPU, so changing the palette never touches the cells.
+class Palette {
+public:
+    Palette();
+
+    const glm::vec4& get(color_t index) const;
+    void set(color_t index, const glm::vec4& color);
+    /// Restores the theme color
+    void reset(color_t index);
+    /// Bumped on every change, so that the renderer only uploads the palette when needed
+    uint64_t getVersion() const;
+    const std::array<glm::vec4, colors::PALETTE_SIZE>& getColors() const;
+
+    static glm::vec4 getThemeColor(color_t index);
+    /// Supports the XParseColor formats used by xterm: rgb:r/g/b with 1-4 hex digits per channel, and #rgb with 1-4
+    static std::optional<glm::vec4> parseColorSpec(const std::string& spec);
+
+private:
+    std::array<glm::vec4, colors::PALETTE_SIZE> m_Colors;
+    uint64_t m_Version = 0;
+};
@@ -1,9 +1,12 @@
 #include "parser.hpp"
+#include "../stats.hpp"
+#include "../trace.hpp"
 #include "codes.hpp"
 #include "csi_parser.hpp"
 #include "osc_parser.hpp"
 #include "types.hpp"
 #include "unicode.hpp"
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
 Parser::Parser(CsiParser&& csiParser, OscParser&& oscParser,
@@ -13,7 +16,9 @@ Parser::Parser(CsiParser&& csiParser, OscParser&& oscParser,
 std::unordered_set<codepoint_t> Parser::parse(std::vector<uint8_t>& data,
                                               TerminalBuf& termBuf,
                                               cursor_t& cursor) {
+    Trace::Span span("Parser::parse");
     std::unordered_set<codepoint_t> codepoints;
+    uint64_t cellsWritten = 0;
 
     for (auto it = data.begin(); it < data.end(); it++) {
         codepoint_t codepoint = utf8::decode(it, data.end());
@@ -72,44 +77,7 @@ std::unordered_set<codepoint_t> Parser::parse(std::vector<uint8_t>& data,
         }
 
         default: {
-            glm::vec4 bgColor =
-                m_State.inversed ? m_State.fgColor : m_State.bgColor;
-            glm::vec4 fgColor =
-                m_State.inversed ? m_State.bgColor : m_State.fgColor;
-            // Default background has opacity of 0, we have to correct it otherwise when inverted the text would be transparent
-            if (m_State.inversed && m_State.bgColor.a == 0) {
-                fgColor.a = 1;
-            }
-
-            const Cell newCell = Cell{
-                .bgColor = bgColor,
-                .fgColor = fgColor,
-                .character = codepoint,
-                .offset = m_State.offset,
-            };
-
-            if (!isEol(newCell.character)) {
-                if (!termBuf.getRows().empty()) {
-                    std::vector<Cell>& row = termBuf.getRow(cursor.y);
-                    if (cursor.x + 1 > row.size()) {
-                        row.push_back(std::move(newCell));
-                    } else {
-                        row[cursor.x] = std::move(newCell);
-                    }
-                } else {
-                    termBuf.pushRow({std::move(newCell)});
-                }
-
-                cursor.x++;
-            }
-
-            if (newCell.character == c0::HT) {
-                m_State.offset = 0;
-            } else {
-                m_State.offset++;
-            }
-
-            if (isEol(newCell.character)) {
+            if (isEol(codepoint)) {
                 // Only add new row when at the last row
                 while (cursor.y + 1 >= termBuf.getRows().size()) {
                     termBuf.pushRow({});
@@ -118,15 +86,73 @@ std::unordered_set<codepoint_t> Parser::parse(std::vector<uint8_t>& data,
                 m_State.offset = 0;
                 cursor.x = 0;
                 cursor.y++;
+                m_Graphemes.reset();
+                break;
+            }
+
+            // Extenders and the rest of emoji sequences belong to the previous cell
+            if (!m_Graphemes.isBreak(codepoint) &&
+                extendLastCell(codepoint, termBuf, cursor)) {
+                break;
+            }
+
+            const color_t bgColor =
+                m_State.inversed ? m_State.fgColor : m_State.bgColor;
+            const color_t fgColor =
+                m_State.inversed ? m_State.bgColor : m_State.fgColor;
+            const uint8_t width = unicode::getWidth(codepoint) == 2 ? 2 : 1;
+
+            if (termBuf.getRows().empty()) {
+                termBuf.pushRow({});
+            }
+            std::vector<Cell>& row = termBuf.getRow(cursor.y);
+            putCell(row, cursor.x,
+                    Cell{
+                        .bgColor = bgColor,
+                        .fgColor = fgColor,
+                        .character = codepoint,
+                        .offset = m_State.offset,
+                        .width = width,
+                        .style = m_State.style,
+                    });
+            if (width == 2) {
+                putCell(row, cursor.x + 1,
+                        Cell{
+                            .bgColor = bgColor,
+                            .fgColor = fgColor,
+                            .character = codepoint,
+                            .offset = m_State.offset + 1,
+                            .width = 0,
+                            .style = m_State.style,
+                        });
+            }
+            m_LastCell = glm::uvec2(cursor.x, cursor.y);
+            cursor.x += width;
+            cellsWritten += width;
+
+            if (codepoint == c0::HT) {
+                m_State.offset = 0;
+            } else {
+                m_State.offset += width;
             }
             break;
         }
         }
     }
 
+    Stats::add(Counter::CellsWritten, cellsWritten);
     return codepoints;
 }
 
+const ParserState& Parser::getState() const {
+    return m_State;
+}
+
+void Parser::setState(const ParserState& state) {
+    m_State = state;
+    m_LastCell = std::nullopt;
+}
+
 // STATIC
 std::vector<uint32_t> Parser::parsePs(iter_t& it, iter_t end) {
     std::vector<std::string> argsString;
@@ -176,3 +202,53 @@ std::string Parser::readUntilST(iter_t& it, iter_t end) {
 bool Parser::isEol(codepoint_t character) {
     return character == c0::LF || character == c0::VT || character == c0::FF;
 }
+
+// PRIVATE
+bool Parser::extendLastCell(codepoint_t codepoint, TerminalBuf& termBuf,
+                            const cursor_t& cursor) {
+    if (!m_LastCell.has_value()) {
+        return false;
+    }
+
+    // The cursor has to be right after the cell, otherwise something else was written in between
+    const glm::uvec2 pos = m_LastCell.value();
+    const auto& rows = termBuf.getRows();
+    if (pos.y >= rows.size() || pos.x >= rows[pos.y].size()) {
+        return false;
+    }
+    const Cell& cell = rows[pos.y][pos.x];
+    if ((size_t)cursor.y != pos.y ||
+        (size_t)cursor.x != pos.x + std::max<uint8_t>(cell.width, 1)) {
+        return false;
+    }
+
+    if (cell.combining == 0 && unicode::isCombiningMark(codepoint)) {
+        termBuf.getCell(pos.x, pos.y).combining = codepoint;
+    }
+    return true;
+}
+
+void Parser::putCell(std::vector<Cell>& row, size_t x, const Cell& cell) {
+    if (x >= row.size()) {
+        row.push_back(cell);
+        return;
+    }
+
+    // Overwriting half of a wide character leaves the other half blank
+    const Cell& prev = row[x];
+    if (prev.width == 0 && x > 0 && row[x - 1].width == 2) {
+        Cell& wide = row[x - 1];
+        wide = Cell{.bgColor = wide.bgColor,
+                    .fgColor = wide.fgColor,
+                    .character = ' ',
+                    .offset = wide.offset};
+    }
+    if (prev.width == 2 && x + 1 < row.size() && row[x + 1].width == 0) {
+        Cell& continuation = row[x + 1];
+        continuation = Cell{.bgColor = continuation.bgColor,
+                            .fgColor = continuation.fgColor,
+                            .character = ' ',
+                            .offset = continuation.offset};
+    }
+    row[x] = cell;
+}
@@ -8,6 +8,8 @@
 #include "unicode.hpp"
 #include <SDL.h>
 #include <glm/ext/vector_float4.hpp>
+#include <glm/ext/vector_uint2.hpp>
+#include <optional>
 #include <unordered_set>
 #include <vector>
 
@@ -19,13 +21,26 @@ public:
     std::unordered_set<codepoint_t>
     parse(std::vector<uint8_t>& data, TerminalBuf& termBuf, cursor_t& cursor);
 
+    const ParserState& getState() const;
+    /// Restores the state of a keyframe, the grapheme cluster of the last cell isn't extended afterwards
+    void setState(const ParserState& state);
+
     static std::vector<uint32_t> parsePs(iter_t& it, iter_t end);
     static std::string readUntilST(iter_t& it, iter_t end);
     static bool isEol(codepoint_t character);
 
 private:
+    /// Adds the codepoint to the grapheme cluster of the last written cell, if the cursor is still after it
+    bool extendLastCell(codepoint_t codepoint, TerminalBuf& termBuf,
+                        const cursor_t& cursor);
+    /// Writes the cell at x, clearing wide characters which it partly overwrites
+    static void putCell(std::vector<Cell>& row, size_t x, const Cell& cell);
+
     ParserState m_State;
     CsiParser m_CsiParser;
     OscParser m_OscParser;
     EscParser m_EscParser;
+    unicode::GraphemeBreaker m_Graphemes;
+    /// Column and row of the last written cell
+    std::optional<glm::uvec2> m_LastCell;
 };
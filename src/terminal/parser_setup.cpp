@@ -5,14 +5,17 @@
 #include "esc_parser.hpp"
 #include "osc_parser.hpp"
 #include "terminal_buffer.hpp"
+#include "palette.hpp"
 #include "types.hpp"
+#include <charconv>
+#include <optional>
 #include <spdlog/spdlog.h>
 #include <string>
 
 #define DEFAULT(arr, default) arr.size() > 0 ? arr[0] : default
 
 // CSI
-static glm::vec4 getSystemColorFromPs(uint32_t ps, bool bg) {
+static color_t getSystemColorFromPs(uint32_t ps, bool bg) {
     if (bg) {
         ps -= 40;
     } else {
@@ -20,7 +23,7 @@ static glm::vec4 getSystemColorFromPs(uint32_t ps, bool bg) {
     }
 
     if (ps >= 0 && ps <= 7) {
-        return colors::colors256[ps];
+        return ps;
     } else if (ps == 9) {
         return bg ? colors::defaultBg : colors::defaultFg;
     } else {
@@ -30,7 +33,7 @@ static glm::vec4 getSystemColorFromPs(uint32_t ps, bool bg) {
         return bg ? colors::defaultBg : colors::defaultFg;
     }
 }
-static glm::vec4 getBrightColorFromPs(uint32_t ps, bool bg) {
+static color_t getBrightColorFromPs(uint32_t ps, bool bg) {
     if (bg) {
         ps -= 100;
     } else {
@@ -38,7 +41,7 @@ static glm::vec4 getBrightColorFromPs(uint32_t ps, bool bg) {
     }
 
     if (ps >= 0 && ps <= 7) {
-        return colors::colors256[ps + 8];
+        return ps + 8;
     } else {
         SPDLOG_WARN(
             "Invalid single bright color code ({}), returning default color",
@@ -76,7 +79,34 @@ static void setCursor(uint32_t x, uint32_t y, TerminalBuf& termBuf,
     cursor.y = y;
 }
 
-Parser parser_setup(SDL_Window* window) {
+// OSC
+static std::optional<color_t> parsePaletteIndex(const std::string& str) {
+    color_t index = 0;
+    const auto [end, err] =
+        std::from_chars(str.data(), str.data() + str.size(), index);
+    if (err != std::errc() || end != str.data() + str.size() || index > 255) {
+        return std::nullopt;
+    }
+    return index;
+}
+/// Each argument sets the next dynamic color, e.g. OSC 10 ; fg ; bg sets both the default foreground and background
+static void setDynamicColors(const std::vector<std::string>& args,
+                             color_t first, Terminal& terminal) {
+    terminal.getPaletteMut([&args, first](Palette& palette) {
+        for (color_t i = 0; i < args.size() && first + i <= colors::cursor;
+             i++) {
+            const auto color = Palette::parseColorSpec(args[i]);
+            if (!color.has_value()) {
+                SPDLOG_WARN("Unsupported color spec '{}' for palette entry {}",
+                            args[i], first + i);
+                continue;
+            }
+            palette.set(first + i, color.value());
+        }
+    });
+}
+
+Parser parser_setup(SDL_Window* window, Terminal& terminal) {
     CsiParser csi;
 
     csi.addHandler(csiidents::ICH, [](const std::vector<uint32_t> args,
@@ -226,6 +256,8 @@ Parser parser_setup(SDL_Window* window) {
         if (args.size() == 0) {
             parserState.bgColor = colors::defaultBg;
             parserState.fgColor = colors::defaultFg;
+            parserState.inversed = false;
+            parserState.style = cell_style::REGULAR;
             return;
         }
 
@@ -237,12 +269,29 @@ Parser parser_setup(SDL_Window* window) {
                 parserState.bgColor = colors::defaultBg;
                 parserState.fgColor = colors::defaultFg;
                 parserState.inversed = false;
+                parserState.style = cell_style::REGULAR;
+                break;
+            }
+            case 1: {
+                parserState.style |= cell_style::BOLD;
+                break;
+            }
+            case 3: {
+                parserState.style |= cell_style::ITALIC;
                 break;
             }
             case 7: {
                 parserState.inversed = true;
                 break;
             }
+            case 22: {
+                parserState.style &= ~cell_style::BOLD;
+                break;
+            }
+            case 23: {
+                parserState.style &= ~cell_style::ITALIC;
+                break;
+            }
             case 27: {
                 parserState.inversed = false;
                 break;
@@ -254,12 +303,11 @@ Parser parser_setup(SDL_Window* window) {
                     uint8_t r = args[i++];
                     uint8_t g = args[i++];
                     uint8_t b = args[i++];
-                    parserState.fgColor =
-                        glm::vec4(r / 255.0, g / 255.0, b / 255.0, 1);
+                    parserState.fgColor = colors::truecolor(r, g, b);
                     break;
                 }
                 case 5: {
-                    parserState.fgColor = colors::colors256[args[i++]];
+                    parserState.fgColor = (uint8_t)args[i++];
                     break;
                 }
                 default: {
@@ -277,12 +325,11 @@ Parser parser_setup(SDL_Window* window) {
                     uint8_t r = args[i++];
                     uint8_t g = args[i++];
                     uint8_t b = args[i++];
-                    parserState.bgColor =
-                        glm::vec4(r / 255.0, g / 255.0, b / 255.0, 1);
+                    parserState.bgColor = colors::truecolor(r, g, b);
                     break;
                 }
                 case 5: {
-                    parserState.bgColor = colors::colors256[args[i++]];
+                    parserState.bgColor = (uint8_t)args[i++];
                     break;
                 }
                 default: {
@@ -321,6 +368,61 @@ Parser parser_setup(SDL_Window* window) {
                                TerminalBuf& termBuf, cursor_t& cursor) {
         SDL_SetWindowTitle(window, args[0].c_str());
     });
+    osc.addHandler(4, [&terminal](const std::vector<std::string> args,
+                                  TerminalBuf& termBuf, cursor_t& cursor) {
+        terminal.getPaletteMut([&args](Palette& palette) {
+            for (size_t i = 0; i + 1 < args.size(); i += 2) {
+                const auto index = parsePaletteIndex(args[i]);
+                const auto color = Palette::parseColorSpec(args[i + 1]);
+                if (!index.has_value() || !color.has_value()) {
+                    SPDLOG_WARN("Unsupported OSC 4 color {}='{}'", args[i],
+                                args[i + 1]);
+                    continue;
+                }
+                palette.set(index.value(), color.value());
+            }
+        });
+    });
+    osc.addHandler(10, [&terminal](const std::vector<std::string> args,
+                                   TerminalBuf& termBuf, cursor_t& cursor) {
+        setDynamicColors(args, colors::defaultFg, terminal);
+    });
+    osc.addHandler(11, [&terminal](const std::vector<std::string> args,
+                                   TerminalBuf& termBuf, cursor_t& cursor) {
+        setDynamicColors(args, colors::defaultBg, terminal);
+    });
+    osc.addHandler(12, [&terminal](const std::vector<std::string> args,
+                                   TerminalBuf& termBuf, cursor_t& cursor) {
+        setDynamicColors(args, colors::cursor, terminal);
+    });
+    osc.addHandler(104, [&terminal](const std::vector<std::string> args,
+                                    TerminalBuf& termBuf, cursor_t& cursor) {
+        terminal.getPaletteMut([&args](Palette& palette) {
+            // Without arguments the whole 256 color palette is reset
+            if (args.empty() || (args.size() == 1 && args[0].empty())) {
+                for (color_t i = 0; i < 256; i++) {
+                    palette.reset(i);
+                }
+                return;
+            }
+            for (const std::string& arg : args) {
+                const auto index = parsePaletteIndex(arg);
+                if (index.has_value()) {
+                    palette.reset(index.value());
+                }
+            }
+        });
+    });
+    for (color_t entry = colors::defaultFg; entry <= colors::cursor; entry++) {
+        // OSC 110, 111 and 112
+        const uint32_t ident = 110 + entry - colors::defaultFg;
+        osc.addHandler(ident, [&terminal,
+                               entry](const std::vector<std::string> args,
+                                      TerminalBuf& termBuf, cursor_t& cursor) {
+            terminal.getPaletteMut(
+                [entry](Palette& palette) { palette.reset(entry); });
+        });
+    }
 
     EscParser esc;
     esc.addHandler(
@@ -1,4 +1,5 @@
 #include "parser.hpp"
+#include "terminal.hpp"
 #include <SDL.h>
 
-Parser parser_setup(SDL_Window* window);
+Parser parser_setup(SDL_Window* window, Terminal& terminal);
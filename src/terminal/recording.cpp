@@ -0,0 +1,231 @@
+#include "recording.hpp"
+#include <algorithm>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+RecordingWriter::RecordingWriter(const std::filesystem::path& path,
+                                 uint16_t cols, uint16_t rows)
+    : m_File(path, std::ios::binary),
+      m_Start(std::chrono::steady_clock::now()), m_LastKeyframe(m_Start) {
+    if (!m_File) {
+        SPDLOG_WARN("Failed to open recording '{}'", path.c_str());
+        return;
+    }
+
+    recording::Header header = {.magic = {},
+                                .version = recording::VERSION,
+                                .cols = cols,
+                                .rows = rows};
+    std::memcpy(header.magic, recording::MAGIC, sizeof(recording::MAGIC));
+    m_File.write((const char*)&header, sizeof(recording::Header));
+    m_File.flush();
+    SPDLOG_INFO("Recording pty to '{}'", path.c_str());
+}
+
+RecordingWriter::~RecordingWriter() {
+    if (!isOpen()) {
+        return;
+    }
+    std::vector<uint8_t> data(m_Index.size() * sizeof(recording::IndexEntry));
+    std::memcpy(data.data(), m_Index.data(), data.size());
+    recording::IndexTrailer trailer = {
+        .indexOffset = (uint64_t)m_File.tellp(), .magic = {}};
+    std::memcpy(trailer.magic, recording::MAGIC, sizeof(recording::MAGIC));
+    data.insert(data.end(), (const uint8_t*)&trailer,
+                (const uint8_t*)&trailer + sizeof(recording::IndexTrailer));
+    writeRecord(recording::RecordType::Index, m_Time, data.data(),
+                data.size());
+    SPDLOG_DEBUG("Finished recording with {} keyframes", m_Index.size());
+}
+
+bool RecordingWriter::isOpen() const {
+    return m_File.is_open() && m_File.good();
+}
+
+void RecordingWriter::write(const std::vector<uint8_t>& data) {
+    if (!isOpen()) {
+        return;
+    }
+    m_Time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now() - m_Start)
+                 .count();
+    writeRecord(recording::RecordType::Data, m_Time, data.data(),
+                data.size());
+    m_BytesSinceKeyframe += data.size();
+}
+
+bool RecordingWriter::needsKeyframe() const {
+    // Keyframes grow with the scrollback, so there is at least as much output between two keyframes
+    // as the last one took, which keeps keyframes under half of the file
+    if (!isOpen() || m_BytesSinceKeyframe == 0 ||
+        m_BytesSinceKeyframe < m_LastKeyframeSize) {
+        return false;
+    }
+    return m_BytesSinceKeyframe >= recording::KEYFRAME_BYTES ||
+           std::chrono::steady_clock::now() - m_LastKeyframe >=
+               recording::KEYFRAME_INTERVAL;
+}
+
+void RecordingWriter::writeKeyframe(const std::vector<uint8_t>& data) {
+    if (!isOpen()) {
+        return;
+    }
+    const uint64_t offset = writeRecord(recording::RecordType::Keyframe,
+                                        m_Time, data.data(), data.size());
+    m_Index.push_back(recording::IndexEntry{.time = m_Time, .offset = offset});
+    m_LastKeyframe = std::chrono::steady_clock::now();
+    m_LastKeyframeSize = data.size();
+    m_BytesSinceKeyframe = 0;
+    SPDLOG_DEBUG("Recorded keyframe of {} bytes", data.size());
+}
+
+// PRIVATE
+uint64_t RecordingWriter::writeRecord(recording::RecordType type,
+                                      uint64_t time, const void* data,
+                                      size_t length) {
+    const uint64_t offset = m_File.tellp();
+    const recording::RecordHeader record = {
+        .type = type,
+        .reserved = {},
+        .length = (uint32_t)length,
+        .time = time,
+    };
+    m_File.write((const char*)&record, sizeof(recording::RecordHeader));
+    m_File.write((const char*)data, length);
+    m_File.flush();
+    return offset;
+}
+
+RecordingReader::RecordingReader(const std::filesystem::path& path)
+    : m_File(path, std::ios::binary) {
+    if (!m_File) {
+        SPDLOG_ERROR("Failed to open recording '{}'", path.c_str());
+        return;
+    }
+    if (!m_File.read((char*)&m_Header, sizeof(recording::Header)) ||
+        std::memcmp(m_Header.magic, recording::MAGIC,
+                    sizeof(recording::MAGIC)) != 0) {
+        SPDLOG_ERROR("'{}' isn't a recording", path.c_str());
+        return;
+    }
+    if (m_Header.version != recording::VERSION) {
+        SPDLOG_ERROR("Recording '{}' has version {}, expected {}",
+                     path.c_str(), m_Header.version, recording::VERSION);
+        return;
+    }
+    m_Open = true;
+    loadIndex();
+}
+
+bool RecordingReader::isOpen() const {
+    return m_Open;
+}
+
+bool RecordingReader::next(recording::Chunk& out) {
+    while (m_Open) {
+        recording::RecordHeader record;
+        if (!m_File.read((char*)&record, sizeof(recording::RecordHeader))) {
+            return false;
+        }
+        std::vector<uint8_t> data(record.length);
+        if (!m_File.read((char*)data.data(), data.size())) {
+            SPDLOG_WARN("Recording is truncated");
+            return false;
+        }
+        // Records of types added later are skipped
+        if (record.type != recording::RecordType::Data) {
+            continue;
+        }
+        out.time = std::chrono::nanoseconds(record.time);
+        out.data = std::move(data);
+        return true;
+    }
+    return false;
+}
+
+std::optional<recording::Keyframe>
+RecordingReader::seek(std::chrono::nanoseconds time) {
+    const auto it = std::upper_bound(
+        m_Index.begin(), m_Index.end(), (uint64_t)time.count(),
+        [](uint64_t target, const recording::IndexEntry& entry) {
+            return target < entry.time;
+        });
+    if (it != m_Index.begin()) {
+        const recording::IndexEntry& entry = *(it - 1);
+        recording::RecordHeader record;
+        m_File.clear();
+        m_File.seekg(entry.offset);
+        std::vector<uint8_t> data;
+        if (m_File.read((char*)&record, sizeof(recording::RecordHeader)) &&
+            record.type == recording::RecordType::Keyframe) {
+            data.resize(record.length);
+            m_File.read((char*)data.data(), data.size());
+        }
+        if (m_File) {
+            if (std::optional<Snapshot> snapshot =
+                    Snapshot::deserialize(data)) {
+                return recording::Keyframe{
+                    .time = std::chrono::nanoseconds(entry.time),
+                    .snapshot = std::move(snapshot.value()),
+                };
+            }
+        }
+        SPDLOG_WARN("Keyframe at offset {} is corrupted", entry.offset);
+    }
+
+    m_File.clear();
+    m_File.seekg(sizeof(recording::Header));
+    return std::nullopt;
+}
+
+uint16_t RecordingReader::getCols() const {
+    return m_Header.cols;
+}
+
+uint16_t RecordingReader::getRows() const {
+    return m_Header.rows;
+}
+
+// PRIVATE
+void RecordingReader::loadIndex() {
+    recording::IndexTrailer trailer;
+    m_File.seekg(-(std::streamoff)sizeof(recording::IndexTrailer),
+                 std::ios::end);
+    recording::RecordHeader record;
+    bool indexed =
+        m_File.read((char*)&trailer, sizeof(recording::IndexTrailer)) &&
+        std::memcmp(trailer.magic, recording::MAGIC,
+                    sizeof(recording::MAGIC)) == 0 &&
+        m_File.seekg(trailer.indexOffset) &&
+        m_File.read((char*)&record, sizeof(recording::RecordHeader)) &&
+        record.type == recording::RecordType::Index &&
+        record.length >= sizeof(recording::IndexTrailer);
+    if (indexed) {
+        m_Index.resize((record.length - sizeof(recording::IndexTrailer)) /
+                       sizeof(recording::IndexEntry));
+        indexed = (bool)m_File.read(
+            (char*)m_Index.data(),
+            m_Index.size() * sizeof(recording::IndexEntry));
+    }
+
+    if (!indexed) {
+        // Unfinished recording, the keyframes are found by skipping over the records
+        SPDLOG_WARN("Recording has no index, looking for keyframes");
+        m_Index.clear();
+        m_File.clear();
+        m_File.seekg(sizeof(recording::Header));
+        uint64_t offset = sizeof(recording::Header);
+        while (m_File.read((char*)&record, sizeof(recording::RecordHeader))) {
+            if (record.type == recording::RecordType::Keyframe) {
+                m_Index.push_back(recording::IndexEntry{.time = record.time,
+                                                        .offset = offset});
+            }
+            offset += sizeof(recording::RecordHeader) + record.length;
+            m_File.seekg(offset);
+        }
+    }
+    SPDLOG_DEBUG("Recording has {} keyframes", m_Index.size());
+
+    m_File.clear();
+    m_File.seekg(sizeof(recording::Header));
+}
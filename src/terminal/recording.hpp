@@ -0,0 +1,123 @@
+#pragma once
+
+#include "snapshot.hpp"
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <vector>
+
+/// Binary recording of a pty session: a header with the terminal size, followed by a record per chunk
+/// returned by Terminal::read, with the time since the recording started. Replaying the chunks with the same
+/// boundaries gives the parser exactly the input it had during the session.
+/// Keyframes with a snapshot of the terminal are written between the chunks, and their offsets are indexed at the end
+/// of the file, so that seeking only replays the chunks after the nearest keyframe.
+namespace recording {
+constexpr char MAGIC[8] = {'Y', 'A', 'T', 'E', 'R', 'E', 'C', '\0'};
+constexpr uint32_t VERSION = 1;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint16_t cols;
+    uint16_t rows;
+};
+
+enum class RecordType : uint8_t {
+    /// Bytes read from the pty
+    Data = 0,
+    /// Snapshot of the terminal after parsing the chunks before it, with the time of the last one
+    Keyframe = 1,
+    /// IndexEntry per keyframe, followed by an IndexTrailer. Missing if the recording wasn't finished.
+    Index = 2,
+};
+
+/// Followed by length bytes
+struct RecordHeader {
+    RecordType type;
+    uint8_t reserved[3];
+    uint32_t length;
+    /// Nanoseconds since the recording started
+    uint64_t time;
+};
+
+struct IndexEntry {
+    uint64_t time;
+    /// Of the keyframe's record header
+    uint64_t offset;
+};
+
+/// Last bytes of the file, so that the index can be found without reading the whole recording
+struct IndexTrailer {
+    /// Of the index's record header
+    uint64_t indexOffset;
+    char magic[8];
+};
+
+/// A keyframe is written once either of these is reached since the last one
+constexpr uint64_t KEYFRAME_BYTES = 4 << 20;
+constexpr std::chrono::seconds KEYFRAME_INTERVAL(30);
+
+struct Chunk {
+    std::chrono::nanoseconds time;
+    std::vector<uint8_t> data;
+};
+
+struct Keyframe {
+    std::chrono::nanoseconds time;
+    Snapshot snapshot;
+};
+} // namespace recording
+
+class RecordingWriter {
+public:
+    RecordingWriter(const std::filesystem::path& path, uint16_t cols,
+                    uint16_t rows);
+    /// Writes the index
+    ~RecordingWriter();
+
+    bool isOpen() const;
+    /// Flushed right away, so that a crash doesn't lose the chunks leading up to it
+    void write(const std::vector<uint8_t>& data);
+    bool needsKeyframe() const;
+    /// Takes a serialized snapshot, see Terminal::serialize
+    void writeKeyframe(const std::vector<uint8_t>& data);
+
+private:
+    /// Returns the offset of the record
+    uint64_t writeRecord(recording::RecordType type, uint64_t time,
+                         const void* data, size_t length);
+
+    std::ofstream m_File;
+    std::chrono::steady_clock::time_point m_Start;
+    /// Of the last chunk
+    uint64_t m_Time = 0;
+    std::vector<recording::IndexEntry> m_Index;
+    std::chrono::steady_clock::time_point m_LastKeyframe;
+    uint64_t m_LastKeyframeSize = 0;
+    uint64_t m_BytesSinceKeyframe = 0;
+};
+
+class RecordingReader {
+public:
+    explicit RecordingReader(const std::filesystem::path& path);
+
+    bool isOpen() const;
+    /// Returns false at the end of the recording
+    bool next(recording::Chunk& out);
+    /// Continues after the last keyframe at or before time and returns it.
+    /// Returns nothing and continues from the start if there is no such keyframe.
+    std::optional<recording::Keyframe> seek(std::chrono::nanoseconds time);
+    uint16_t getCols() const;
+    uint16_t getRows() const;
+
+private:
+    /// Reads the index, or looks for the keyframes if the recording has no index
+    void loadIndex();
+
+    std::ifstream m_File;
+    recording::Header m_Header = {};
+    bool m_Open = false;
+    std::vector<recording::IndexEntry> m_Index;
+};
@@ -0,0 +1,232 @@
+#include "snapshot.hpp"
+#include <cstring>
+
+namespace {
+/// Flags of the fields which a cell stores, the others are the same as in the previous cell of the row
+namespace cell_field {
+constexpr uint8_t BG_COLOR = 1 << 0;
+constexpr uint8_t FG_COLOR = 1 << 1;
+constexpr uint8_t STYLE = 1 << 2;
+constexpr uint8_t WIDTH = 1 << 3;
+constexpr uint8_t COMBINING = 1 << 4;
+/// Stored when the offset isn't the previous one + 1
+constexpr uint8_t OFFSET = 1 << 5;
+} // namespace cell_field
+
+void putBytes(std::vector<uint8_t>& out, const void* data, size_t size) {
+    out.insert(out.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+}
+
+/// LEB128, 7 bits per byte with the high bit set on all bytes but the last
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+void putFloat(std::vector<uint8_t>& out, float value) {
+    putBytes(out, &value, sizeof(float));
+}
+
+/// Reads from the serialized data, every read fails once the data ends
+class Input {
+public:
+    explicit Input(const std::vector<uint8_t>& data) : m_Data(data) {}
+
+    bool bytes(void* out, size_t size) {
+        if (m_Data.size() - m_Pos < size) {
+            return false;
+        }
+        std::memcpy(out, m_Data.data() + m_Pos, size);
+        m_Pos += size;
+        return true;
+    }
+
+    bool varint(uint64_t& out) {
+        out = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte;
+            if (!bytes(&byte, 1)) {
+                return false;
+            }
+            out |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename T> bool varint(T& out) {
+        uint64_t value;
+        if (!varint(value)) {
+            return false;
+        }
+        out = (T)value;
+        return true;
+    }
+
+    bool floating(float& out) {
+        return bytes(&out, sizeof(float));
+    }
+
+    bool atEnd() const {
+        return m_Pos == m_Data.size();
+    }
+
+private:
+    const std::vector<uint8_t>& m_Data;
+    size_t m_Pos = 0;
+};
+} // namespace
+
+// STATIC
+std::vector<uint8_t>
+Snapshot::serialize(const std::vector<std::vector<Cell>>& rows,
+                    const cursor_t& cursor, const ParserState& parserState,
+                    const std::vector<std::pair<color_t, glm::vec4>>& palette) {
+    std::vector<uint8_t> out;
+    putBytes(out, MAGIC, sizeof(MAGIC));
+    putBytes(out, &VERSION, sizeof(VERSION));
+
+    putFloat(out, cursor.x);
+    putFloat(out, cursor.y);
+
+    putVarint(out, parserState.bgColor);
+    putVarint(out, parserState.fgColor);
+    putVarint(out, parserState.inversed);
+    out.push_back(parserState.style);
+    putVarint(out, parserState.offset);
+    putFloat(out, parserState.savedCursorData.x);
+    putFloat(out, parserState.savedCursorData.y);
+
+    putVarint(out, palette.size());
+    for (const auto& [index, color] : palette) {
+        putVarint(out, index);
+        putBytes(out, &color, sizeof(glm::vec4));
+    }
+
+    putVarint(out, rows.size());
+    for (const std::vector<Cell>& row : rows) {
+        putVarint(out, row.size());
+        // Cells are compared in place, copying them would read their glyph slots, which the renderer writes
+        const Cell empty = Cell::empty();
+        const Cell* prev = &empty;
+        for (size_t x = 0; x < row.size(); x++) {
+            const Cell& cell = row[x];
+            const uint32_t offset = x == 0 ? 0 : prev->offset + 1;
+            const uint8_t fields =
+                (cell.bgColor != prev->bgColor ? cell_field::BG_COLOR : 0) |
+                (cell.fgColor != prev->fgColor ? cell_field::FG_COLOR : 0) |
+                (cell.style != prev->style ? cell_field::STYLE : 0) |
+                (cell.width != 1 ? cell_field::WIDTH : 0) |
+                (cell.combining != 0 ? cell_field::COMBINING : 0) |
+                (cell.offset != offset ? cell_field::OFFSET : 0);
+
+            out.push_back(fields);
+            putVarint(out, cell.character);
+            if (fields & cell_field::BG_COLOR) {
+                putVarint(out, cell.bgColor);
+            }
+            if (fields & cell_field::FG_COLOR) {
+                putVarint(out, cell.fgColor);
+            }
+            if (fields & cell_field::STYLE) {
+                out.push_back(cell.style);
+            }
+            if (fields & cell_field::WIDTH) {
+                out.push_back(cell.width);
+            }
+            if (fields & cell_field::COMBINING) {
+                putVarint(out, cell.combining);
+            }
+            if (fields & cell_field::OFFSET) {
+                putVarint(out, cell.offset);
+            }
+            prev = &cell;
+        }
+    }
+    return out;
+}
+
+std::optional<Snapshot>
+Snapshot::deserialize(const std::vector<uint8_t>& data) {
+    Input in(data);
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    if (!in.bytes(magic, sizeof(magic)) ||
+        std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !in.bytes(&version, sizeof(version)) || version != VERSION) {
+        return std::nullopt;
+    }
+
+    Snapshot snapshot;
+    ParserState& state = snapshot.parserState;
+    if (!in.floating(snapshot.cursor.x) || !in.floating(snapshot.cursor.y) ||
+        !in.varint(state.bgColor) || !in.varint(state.fgColor) ||
+        !in.varint(state.inversed) || !in.bytes(&state.style, 1) ||
+        !in.varint(state.offset) || !in.floating(state.savedCursorData.x) ||
+        !in.floating(state.savedCursorData.y)) {
+        return std::nullopt;
+    }
+
+    uint64_t paletteSize;
+    if (!in.varint(paletteSize)) {
+        return std::nullopt;
+    }
+    for (uint64_t i = 0; i < paletteSize; i++) {
+        color_t index;
+        glm::vec4 color;
+        if (!in.varint(index) || index >= colors::PALETTE_SIZE ||
+            !in.bytes(&color, sizeof(glm::vec4))) {
+            return std::nullopt;
+        }
+        snapshot.palette.emplace_back(index, color);
+    }
+
+    uint64_t rowCount;
+    if (!in.varint(rowCount)) {
+        return std::nullopt;
+    }
+    for (uint64_t y = 0; y < rowCount; y++) {
+        uint64_t cellCount;
+        if (!in.varint(cellCount)) {
+            return std::nullopt;
+        }
+        std::vector<Cell> row;
+        Cell prev = Cell::empty();
+        for (uint64_t x = 0; x < cellCount; x++) {
+            uint8_t fields;
+            Cell cell = {
+                .bgColor = prev.bgColor,
+                .fgColor = prev.fgColor,
+                .character = 0,
+                .glyphSlot = UINT32_MAX,
+                .offset = x == 0 ? 0 : prev.offset + 1,
+                .combining = 0,
+                .width = 1,
+                .style = prev.style,
+            };
+            if (!in.bytes(&fields, 1) || !in.varint(cell.character) ||
+                ((fields & cell_field::BG_COLOR) && !in.varint(cell.bgColor)) ||
+                ((fields & cell_field::FG_COLOR) && !in.varint(cell.fgColor)) ||
+                ((fields & cell_field::STYLE) && !in.bytes(&cell.style, 1)) ||
+                ((fields & cell_field::WIDTH) && !in.bytes(&cell.width, 1)) ||
+                ((fields & cell_field::COMBINING) &&
+                 !in.varint(cell.combining)) ||
+                ((fields & cell_field::OFFSET) && !in.varint(cell.offset))) {
+                return std::nullopt;
+            }
+            row.push_back(cell);
+            prev = cell;
+        }
+        snapshot.rows.push_back(std::move(row));
+    }
+
+    if (!in.atEnd()) {
+        return std::nullopt;
+    }
+    return snapshot;
+}
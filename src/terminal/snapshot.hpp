@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../rendering/colors.hpp"
+#include "terminal_buffer.hpp"
+#include "types.hpp"
+#include <cstdint>
+#include <glm/ext/vector_float4.hpp>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/// Everything the output which follows depends on: the buffer, the cursor, the parser state and the palette.
+/// Serialized into a compact binary format, so that it can be stored in recordings as keyframes or dumped on a crash.
+/// Integers are varints and cells only store the fields which differ from the previous cell, so a line of
+/// plain text takes about two bytes per cell. Glyph slots are renderer caches and aren't stored.
+struct Snapshot {
+    std::vector<std::vector<Cell>> rows;
+    cursor_t cursor;
+    ParserState parserState;
+    /// Only the colors which differ from the theme
+    std::vector<std::pair<color_t, glm::vec4>> palette;
+
+    /// Takes the parts instead of a snapshot, so that the buffer can be serialized under its lock without copying it.
+    /// Only reads the stored fields of cells, never their glyph slots.
+    static std::vector<uint8_t>
+    serialize(const std::vector<std::vector<Cell>>& rows,
+              const cursor_t& cursor, const ParserState& parserState,
+              const std::vector<std::pair<color_t, glm::vec4>>& palette);
+    /// Returns nothing if the data is truncated or of another version
+    static std::optional<Snapshot>
+    deserialize(const std::vector<uint8_t>& data);
+
+    constexpr static char MAGIC[8] = {'Y', 'A', 'T', 'E', 'S', 'N', 'A', 'P'};
+    /// Bumped on every change of the format
+    constexpr static uint32_t VERSION = 1;
+};
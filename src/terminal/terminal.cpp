@@ -6,11 +6,14 @@
 #include <pty.h>
 #endif
 
+#include "../stats.hpp"
+#include "../trace.hpp"
 #include "../utils.hpp"
 #include "terminal.hpp"
 #include "types.hpp"
 #include <atomic>
 #include <cerrno>
+#include <chrono>
 #include <csignal>
 #include <cstdlib>
 #include <cstring>
@@ -21,6 +24,7 @@
 #include <spdlog/spdlog.h>
 #include <string>
 #include <sys/ioctl.h>
+#include <thread>
 #include <unistd.h>
 
 #define FATAL_CHILD(...)                                                       \
@@ -29,9 +33,8 @@
 
 void Terminal::open(int windowWidth, int windowHeight) {
 
-    // TODO: Size based on window
     struct winsize winsize = {
-        .ws_row = 41, .ws_col = 120, .ws_xpixel = 0, .ws_ypixel = 0};
+        .ws_row = ROWS, .ws_col = COLS, .ws_xpixel = 0, .ws_ypixel = 0};
     if (openpty(&m_MasterFd, &m_SlaveFd, nullptr, nullptr, &winsize)) {
         FATAL("Failed to open pty: {}", strerror(errno));
     }
@@ -107,15 +110,67 @@ void Terminal::open(int windowWidth, int windowHeight) {
     SPDLOG_DEBUG("Opened pty");
 }
 
+void Terminal::openReplay(const std::filesystem::path& path, bool realTime,
+                          std::chrono::nanoseconds seek) {
+    m_Replay = std::make_unique<RecordingReader>(path);
+    if (!m_Replay->isOpen()) {
+        FATAL("Failed to replay '{}'", path.c_str());
+    }
+    if (m_Replay->getCols() != COLS || m_Replay->getRows() != ROWS) {
+        SPDLOG_WARN("Recording is {}x{}, replaying it at {}x{}",
+                    m_Replay->getCols(), m_Replay->getRows(), COLS, ROWS);
+    }
+    if (seek > std::chrono::nanoseconds::zero()) {
+        if (std::optional<recording::Keyframe> keyframe =
+                m_Replay->seek(seek)) {
+            restore(keyframe->snapshot);
+            m_RestoredParserState = keyframe->snapshot.parserState;
+            SPDLOG_INFO("Restored keyframe at {:.1f} s",
+                        std::chrono::duration<double>(keyframe->time).count());
+        } else {
+            SPDLOG_WARN("No keyframe before {:.1f} s, replaying from the start",
+                        std::chrono::duration<double>(seek).count());
+        }
+    }
+    m_ReplayRealTime = realTime;
+    // Chunks before the seek time are already due
+    m_ReplayStart = std::chrono::steady_clock::now() - seek;
+    SPDLOG_INFO("Replaying '{}' {}", path.c_str(),
+                realTime ? "in real time" : "as fast as possible");
+}
+
+void Terminal::record(const std::filesystem::path& path) {
+    m_Recording = std::make_unique<RecordingWriter>(path, COLS, ROWS);
+}
+
+void Terminal::recordKeyframe(const ParserState& parserState) {
+    if (m_Recording != nullptr && m_Recording->needsKeyframe()) {
+        Trace::Span span("Terminal::recordKeyframe");
+        m_Recording->writeKeyframe(serialize(parserState));
+    }
+}
+
+std::optional<ParserState> Terminal::getRestoredParserState() const {
+    return m_RestoredParserState;
+}
+
 void Terminal::close() {
     m_ShouldClose.store(true, std::memory_order_relaxed);
+    m_ShouldClose.notify_all();
+    if (m_Replay != nullptr) {
+        return;
+    }
     ::close(m_MasterFd);
     ::close(m_SlaveFd);
     kill(m_TermProcessPid, SIGKILL);
     SPDLOG_DEBUG("Closed pty");
 }
 
-std::vector<uint8_t> Terminal::read() const {
+std::vector<uint8_t> Terminal::read() {
+    Trace::Span span("Terminal::read");
+    if (m_Replay != nullptr) {
+        return readReplay();
+    }
     constexpr size_t CHUNK_SIZE = 1024;
     std::vector<uint8_t> buffer;
     std::vector<uint8_t> tempBuf(CHUNK_SIZE);
@@ -143,10 +198,16 @@ std::vector<uint8_t> Terminal::read() const {
         }
     }
 
+    if (m_Recording != nullptr) {
+        m_Recording->write(buffer);
+    }
     return buffer;
 }
 
 void Terminal::write(std::vector<uint8_t>&& bytes) {
+    if (m_Replay != nullptr) {
+        return;
+    }
     ::write(m_MasterFd, bytes.data(), bytes.size());
     SPDLOG_TRACE("Written to terminal:");
     hexdump(bytes.data(), bytes.size(), SPDLOG_LEVEL_TRACE);
@@ -157,21 +218,114 @@ bool Terminal::shouldClose() const {
 }
 
 void Terminal::getBuf(std::function<void(const TerminalBuf&)> cb) const {
+    const auto start = std::chrono::steady_clock::now();
     std::shared_lock lock(m_BufMutex);
+    Stats::addSince(Counter::LockWaitNs, start);
     cb(m_Buf);
 }
 
 void Terminal::getBufMut(std::function<void(TerminalBuf&)> cb) {
+    const auto start = std::chrono::steady_clock::now();
     std::unique_lock lock(m_BufMutex);
+    Stats::addSince(Counter::LockWaitNs, start);
     cb(m_Buf);
 }
 
 cursor_t Terminal::getCursor() const {
+    const auto start = std::chrono::steady_clock::now();
     std::shared_lock lock(m_CursorMutex);
+    Stats::addSince(Counter::LockWaitNs, start);
     return m_Cursor;
 }
 
 void Terminal::getCursorMut(std::function<void(cursor_t&)> cb) {
+    const auto start = std::chrono::steady_clock::now();
     std::unique_lock lock(m_CursorMutex);
+    Stats::addSince(Counter::LockWaitNs, start);
     cb(m_Cursor);
 }
+
+void Terminal::getPalette(std::function<void(const Palette&)> cb) const {
+    const auto start = std::chrono::steady_clock::now();
+    std::shared_lock lock(m_PaletteMutex);
+    Stats::addSince(Counter::LockWaitNs, start);
+    cb(m_Palette);
+}
+
+void Terminal::getPaletteMut(std::function<void(Palette&)> cb) {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock lock(m_PaletteMutex);
+    Stats::addSince(Counter::LockWaitNs, start);
+    cb(m_Palette);
+}
+
+std::vector<uint8_t>
+Terminal::serialize(const ParserState& parserState) const {
+    std::vector<std::pair<color_t, glm::vec4>> changedColors;
+    getPalette([&changedColors](const Palette& palette) {
+        for (color_t i = 0; i < colors::PALETTE_SIZE; i++) {
+            if (palette.get(i) != Palette::getThemeColor(i)) {
+                changedColors.emplace_back(i, palette.get(i));
+            }
+        }
+    });
+    const cursor_t cursor = getCursor();
+    std::vector<uint8_t> data;
+    // Not copied, the renderer writes glyph slots of the cells under its own shared lock
+    getBuf([&](const TerminalBuf& termBuf) {
+        data = Snapshot::serialize(termBuf.getRows(), cursor, parserState,
+                                   changedColors);
+    });
+    return data;
+}
+
+void Terminal::restore(const Snapshot& snapshot) {
+    getBufMut([&snapshot](TerminalBuf& termBuf) {
+        // Rows are pushed instead of replacing the buffer, so that they get new versions
+        termBuf.deleteRows(0, termBuf.getRows().size());
+        for (std::vector<Cell> row : snapshot.rows) {
+            termBuf.pushRow(std::move(row));
+        }
+    });
+    getCursorMut([&snapshot](cursor_t& cursor) { cursor = snapshot.cursor; });
+    getPaletteMut([&snapshot](Palette& palette) {
+        for (color_t i = 0; i < colors::PALETTE_SIZE; i++) {
+            palette.reset(i);
+        }
+        for (const auto& [index, color] : snapshot.palette) {
+            palette.set(index, color);
+        }
+    });
+}
+
+// PRIVATE
+std::vector<uint8_t> Terminal::readReplay() {
+    recording::Chunk chunk;
+    if (!m_Replay->next(chunk)) {
+        if (m_ReplayedChunks > 0) {
+            SPDLOG_INFO(
+                "Replayed {} chunks ({} bytes) in {:.1f} ms", m_ReplayedChunks,
+                m_ReplayedBytes,
+                std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - m_ReplayStart)
+                    .count());
+            m_ReplayedChunks = 0;
+        }
+        // Keeps showing the last frame until the window is closed
+        m_ShouldClose.wait(false);
+        return {};
+    }
+
+    if (m_ReplayRealTime) {
+        const auto due = m_ReplayStart + chunk.time;
+        // Short sleeps, so that closing the window doesn't wait for a long pause in the recording
+        while (!shouldClose() && std::chrono::steady_clock::now() < due) {
+            std::this_thread::sleep_until(
+                std::min(due, std::chrono::steady_clock::now() +
+                                  std::chrono::milliseconds(50)));
+        }
+    }
+    m_ReplayedChunks++;
+    m_ReplayedBytes += chunk.data.size();
+    return std::move(chunk.data);
+}
@@ -1,12 +1,19 @@
 #pragma once
 
+#include "palette.hpp"
+#include "recording.hpp"
+#include "snapshot.hpp"
 #include "terminal_buffer.hpp"
 #include "types.hpp"
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <exception>
+#include <filesystem>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <shared_mutex>
 #include <string>
 #include <vector>
@@ -14,9 +21,20 @@
 class Terminal {
 public:
     void open(int windowWidth, int windowHeight);
+    /// Reads chunks from a recording instead of a shell, input is discarded. Without realTime, chunks are read
+    /// as fast as the parser takes them. Once the recording ends, read blocks until the terminal is closed.
+    /// Seeking restores the last keyframe before the time, the chunks between them are read without waiting.
+    void openReplay(const std::filesystem::path& path, bool realTime,
+                    std::chrono::nanoseconds seek = {});
+    /// Writes every chunk read from the shell to a recording
+    void record(const std::filesystem::path& path);
+    /// Writes a keyframe to the recording if one is due, called after parsing each chunk
+    void recordKeyframe(const ParserState& parserState);
+    /// Parser state of the keyframe which the replay started from, has to be set on the parser before the first read
+    std::optional<ParserState> getRestoredParserState() const;
     void close();
     bool shouldClose() const;
-    std::vector<uint8_t> read() const;
+    std::vector<uint8_t> read();
     void write(std::vector<uint8_t>&& bytes);
 
     void getBuf(std::function<void(const TerminalBuf&)> cb) const;
@@ -25,18 +43,41 @@ public:
     cursor_t getCursor() const;
     void getCursorMut(std::function<void(cursor_t&)> cb);
 
+    void getPalette(std::function<void(const Palette&)> cb) const;
+    void getPaletteMut(std::function<void(Palette&)> cb);
+
+    /// Snapshot of the buffer, cursor, palette and the parser state, serialized under the buffer's lock
+    std::vector<uint8_t> serialize(const ParserState& parserState) const;
+    /// Replaces the buffer, cursor and palette, the parser state has to be restored separately
+    void restore(const Snapshot& snapshot);
+
+    // TODO: Size based on window
+    constexpr static uint16_t COLS = 120;
+    constexpr static uint16_t ROWS = 41;
+
 private:
+    std::vector<uint8_t> readReplay();
+
     // These are set on open() and not changed later, so they don't need to be thread-safe
-    int m_MasterFd;
-    int m_SlaveFd;
-    pid_t m_TermProcessPid;
+    int m_MasterFd = -1;
+    int m_SlaveFd = -1;
+    pid_t m_TermProcessPid = -1;
     std::string m_PtyPath;
+    std::unique_ptr<RecordingWriter> m_Recording;
+    std::unique_ptr<RecordingReader> m_Replay;
+    bool m_ReplayRealTime = false;
+    std::chrono::steady_clock::time_point m_ReplayStart;
+    size_t m_ReplayedBytes = 0;
+    size_t m_ReplayedChunks = 0;
+    std::optional<ParserState> m_RestoredParserState;
 
     std::atomic<bool> m_ShouldClose;
     TerminalBuf m_Buf;
     mutable std::shared_mutex m_BufMutex;
     cursor_t m_Cursor;
     mutable std::shared_mutex m_CursorMutex;
+    Palette m_Palette;
+    mutable std::shared_mutex m_PaletteMutex;
 };
 
 class TerminalReadException : std::exception {
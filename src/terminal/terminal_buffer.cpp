@@ -7,10 +7,12 @@ Cell Cell::empty() {
 
 // TerminalBuf
 Cell& TerminalBuf::getCell(size_t col, size_t row) {
+    m_RowVersions[row] = m_NextVersion++;
     return m_Buf[row][col];
 }
 
 std::vector<Cell>& TerminalBuf::getRow(size_t row) {
+    m_RowVersions[row] = m_NextVersion++;
     return m_Buf[row];
 }
 
@@ -18,15 +20,23 @@ const std::vector<std::vector<Cell>>& TerminalBuf::getRows() const {
     return m_Buf;
 }
 
+uint64_t TerminalBuf::getRowVersion(size_t row) const {
+    return m_RowVersions[row];
+}
+
 void TerminalBuf::pushRow(const std::vector<Cell>&& cells) {
     m_Buf.push_back(std::move(cells));
+    m_RowVersions.push_back(m_NextVersion++);
 }
 
 void TerminalBuf::deleteRow(size_t row) {
     m_Buf.erase(m_Buf.begin() + row);
+    m_RowVersions.erase(m_RowVersions.begin() + row);
 }
 void TerminalBuf::deleteRows(size_t row, size_t end) {
     if (row < end) {
         m_Buf.erase(m_Buf.begin() + row, m_Buf.begin() + end);
+        m_RowVersions.erase(m_RowVersions.begin() + row,
+                            m_RowVersions.begin() + end);
     }
 }
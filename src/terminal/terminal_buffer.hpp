@@ -1,15 +1,25 @@
 #pragma once
 
+#include "../rendering/colors.hpp"
 #include "unicode.hpp"
-#include <glm/ext/vector_float4.hpp>
+#include <cstdint>
 #include <vector>
 
 struct Cell {
-    glm::vec4 bgColor;
-    glm::vec4 fgColor;
+    color_t bgColor = colors::defaultBg;
+    color_t fgColor = colors::defaultFg;
     codepoint_t character;
+    /// Glyph slot of the character in the font, cached by the renderer (under the buffer lock).
+    /// Checked against the slot's codepoint before use, because slots are reused after eviction.
+    mutable uint32_t glyphSlot = UINT32_MAX;
     /// Offset since start of line
-    size_t offset = 0;
+    uint32_t offset = 0;
+    /// First combining mark of the grapheme cluster, 0 if there is none. Other extenders aren't kept.
+    codepoint_t combining = 0;
+    /// 2 for a wide character, 0 for the cell after it, which continues the wide character
+    uint8_t width = 1;
+    /// cell_style flags
+    uint8_t style = cell_style::REGULAR;
 
     static Cell empty();
 };
@@ -20,6 +30,8 @@ public:
     Cell& getCell(size_t col, size_t row);
     std::vector<Cell>& getRow(size_t row);
     const std::vector<std::vector<Cell>>& getRows() const;
+    /// Changes every time the row is accessed mutably or moves to a different index
+    uint64_t getRowVersion(size_t row) const;
 
     void pushRow(const std::vector<Cell>&& cells);
     void deleteRow(size_t row);
@@ -27,6 +39,9 @@ public:
 
 private:
     std::vector<std::vector<Cell>> m_Buf;
+    /// Versions are unique across all rows, so a row shifted into another index never matches a cached version
+    std::vector<uint64_t> m_RowVersions;
+    uint64_t m_NextVersion = 0;
     size_t m_Width;
     size_t m_AddedCount;
 };
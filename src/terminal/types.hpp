@@ -10,10 +10,20 @@
 using iter_t = std::vector<uint8_t>::iterator;
 using cursor_t = glm::vec2;
 
+/// Font face of a cell, bit flags which double as the index of the face
+namespace cell_style {
+constexpr uint8_t REGULAR = 0;
+constexpr uint8_t BOLD = 1 << 0;
+constexpr uint8_t ITALIC = 1 << 1;
+/// Regular, bold, italic and bold italic
+constexpr uint8_t COUNT = 4;
+} // namespace cell_style
+
 struct ParserState {
-    glm::vec4 bgColor = colors::defaultBg;
-    glm::vec4 fgColor = colors::defaultFg;
+    color_t bgColor = colors::defaultBg;
+    color_t fgColor = colors::defaultFg;
     bool inversed = false;
-    size_t offset = 0;
+    uint8_t style = cell_style::REGULAR;
+    uint32_t offset = 0;
     cursor_t savedCursorData;
 };
@@ -1,6 +1,7 @@
 #include "unicode.hpp"
 #include "../rendering/font.hpp"
 #include "types.hpp"
+#include "unicode_tables.hpp"
 #include <spdlog/spdlog.h>
 
 namespace utf8 {
@@ -157,3 +158,97 @@ codepoint_t decode(iter_t& it, iter_t end) {
     return codepoint;
 }
 } // namespace utf8
+
+namespace unicode {
+/// Packed properties from the generated tables, two array lookups
+static uint8_t getProperties(codepoint_t codepoint) {
+    if (codepoint >= tables::STAGE1.size() << tables::BLOCK_SHIFT) {
+        return 1 << tables::WIDTH_SHIFT;
+    }
+    return tables::STAGE2[tables::STAGE1[codepoint >> tables::BLOCK_SHIFT]]
+                         [codepoint & tables::BLOCK_MASK];
+}
+
+uint8_t getWidth(codepoint_t codepoint) {
+    return getProperties(codepoint) >> tables::WIDTH_SHIFT;
+}
+
+GraphemeBreak getGraphemeBreak(codepoint_t codepoint) {
+    return static_cast<GraphemeBreak>(getProperties(codepoint) &
+                                      tables::GRAPHEME_BREAK_MASK);
+}
+
+bool isExtendedPictographic(codepoint_t codepoint) {
+    return getProperties(codepoint) & tables::PICTOGRAPHIC_BIT;
+}
+
+bool isCombiningMark(codepoint_t codepoint) {
+    const bool variationSelector =
+        (codepoint >= 0xfe00 && codepoint <= 0xfe0f) ||
+        (codepoint >= 0xe0100 && codepoint <= 0xe01ef);
+    const bool tag = codepoint >= 0xe0000 && codepoint <= 0xe007f;
+    return getGraphemeBreak(codepoint) == GraphemeBreak::Extend &&
+           getWidth(codepoint) == 0 && !variationSelector && !tag;
+}
+
+bool GraphemeBreaker::isBreak(codepoint_t codepoint) {
+    const GraphemeBreak next = getGraphemeBreak(codepoint);
+    const bool pictographic = isExtendedPictographic(codepoint);
+    const bool boundary =
+        !m_Started || isBreakBetween(m_Prev, next, pictographic);
+
+    if (next == GraphemeBreak::RegionalIndicator) {
+        m_OddRegionalIndicators = boundary || !m_OddRegionalIndicators;
+    } else {
+        m_OddRegionalIndicators = false;
+    }
+    m_PictographicZwj = m_InPictographic && next == GraphemeBreak::ZWJ;
+    m_InPictographic =
+        pictographic || (m_InPictographic && next == GraphemeBreak::Extend);
+    m_Prev = next;
+    m_Started = true;
+    return boundary;
+}
+
+void GraphemeBreaker::reset() {
+    *this = GraphemeBreaker();
+}
+
+// PRIVATE
+bool GraphemeBreaker::isBreakBetween(GraphemeBreak prev, GraphemeBreak next,
+                                     bool nextPictographic) const {
+    using enum GraphemeBreak;
+
+    // GB4, GB5
+    if (prev == CR || prev == LF || prev == Control || next == CR ||
+        next == LF || next == Control) {
+        return true;
+    }
+    // GB6, GB7, GB8
+    if (prev == L && (next == L || next == V || next == LV || next == LVT)) {
+        return false;
+    }
+    if ((prev == LV || prev == V) && (next == V || next == T)) {
+        return false;
+    }
+    if ((prev == LVT || prev == T) && next == T) {
+        return false;
+    }
+    // GB9, GB9a, GB9b
+    if (next == Extend || next == ZWJ || next == SpacingMark ||
+        prev == Prepend) {
+        return false;
+    }
+    // GB11
+    if (m_PictographicZwj && nextPictographic) {
+        return false;
+    }
+    // GB12, GB13
+    if (prev == RegionalIndicator && next == RegionalIndicator &&
+        m_OddRegionalIndicators) {
+        return false;
+    }
+    // GB999
+    return true;
+}
+} // namespace unicode
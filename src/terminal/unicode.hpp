@@ -11,3 +11,55 @@ std::vector<uint8_t> encode(codepoint_t codepoint);
 codepoint_t decode(std::vector<uint8_t>& encoded);
 codepoint_t decode(iter_t& it, iter_t end);
 } // namespace utf8
+
+namespace unicode {
+/// Grapheme_Cluster_Break property values, in the order of the generated tables
+enum class GraphemeBreak : uint8_t {
+    Other,
+    CR,
+    LF,
+    Control,
+    Extend,
+    ZWJ,
+    RegionalIndicator,
+    Prepend,
+    SpacingMark,
+    L,
+    V,
+    T,
+    LV,
+    LVT,
+};
+
+/// Cells taken by the codepoint: 0 for combining marks and format characters, 2 for East Asian wide and fullwidth
+uint8_t getWidth(codepoint_t codepoint);
+GraphemeBreak getGraphemeBreak(codepoint_t codepoint);
+bool isExtendedPictographic(codepoint_t codepoint);
+/// Zero width mark drawn on top of the previous character. Variation selectors and tags extend clusters too,
+/// but have nothing to draw.
+bool isCombiningMark(codepoint_t codepoint);
+
+/// Finds grapheme cluster boundaries (UAX #29) in a stream of codepoints. Only the rules which matter
+/// for a terminal are implemented: control characters, Hangul syllables, extenders, spacing marks, prepend,
+/// emoji ZWJ sequences and regional indicator pairs.
+class GraphemeBreaker {
+public:
+    /// Returns whether a new cluster starts at the codepoint
+    bool isBreak(codepoint_t codepoint);
+    /// The next codepoint starts a new cluster
+    void reset();
+
+private:
+    bool isBreakBetween(GraphemeBreak prev, GraphemeBreak next,
+                        bool nextPictographic) const;
+
+    bool m_Started = false;
+    GraphemeBreak m_Prev = GraphemeBreak::Other;
+    /// Inside Extended_Pictographic Extend*
+    bool m_InPictographic = false;
+    /// The previous codepoint is a ZWJ after Extended_Pictographic Extend*
+    bool m_PictographicZwj = false;
+    /// Odd number of regional indicators before the codepoint
+    bool m_OddRegionalIndicators = false;
+};
+} // namespace unicode
@@ -0,0 +1,248 @@
+#include "trace.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/// Written only by its thread, read by the thread writing the trace
+struct Trace::ThreadBuffer {
+    std::array<Event, CAPACITY> events;
+    /// Events ever written, the next one goes to count % CAPACITY
+    std::atomic<uint64_t> count = 0;
+    uint32_t tid;
+    const char* name;
+    std::atomic<bool> finished = false;
+};
+
+namespace {
+struct ThreadState {
+    std::shared_ptr<Trace::ThreadBuffer> buffer;
+    const char* name = "thread";
+
+    ~ThreadState() {
+        // Events of finished threads are still written, the buffer is dropped afterwards
+        if (buffer != nullptr) {
+            buffer->finished.store(true, std::memory_order_release);
+        }
+    }
+};
+} // namespace
+
+static thread_local ThreadState threadState;
+static std::atomic<bool> recording = false;
+static std::atomic<uint64_t> recordingStart = 0;
+static std::mutex buffersMutex;
+static std::vector<std::shared_ptr<Trace::ThreadBuffer>> buffers;
+static uint32_t nextTid = 1;
+static std::optional<std::filesystem::path> envPath = std::nullopt;
+static uint32_t traceCount = 0;
+static const auto epoch = std::chrono::steady_clock::now();
+
+Trace::Span::Span(const char* name, std::string_view detail)
+    : m_Name(name), m_Recording(isRecording()) {
+    if (!m_Recording) {
+        return;
+    }
+    std::memcpy(m_Detail, detail.data(),
+                std::min(detail.size(), sizeof(m_Detail) - 1));
+    m_Start = now();
+}
+
+Trace::Span::~Span() {
+    if (!m_Recording) {
+        return;
+    }
+    Event event = {.name = m_Name,
+                   .start = m_Start,
+                   .value = (int64_t)(now() - m_Start),
+                   .detail = {},
+                   .type = EventType::Span};
+    std::memcpy(event.detail, m_Detail, sizeof(m_Detail));
+    record(event);
+}
+
+void Trace::counter(const char* name, int64_t value) {
+    if (!isRecording()) {
+        return;
+    }
+    record(Event{.name = name,
+                 .start = now(),
+                 .value = value,
+                 .detail = {},
+                 .type = EventType::Counter});
+}
+
+void Trace::setThreadName(const char* name) {
+    threadState.name = name;
+    if (threadState.buffer != nullptr) {
+        threadState.buffer->name = name;
+    }
+}
+
+bool Trace::isRecording() {
+    return recording.load(std::memory_order_relaxed);
+}
+
+void Trace::init() {
+    if (const char* env = std::getenv("YATE_TRACE");
+        env != nullptr && env[0] != '\0') {
+        envPath = env;
+        start();
+    }
+}
+
+void Trace::finish() {
+    if (!isRecording()) {
+        return;
+    }
+    if (const std::optional<std::filesystem::path> path = getPath()) {
+        write(path.value());
+    }
+}
+
+void Trace::toggle() {
+    if (!isRecording()) {
+        start();
+        return;
+    }
+    if (const std::optional<std::filesystem::path> path = getPath()) {
+        write(path.value());
+    } else {
+        recording.store(false, std::memory_order_relaxed);
+    }
+}
+
+// PRIVATE
+void Trace::start() {
+    recordingStart.store(now(), std::memory_order_relaxed);
+    recording.store(true, std::memory_order_relaxed);
+    SPDLOG_INFO("Started recording a trace");
+}
+
+bool Trace::write(const std::filesystem::path& path) {
+    recording.store(false, std::memory_order_relaxed);
+    const uint64_t startNs = recordingStart.load(std::memory_order_relaxed);
+
+    std::ofstream file(path);
+    if (!file) {
+        SPDLOG_WARN("Failed to write trace '{}'", path.c_str());
+        return false;
+    }
+    const pid_t pid = getpid();
+    const auto escape = [](const char* str) {
+        std::string out;
+        for (const char* c = str; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\') {
+                out += '\\';
+            }
+            out += *c;
+        }
+        return out;
+    };
+
+    std::lock_guard lock(buffersMutex);
+    size_t written = 0;
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+        file << fmt::format(
+            "{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},"
+            "\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+            written == 0 ? "" : ",", pid, buffer->tid, escape(buffer->name));
+        written++;
+
+        // Threads may still be writing, events overwritten while they were copied are dropped
+        const uint64_t before = buffer->count.load(std::memory_order_acquire);
+        const uint64_t first = before > CAPACITY ? before - CAPACITY : 0;
+        std::vector<Event> events;
+        events.reserve(before - first);
+        for (uint64_t i = first; i < before; i++) {
+            events.push_back(buffer->events[i % CAPACITY]);
+        }
+        const uint64_t after = buffer->count.load(std::memory_order_acquire);
+        const uint64_t valid = after >= CAPACITY ? after - CAPACITY + 1 : 0;
+
+        for (uint64_t i = std::max(first, valid); i < before; i++) {
+            const Event& event = events[i - first];
+            if (event.start < startNs) {
+                continue;
+            }
+            const std::string name =
+                event.detail[0] == '\0'
+                    ? escape(event.name)
+                    : escape(event.name) + " " + escape(event.detail);
+            if (event.type == EventType::Span) {
+                file << fmt::format(
+                    ",{{\"name\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},"
+                    "\"dur\":{:.3f},\"pid\":{},\"tid\":{}}}",
+                    name, event.start / 1000.0, event.value / 1000.0, pid,
+                    buffer->tid);
+            } else {
+                file << fmt::format(
+                    ",{{\"name\":\"{}\",\"ph\":\"C\",\"ts\":{:.3f},"
+                    "\"pid\":{},\"tid\":{},\"args\":{{\"value\":{}}}}}",
+                    name, event.start / 1000.0, pid, buffer->tid,
+                    event.value);
+            }
+            written++;
+        }
+    }
+    file << "]}\n";
+    file.close();
+
+    // Every event of finished threads has been written
+    std::erase_if(buffers, [](const std::shared_ptr<ThreadBuffer>& buffer) {
+        return buffer->finished.load(std::memory_order_acquire);
+    });
+    SPDLOG_INFO("Wrote trace with {} events to '{}'", written, path.c_str());
+    return true;
+}
+
+void Trace::record(const Event& event) {
+    ThreadBuffer& buffer = getBuffer();
+    const uint64_t i = buffer.count.load(std::memory_order_relaxed);
+    buffer.events[i % CAPACITY] = event;
+    buffer.count.store(i + 1, std::memory_order_release);
+}
+
+Trace::ThreadBuffer& Trace::getBuffer() {
+    if (threadState.buffer == nullptr) {
+        // Only allocated once a thread records something
+        threadState.buffer = std::make_shared<ThreadBuffer>();
+        threadState.buffer->name = threadState.name;
+        std::lock_guard lock(buffersMutex);
+        threadState.buffer->tid = nextTid++;
+        buffers.push_back(threadState.buffer);
+    }
+    return *threadState.buffer;
+}
+
+uint64_t Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - epoch)
+        .count();
+}
+
+std::optional<std::filesystem::path> Trace::getPath() {
+    if (envPath.has_value()) {
+        return envPath;
+    }
+    const std::optional<std::filesystem::path> dir = getCacheDir();
+    if (!dir.has_value()) {
+        SPDLOG_WARN("No cache directory and YATE_TRACE isn't set, trace "
+                    "can't be written");
+        return std::nullopt;
+    }
+    return dir.value() /
+           fmt::format("trace-{}-{}.json", getpid(), traceCount++);
+}
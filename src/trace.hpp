@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+/// Timeline of spans and counters across threads, written as Chrome trace JSON (opened by chrome://tracing and Perfetto).
+/// Recording starts with F11 or when YATE_TRACE is set, and is written when F11 is pressed again or on exit.
+/// Each thread writes into its own ring buffer without locking, only the last CAPACITY events of a thread are kept.
+/// Nothing is recorded when tracing is off, a span is then a single relaxed atomic load.
+class Trace {
+public:
+    /// Events of one thread, defined in trace.cpp
+    struct ThreadBuffer;
+
+    class Span {
+    public:
+        /// The name has to outlive the trace (a string literal), the detail is copied and cut to 7 characters
+        explicit Span(const char* name, std::string_view detail = {});
+        ~Span();
+
+    private:
+        const char* m_Name;
+        char m_Detail[8] = {};
+        uint64_t m_Start = 0;
+        bool m_Recording;
+    };
+
+    static void counter(const char* name, int64_t value);
+    /// Shown as the name of the calling thread, the name has to outlive the trace
+    static void setThreadName(const char* name);
+    static bool isRecording();
+
+    /// Starts recording when YATE_TRACE is set
+    static void init();
+    /// Writes the trace if recording
+    static void finish();
+    /// Starts recording, or writes the trace and stops recording
+    static void toggle();
+
+    constexpr static size_t CAPACITY = 1 << 14;
+
+private:
+    enum class EventType : uint8_t {
+        Span,
+        Counter,
+    };
+    struct Event {
+        const char* name;
+        /// Nanoseconds since the process started
+        uint64_t start;
+        /// Duration in nanoseconds, or value of a counter
+        int64_t value;
+        char detail[8];
+        EventType type;
+    };
+
+    static void start();
+    /// Stops recording and writes the events recorded since start
+    static bool write(const std::filesystem::path& path);
+    static void record(const Event& event);
+    static ThreadBuffer& getBuffer();
+    static uint64_t now();
+    /// YATE_TRACE, or a new file in the cache directory
+    static std::optional<std::filesystem::path> getPath();
+};
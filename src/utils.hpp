@@ -2,6 +2,8 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <filesystem>
+#include <optional>
 #include <spdlog/common.h>
 #include <spdlog/spdlog.h>
 #include <string>
@@ -47,6 +49,40 @@ void hexdump(T* ptr, size_t len, int minLogLevel = SPDLOG_LEVEL_DEBUG) {
     }
 }
 
+/// $XDG_CACHE_HOME/yate or ~/.cache/yate, created if it doesn't exist
+inline std::optional<std::filesystem::path> getCacheDir() {
+    std::filesystem::path dir;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME");
+        xdg != nullptr && xdg[0] != '\0') {
+        dir = xdg;
+    } else if (const char* home = std::getenv("HOME"); home != nullptr) {
+        dir = std::filesystem::path(home) / ".cache";
+    } else {
+        return std::nullopt;
+    }
+    dir /= "yate";
+
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (error) {
+        return std::nullopt;
+    }
+    return dir;
+}
+
+/// Modification time and size of a file, zero if it doesn't exist. Cheap enough to check on every start.
+inline void getFileStamp(const std::filesystem::path& path, int64_t& mtime,
+                         uint64_t& size) {
+    std::error_code error;
+    mtime = std::filesystem::last_write_time(path, error)
+                .time_since_epoch()
+                .count();
+    size = std::filesystem::file_size(path, error);
+    if (error) {
+        size = 0;
+    }
+}
+
 // https://stackoverflow.com/a/19195373/9854703
 template <class T>
 inline void hashCombine(std::size_t& s, const T& v) {
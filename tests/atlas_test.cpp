@@ -0,0 +1,63 @@
+#include "../src/rendering/atlas.hpp"
+#include "../src/rendering/row_pages.hpp"
+#include "check.hpp"
+#include <optional>
+#include <vector>
+
+// Packing and eviction don't use GL, only uploading does, so no context is needed
+int main() {
+    Atlas atlas;
+    atlas.setBudget(4 * Atlas::PAGE_SIZE * Atlas::PAGE_SIZE);
+
+    // A rect of a whole page fills it, so each rect gets its own page
+    std::vector<stbrp_rect> rects(
+        4, stbrp_rect{.id = 0,
+                      .w = Atlas::PAGE_SIZE,
+                      .h = Atlas::PAGE_SIZE,
+                      .x = 0,
+                      .y = 0,
+                      .was_packed = 0});
+    std::vector<uint32_t> pages;
+    atlas.pack(rects, pages);
+    CHECK(atlas.getPageCount() == 4);
+    CHECK((pages == std::vector<uint32_t>{0, 1, 2, 3}));
+
+    // Frame 1: row 0 is meshed with glyphs from page 1, row 1 with glyphs from page 2 and row 2 from page 3
+    RowPages rows;
+    rows.resize(3);
+    rows.set(0, {1});
+    rows.set(1, {2});
+    rows.set(2, {3});
+    for (const uint32_t page : {1, 2, 3}) {
+        atlas.touch(page, 1);
+    }
+    // Frame 2: rows 1 and 2 change and are meshed again, row 0 stays in view without changing
+    atlas.touch(2, 2);
+    atlas.touch(3, 2);
+    // Frame 3: row 2 scrolls out of view
+    rows.clear(2);
+
+    // Row 0 looks the least recently used, but it's still in view
+    rows.touch(atlas, 3);
+    CHECK(atlas.evict(3) == std::optional<uint32_t>(3));
+    // The row which came into view instead is meshed with new glyphs packed into the evicted page
+    rows.set(2, {3});
+    atlas.touch(3, 3);
+    // Only pages of rows in view are left, they're never evicted
+    CHECK(atlas.evict(3) == std::nullopt);
+
+    // Once row 0 scrolls out of view too, its page is the first to go
+    rows.clear(0);
+    rows.touch(atlas, 4);
+    CHECK(atlas.evict(4) == std::optional<uint32_t>(1));
+
+    // Atlases of sizes which aren't drawn only keep the first page, and can grow back to the budget
+    atlas.trim();
+    CHECK(atlas.getPageCount() == 1);
+    rects.resize(3);
+    atlas.pack(rects, pages);
+    CHECK(atlas.getPageCount() == 4);
+    CHECK((pages == std::vector<uint32_t>{1, 2, 3}));
+
+    return check::exitCode();
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+/// Minimal assertions for the tests. Failures are counted instead of aborting, so one run reports all of them.
+namespace check {
+inline int failures = 0;
+
+inline int exitCode() {
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+} // namespace check
+
+#define CHECK(condition)                                                       \
+    do {                                                                       \
+        if (!(condition)) {                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,        \
+                         __LINE__, #condition);                                \
+            check::failures++;                                                 \
+        }                                                                      \
+    } while (false)
@@ -0,0 +1,55 @@
+#include "../src/terminal/unicode.hpp"
+#include "check.hpp"
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Cases in the format of GraphemeBreakTest.txt: ÷ is a boundary before the codepoint after it, × is none.
+// CR LF (GB3) isn't covered, the parser handles those before they reach the breaker.
+static const char* const GRAPHEME_BREAK_TESTS[] = {
+    "÷ 0020 ÷ 0020 ÷",
+    "÷ 0020 × 0308 ÷ 0020 ÷",
+    "÷ 0001 ÷ 0308 ÷",
+    "÷ 000D ÷ 0308 ÷",
+    "÷ 0600 × 0020 ÷",
+    "÷ 0600 ÷ 000A ÷",
+    "÷ 0915 × 093F ÷ 0915 ÷",
+    "÷ 1100 × 1161 × 11A8 ÷ 1100 ÷",
+    "÷ AC00 × 11A8 ÷ 1100 ÷",
+    "÷ AC01 × 11A8 × 11A8 ÷ AC01 ÷",
+    "÷ 1F1E6 × 1F1E7 ÷ 1F1E8 ÷ 0062 ÷",
+    "÷ 0061 ÷ 1F1E6 × 1F1E7 ÷ 1F1E8 × 1F1E9 ÷ 0062 ÷",
+    "÷ 1F476 × 1F3FF ÷ 1F476 ÷",
+    "÷ 1F6D1 × 200D × 1F6D1 ÷",
+    "÷ 0061 × 200D ÷ 1F6D1 ÷",
+    "÷ 2701 × 200D × 2701 ÷",
+    "÷ 1F468 × 200D × 1F469 × 200D × 1F467 ÷",
+    "÷ 1F6D1 × 0308 × 200D × 1F6D1 ÷",
+    "÷ 0020 × 200D ÷ 0646 ÷",
+    "÷ 0646 × 200D ÷ 0020 ÷",
+};
+
+int main() {
+    unicode::GraphemeBreaker breaker;
+    for (const char* test : GRAPHEME_BREAK_TESTS) {
+        breaker.reset();
+        std::istringstream tokens(test);
+        std::string token;
+        bool expectBreak = false;
+        while (tokens >> token) {
+            if (token == "÷" || token == "×") {
+                expectBreak = token == "÷";
+                continue;
+            }
+            const codepoint_t codepoint = std::stoul(token, nullptr, 16);
+            if (breaker.isBreak(codepoint) != expectBreak) {
+                std::printf("%s: wrong boundary before %s\n", test,
+                            token.c_str());
+                CHECK(false);
+            }
+        }
+    }
+
+    return check::exitCode();
+}